@@ -6,7 +6,7 @@
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
-#include "html.h"
+#include "web_assets.h"  // generated from web/ by scripts/web_assets.py
 
 #define CLK 2
 #define DIO 4 
@@ -0,0 +1,161 @@
+/*
+  Host benchmark: closed slot allocation, locked scan vs index stack
+
+  Build and run on the host:
+    g++ -O2 -std=c++11 -I../src closed_slot_bench.cpp -o closed_slot_bench -lpthread
+    ./closed_slot_bench [cycles] [slots]
+
+  Every accepted connection takes a closed slot and gives it back when it
+  closes. On the board the accept runs on the LwIP thread and the close on
+  the async_tcp task, so the two meet on the slot table. Each thread here
+  plays one of them: it opens a connection, keeps a handful open, and
+  closes the oldest one.
+
+  "scan" is the old _allocate_closed_slot(): take the semaphore, walk the
+  whole table for the slot closed longest ago, give the semaphore back.
+  "stack" pops and pushes the slot index on AsyncIndexStack, which is what
+  AsyncTCP does now.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AsyncTCPPool.h"
+
+static const int OPEN_PER_THREAD = 4;
+
+struct ScanSlots {
+    std::mutex lock;
+    std::vector<uint32_t> slots;
+    uint32_t index;
+
+    ScanSlots(int count) : slots(count, 1), index(1) {}
+
+    //the same loop as the old _allocate_closed_slot()
+    int alloc(){
+        std::lock_guard<std::mutex> guard(lock);
+        int slot = -1;
+        uint32_t min_index = 0;
+        for(size_t i = 0; i < slots.size(); ++i){
+            if((slot == -1 || slots[i] <= min_index) && slots[i] != 0){
+                min_index = slots[i];
+                slot = i;
+            }
+        }
+        if(slot != -1){
+            slots[slot] = 0;
+        }
+        return slot;
+    }
+
+    //the old _free_closed_slot() skipped the lock and raced on _closed_index,
+    //it is taken here so two threads cannot corrupt the table
+    void release(int slot){
+        std::lock_guard<std::mutex> guard(lock);
+        slots[slot] = index++;
+    }
+};
+
+struct StackSlots {
+    std::vector<std::atomic<uint32_t>> generations;
+    AsyncIndexStack free;
+
+    StackSlots(int count) : generations(count) {
+        for(int i = 0; i < count; ++i){
+            generations[i].store(0);
+        }
+        free.begin(count);
+    }
+
+    int alloc(){
+        uint16_t index = free.pop();
+        if(index == AsyncIndexStack::EMPTY){
+            return -1;
+        }
+        return (int)(((generations[index].load(std::memory_order_relaxed) & 0x7FFFFF) << 8) | index);
+    }
+
+    void release(int slot){
+        uint16_t index = slot & 0xFF;
+        generations[index].fetch_add(1, std::memory_order_release);
+        free.push(index);
+    }
+};
+
+struct Result {
+    double ns_per_cycle;
+    uint32_t exhausted; //opens that found no free slot
+};
+
+static double now_ns(){
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename Slots>
+static void churn(Slots * slots, uint32_t cycles, std::atomic<uint32_t> * exhausted){
+    int open[OPEN_PER_THREAD];
+    for(int i = 0; i < OPEN_PER_THREAD; ++i){
+        open[i] = slots->alloc();
+    }
+    uint32_t missed = 0;
+    for(uint32_t c = 0; c < cycles; ++c){
+        int & oldest = open[c % OPEN_PER_THREAD];
+        if(oldest != -1){
+            slots->release(oldest);
+        }
+        oldest = slots->alloc();
+        if(oldest == -1){
+            missed++;
+        }
+    }
+    for(int i = 0; i < OPEN_PER_THREAD; ++i){
+        if(open[i] != -1){
+            slots->release(open[i]);
+        }
+    }
+    exhausted->fetch_add(missed);
+}
+
+template<typename Slots>
+static Result run(int threads, uint32_t cycles, int count){
+    Slots slots(count);
+    std::atomic<uint32_t> exhausted(0);
+    std::vector<std::thread> workers;
+    double start = now_ns();
+    for(int t = 0; t < threads; ++t){
+        workers.push_back(std::thread(churn<Slots>, &slots, cycles, &exhausted));
+    }
+    for(size_t t = 0; t < workers.size(); ++t){
+        workers[t].join();
+    }
+    Result r;
+    r.ns_per_cycle = (now_ns() - start) / ((double)cycles * threads);
+    r.exhausted = exhausted.load();
+    return r;
+}
+
+static void print(const char * name, int threads, const Result & r){
+    printf("%-6s %d thread%s: %8.1f ns per open/close | no slot %u\n",
+        name, threads, (threads > 1) ? "s" : " ", r.ns_per_cycle, r.exhausted);
+}
+
+int main(int argc, char ** argv){
+    uint32_t cycles = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int count = (argc > 2) ? atoi(argv[2]) : 16;
+    if(count < 1 || count > 0xFF){
+        printf("slots must be between 1 and 255\n");
+        return 1;
+    }
+    printf("%u open/close cycles per thread, %d slots\n", cycles, count);
+    for(int threads = 1; threads <= 2; ++threads){
+        print("scan", threads, run<ScanSlots>(threads, cycles, count));
+        print("stack", threads, run<StackSlots>(threads, cycles, count));
+    }
+    return 0;
+}
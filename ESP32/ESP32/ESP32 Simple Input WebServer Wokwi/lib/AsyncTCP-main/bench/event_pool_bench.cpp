@@ -0,0 +1,149 @@
+/*
+  Host microbenchmark: AsyncObjectPool vs malloc/free for event packets
+
+  Build and run on the host:
+    g++ -O2 -std=c++11 -pthread -I../src event_pool_bench.cpp -o event_pool_bench
+    ./event_pool_bench
+
+  Two scenarios are measured. "same thread" allocates and releases in a
+  tight loop. "tcpip -> async" mimics AsyncTCP: one thread allocates packets
+  (the LwIP callbacks) and hands them through a bounded ring to a second
+  thread that releases them (_handle_async_event).
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "AsyncTCPPool.h"
+
+//same layout as lwip_event_packet_t (largest union members only)
+typedef struct {
+    int event;
+    void *arg;
+    union {
+        struct {
+            void * pcb;
+            void * pb;
+            int8_t err;
+        } recv;
+        struct {
+            const char * name;
+            uint32_t addr[5];
+        } dns;
+    };
+} bench_packet_t;
+
+static const uint32_t ITERATIONS = 2000000;
+static const uint32_t QUEUE_DEPTH = 32;
+
+struct HeapAllocator {
+    bench_packet_t * alloc(){ return (bench_packet_t *)malloc(sizeof(bench_packet_t)); }
+    void release(bench_packet_t * p){ free(p); }
+};
+
+struct PoolAllocator {
+    AsyncObjectPool<bench_packet_t> pool;
+    PoolAllocator(uint16_t size){ pool.begin(size); }
+    bench_packet_t * alloc(){ return pool.alloc(); }
+    void release(bench_packet_t * p){ pool.release(p); }
+};
+
+//single producer / single consumer ring standing in for the FreeRTOS queue
+struct Ring {
+    bench_packet_t * slots[QUEUE_DEPTH];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    Ring() : head(0), tail(0) {}
+    bool push(bench_packet_t * p){
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if(h - tail.load(std::memory_order_acquire) == QUEUE_DEPTH){
+            return false;
+        }
+        slots[h % QUEUE_DEPTH] = p;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    bench_packet_t * pop(){
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if(t == head.load(std::memory_order_acquire)){
+            return NULL;
+        }
+        bench_packet_t * p = slots[t % QUEUE_DEPTH];
+        tail.store(t + 1, std::memory_order_release);
+        return p;
+    }
+};
+
+static double now_ns(){
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename A>
+static double bench_same_thread(A & a){
+    //keep a handful in flight so the allocator cannot just hand back the same block
+    bench_packet_t * live[8] = {0};
+    double start = now_ns();
+    for(uint32_t i = 0; i < ITERATIONS; ++i){
+        bench_packet_t *& slot = live[i & 7];
+        if(slot){
+            a.release(slot);
+        }
+        slot = a.alloc();
+        slot->event = i;
+    }
+    for(int i = 0; i < 8; ++i){
+        a.release(live[i]);
+    }
+    return (now_ns() - start) / ITERATIONS;
+}
+
+template<typename A>
+static double bench_cross_thread(A & a){
+    Ring ring;
+    double start = now_ns();
+    std::thread consumer([&](){
+        for(uint32_t done = 0; done < ITERATIONS;){
+            bench_packet_t * p = ring.pop();
+            if(!p){
+                std::this_thread::yield();
+                continue;
+            }
+            a.release(p);
+            ++done;
+        }
+    });
+    for(uint32_t i = 0; i < ITERATIONS; ++i){
+        bench_packet_t * p = a.alloc();
+        p->event = i;
+        while(!ring.push(p)){
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    return (now_ns() - start) / ITERATIONS;
+}
+
+static void print_pool(const char * label, PoolAllocator & p){
+    async_pool_stats_t s;
+    p.pool.stats(&s);
+    printf("  %-14s size=%u hits=%u misses=%u high_water=%u\n", label, s.size, s.hits, s.misses, s.high_water);
+}
+
+int main(){
+    HeapAllocator heap;
+    PoolAllocator pool(QUEUE_DEPTH + 8);
+    PoolAllocator tiny(4);
+
+    printf("%u iterations, packet %u bytes\n", ITERATIONS, (unsigned)sizeof(bench_packet_t));
+    printf("%-16s %12s %12s\n", "", "same thread", "tcpip->async");
+    printf("%-16s %9.1f ns %9.1f ns\n", "malloc/free", bench_same_thread(heap), bench_cross_thread(heap));
+    printf("%-16s %9.1f ns %9.1f ns\n", "pool", bench_same_thread(pool), bench_cross_thread(pool));
+    printf("%-16s %9.1f ns %9.1f ns\n", "pool (4 slots)", bench_same_thread(tiny), bench_cross_thread(tiny));
+    print_pool("pool", pool);
+    print_pool("pool (4 slots)", tiny);
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+  Host benchmark: event throughput with 1, 2 and 4 async_tcp workers
+
+  A model, not AsyncTCP itself: the host backend runs everything on one
+  epoll thread and has no FreeRTOS queues, so the queue topology of
+  CONFIG_ASYNC_TCP_WORKERS is rebuilt here with std::thread. One producer
+  thread (the LwIP thread) posts events for a set of connections into
+  per-worker blocking queues of depth 32, routed with async_tcp_worker_for()
+  from AsyncTCPWorker.h, the hash AsyncTCP.cpp uses. Each worker burns
+  handler_us of CPU per event, standing in for request parsing or WebSocket
+  handling, and checks that the events of every connection arrive in the
+  order they were posted.
+  What it shows is the ordering and how evenly the hash splits the
+  connections. The events/s depend on the host cores and say little about
+  the two cores of an ESP32, where the LwIP thread and WiFi take their share.
+*/
+
+//Build and run on the host:
+//  g++ -O2 -std=c++11 -pthread -I../src worker_scaling_bench.cpp -o worker_scaling_bench
+//  ./worker_scaling_bench [connections] [events] [handler_us]
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AsyncTCPWorker.h"
+
+static const size_t QUEUE_DEPTH = 32;
+
+struct Connection {
+    uint32_t posted;
+    uint32_t handled;
+    uint32_t out_of_order;
+    char pad[64];
+};
+
+struct Event {
+    Connection * conn;
+    uint32_t seq;
+};
+
+//blocking bounded queue, like xQueueSend/xQueueReceive with portMAX_DELAY
+class Queue {
+  public:
+    void send(const Event & e){
+        std::unique_lock<std::mutex> lock(_mutex);
+        _not_full.wait(lock, [this]{ return _items.size() < QUEUE_DEPTH; });
+        _items.push_back(e);
+        _not_empty.notify_one();
+    }
+    Event receive(){
+        std::unique_lock<std::mutex> lock(_mutex);
+        _not_empty.wait(lock, [this]{ return !_items.empty(); });
+        Event e = _items.front();
+        _items.pop_front();
+        _not_full.notify_one();
+        return e;
+    }
+  private:
+    std::mutex _mutex;
+    std::condition_variable _not_full;
+    std::condition_variable _not_empty;
+    std::deque<Event> _items;
+};
+
+
+static void burn(uint32_t us){
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    volatile uint32_t x = 0;
+    while(std::chrono::steady_clock::now() < end){
+        x = x * 33 + 7;
+    }
+}
+
+static void run(size_t workers, size_t connections, uint32_t events, uint32_t handler_us){
+    std::vector<Connection> conns(connections);
+    std::vector<Queue> queues(workers);
+    std::vector<std::thread> threads;
+    std::vector<uint32_t> per_worker(workers, 0);
+
+    for(size_t w = 0; w < workers; ++w){
+        threads.push_back(std::thread([&, w](){
+            for(;;){
+                Event e = queues[w].receive();
+                if(!e.conn){
+                    return;
+                }
+                if(e.seq != e.conn->handled){
+                    e.conn->out_of_order++;
+                }
+                e.conn->handled = e.seq + 1;
+                per_worker[w]++;
+                burn(handler_us);
+            }
+        }));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < events; ++i){
+        Connection * c = &conns[rand() % connections];
+        Event e = { c, c->posted++ };
+        queues[async_tcp_worker_for(c, workers)].send(e);
+    }
+    for(size_t w = 0; w < workers; ++w){
+        Event stop = { NULL, 0 };
+        queues[w].send(stop);
+    }
+    for(size_t w = 0; w < workers; ++w){
+        threads[w].join();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t out_of_order = 0;
+    for(size_t c = 0; c < connections; ++c){
+        out_of_order += conns[c].out_of_order;
+    }
+    printf("%zu worker(s): %9.0f events/s, out of order: %u, split:", workers, events / secs, out_of_order);
+    for(size_t w = 0; w < workers; ++w){
+        printf(" %u", per_worker[w]);
+    }
+    printf("\n");
+}
+
+int main(int argc, char ** argv){
+    size_t connections = (argc > 1) ? atoi(argv[1]) : 16;
+    uint32_t events = (argc > 2) ? atoi(argv[2]) : 20000;
+    uint32_t handler_us = (argc > 3) ? atoi(argv[3]) : 20;
+
+    printf("%zu connections, %u events, %u us per event, %u host cores\n",
+        connections, events, handler_us, std::thread::hardware_concurrency());
+    run(1, connections, events, handler_us);
+    run(2, connections, events, handler_us);
+    run(4, connections, events, handler_us);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+  Host shim: the ESP32 fs::FS over a directory of the host, so
+  serveStatic() and file responses read real files.
+*/
+
+#ifndef FS_H_HOST
+#define FS_H_HOST
+
+#include <memory>
+#include <time.h>
+
+#include "Arduino.h"
+
+namespace fs {
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+enum SeekMode {
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+struct FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File : public Stream {
+  public:
+    File(FileImplPtr p = FileImplPtr()) : _p(p) {}
+
+    size_t write(uint8_t) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t read(uint8_t* buf, size_t size);
+    size_t readBytes(char *buffer, size_t length) override {
+      return read((uint8_t*)buffer, length);
+    }
+
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char* path() const;
+    const char* name() const;
+
+    bool isDirectory(void);
+
+    using Print::write;
+
+  protected:
+    FileImplPtr _p;
+};
+
+class FS {
+  public:
+    FS(const char * root = ".") : _root(root) {}
+
+    File open(const char* path, const char* mode = FILE_READ, const bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, const bool create = false) {
+      return open(path.c_str(), mode, create);
+    }
+
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+
+  protected:
+    String _realPath(const char* path);
+
+    String _root;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif /* FS_H_HOST */
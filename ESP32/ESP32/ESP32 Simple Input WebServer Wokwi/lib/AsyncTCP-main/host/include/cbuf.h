@@ -0,0 +1,47 @@
+/*
+  Host shim: the ring buffer of the ESP32 core, AsyncResponseStream keeps its body in one.
+*/
+
+#ifndef CBUF_H_HOST
+#define CBUF_H_HOST
+
+#include <stddef.h>
+
+class cbuf {
+  public:
+    cbuf(size_t size);
+    ~cbuf();
+
+    size_t resizeAdd(size_t addSize);
+    size_t resize(size_t newSize);
+    size_t available() const;
+    size_t size();
+    size_t room() const;
+
+    inline bool empty() const { return _begin == _end; }
+    inline bool full() const { return wrap_if_bufend(_end + 1) == _begin; }
+
+    int peek();
+    size_t peek(char *dst, size_t size);
+    int read();
+    size_t read(char* dst, size_t size);
+    size_t write(char c);
+    size_t write(const char* src, size_t size);
+    void flush();
+    size_t remove(size_t size);
+
+    cbuf *next;
+
+  private:
+    inline char* wrap_if_bufend(char* ptr) const {
+      return (ptr == _bufend) ? _buf : ptr;
+    }
+
+    size_t _size;
+    char* _buf;
+    const char* _bufend;
+    char* _begin;
+    char* _end;
+};
+
+#endif /* CBUF_H_HOST */
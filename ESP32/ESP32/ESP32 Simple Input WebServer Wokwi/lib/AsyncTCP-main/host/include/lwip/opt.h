@@ -0,0 +1,11 @@
+/*
+  Host shim: the LwIP options AsyncTCP and ESPAsyncWebServer look at.
+*/
+
+#ifndef LWIP_HDR_OPT_H
+#define LWIP_HDR_OPT_H
+
+#define LWIP_IPV4 1
+#define LWIP_IPV6 1
+
+#endif /* LWIP_HDR_OPT_H */
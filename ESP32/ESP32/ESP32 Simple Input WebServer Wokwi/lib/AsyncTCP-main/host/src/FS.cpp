@@ -0,0 +1,190 @@
+/*
+  Host shim: fs::FS over a host directory, see include/FS.h
+*/
+
+#include "FS.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs {
+
+struct FileImpl {
+    FILE * f;
+    bool dir;
+    String path;    //as the sketch asked for it
+    String name;    //last path component
+
+    ~FileImpl(){
+        if(f){
+            fclose(f);
+        }
+    }
+};
+
+/*
+ * File
+ * */
+
+size_t File::write(uint8_t c){
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buf, size_t size){
+    if(!_p || !_p->f){
+        return 0;
+    }
+    return fwrite(buf, 1, size, _p->f);
+}
+
+int File::available(){
+    if(!_p || !_p->f){
+        return 0;
+    }
+    return size() - position();
+}
+
+int File::read(){
+    if(!_p || !_p->f){
+        return -1;
+    }
+    return fgetc(_p->f);
+}
+
+int File::peek(){
+    if(!_p || !_p->f){
+        return -1;
+    }
+    int c = fgetc(_p->f);
+    if(c != EOF){
+        ungetc(c, _p->f);
+    }
+    return c;
+}
+
+void File::flush(){
+    if(_p && _p->f){
+        fflush(_p->f);
+    }
+}
+
+size_t File::read(uint8_t* buf, size_t size){
+    if(!_p || !_p->f){
+        return 0;
+    }
+    return fread(buf, 1, size, _p->f);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode){
+    if(!_p || !_p->f){
+        return false;
+    }
+    int whence = (mode == SeekCur) ? SEEK_CUR : ((mode == SeekEnd) ? SEEK_END : SEEK_SET);
+    return fseek(_p->f, pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if(!_p || !_p->f){
+        return 0;
+    }
+    long pos = ftell(_p->f);
+    return (pos < 0) ? 0 : pos;
+}
+
+size_t File::size() const {
+    if(!_p || !_p->f){
+        return 0;
+    }
+    struct stat st;
+    if(fstat(fileno(_p->f), &st) != 0){
+        return 0;
+    }
+    return st.st_size;
+}
+
+void File::close(){
+    _p.reset();
+}
+
+File::operator bool() const {
+    return !!_p;
+}
+
+time_t File::getLastWrite(){
+    if(!_p || !_p->f){
+        return 0;
+    }
+    struct stat st;
+    if(fstat(fileno(_p->f), &st) != 0){
+        return 0;
+    }
+    return st.st_mtime;
+}
+
+const char* File::path() const {
+    return _p ? _p->path.c_str() : NULL;
+}
+
+const char* File::name() const {
+    return _p ? _p->name.c_str() : NULL;
+}
+
+bool File::isDirectory(void){
+    return _p && _p->dir;
+}
+
+/*
+ * FS
+ * */
+
+String FS::_realPath(const char* path){
+    String real = _root;
+    if(path[0] != '/'){
+        real += '/';
+    }
+    real += path;
+    return real;
+}
+
+File FS::open(const char* path, const char* mode, const bool create){
+    if(!path || path[0] == '\0' || strstr(path, "..")){
+        return File();
+    }
+    String real = _realPath(path);
+    struct stat st;
+    bool exists = stat(real.c_str(), &st) == 0;
+    if(!exists && mode[0] == 'r'){
+        return File();
+    }
+    FileImplPtr impl = std::make_shared<FileImpl>();
+    impl->f = NULL;
+    impl->dir = exists && S_ISDIR(st.st_mode);
+    impl->path = path;
+    const char * slash = strrchr(path, '/');
+    impl->name = slash ? slash + 1 : path;
+    if(!impl->dir){
+        impl->f = fopen(real.c_str(), mode);
+        if(!impl->f){
+            return File();
+        }
+    }
+    return File(impl);
+}
+
+bool FS::exists(const char* path){
+    if(!path || strstr(path, "..")){
+        return false;
+    }
+    struct stat st;
+    return stat(_realPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path){
+    if(!path || strstr(path, "..")){
+        return false;
+    }
+    return unlink(_realPath(path).c_str()) == 0;
+}
+
+} // namespace fs
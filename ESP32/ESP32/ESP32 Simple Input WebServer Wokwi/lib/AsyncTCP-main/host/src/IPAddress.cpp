@@ -0,0 +1,104 @@
+/*
+  Host shim: IPAddress and IPv6Address, see include/IPAddress.h
+*/
+
+#include "Arduino.h"
+
+#include <arpa/inet.h>
+
+/*
+ * IPAddress
+ * */
+
+IPAddress::IPAddress(){
+    _address.dword = 0;
+}
+
+IPAddress::IPAddress(uint8_t first_octet, uint8_t second_octet, uint8_t third_octet, uint8_t fourth_octet){
+    _address.bytes[0] = first_octet;
+    _address.bytes[1] = second_octet;
+    _address.bytes[2] = third_octet;
+    _address.bytes[3] = fourth_octet;
+}
+
+IPAddress::IPAddress(uint32_t address){
+    _address.dword = address;
+}
+
+IPAddress::IPAddress(const uint8_t *address){
+    memcpy(_address.bytes, address, sizeof(_address.bytes));
+}
+
+IPAddress& IPAddress::operator=(const uint8_t *address){
+    memcpy(_address.bytes, address, sizeof(_address.bytes));
+    return *this;
+}
+
+IPAddress& IPAddress::operator=(uint32_t address){
+    _address.dword = address;
+    return *this;
+}
+
+bool IPAddress::operator==(const uint8_t* addr) const {
+    return memcmp(addr, _address.bytes, sizeof(_address.bytes)) == 0;
+}
+
+bool IPAddress::fromString(const char *address){
+    struct in_addr parsed;
+    if(!address || inet_pton(AF_INET, address, &parsed) != 1){
+        return false;
+    }
+    _address.dword = parsed.s_addr;
+    return true;
+}
+
+size_t IPAddress::printTo(Print& p) const {
+    return p.print(toString());
+}
+
+String IPAddress::toString() const {
+    char szRet[16];
+    snprintf(szRet, sizeof(szRet), "%u.%u.%u.%u", _address.bytes[0], _address.bytes[1], _address.bytes[2], _address.bytes[3]);
+    return String(szRet);
+}
+
+/*
+ * IPv6Address
+ * */
+
+IPv6Address::IPv6Address(){
+    memset(_address.bytes, 0, sizeof(_address.bytes));
+}
+
+IPv6Address::IPv6Address(const uint8_t *address){
+    memcpy(_address.bytes, address, sizeof(_address.bytes));
+}
+
+IPv6Address::IPv6Address(const uint32_t *address){
+    memcpy(_address.bytes, (const uint8_t *)address, sizeof(_address.bytes));
+}
+
+IPv6Address& IPv6Address::operator=(const uint8_t *address){
+    memcpy(_address.bytes, address, sizeof(_address.bytes));
+    return *this;
+}
+
+bool IPv6Address::operator==(const IPv6Address& addr) const {
+    return memcmp(addr._address.bytes, _address.bytes, sizeof(_address.bytes)) == 0;
+}
+
+bool IPv6Address::fromString(const char *address){
+    return address && inet_pton(AF_INET6, address, _address.bytes) == 1;
+}
+
+size_t IPv6Address::printTo(Print& p) const {
+    return p.print(toString());
+}
+
+String IPv6Address::toString() const {
+    char szRet[INET6_ADDRSTRLEN];
+    if(!inet_ntop(AF_INET6, _address.bytes, szRet, sizeof(szRet))){
+        return String();
+    }
+    return String(szRet);
+}
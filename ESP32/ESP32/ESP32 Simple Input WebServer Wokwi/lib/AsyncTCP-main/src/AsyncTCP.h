@@ -24,6 +24,7 @@
 
 #include "IPAddress.h"
 #include "IPv6Address.h"
+#include "AsyncTCPPool.h"
 #include <functional>
 #include "lwip/ip_addr.h"
 #include "lwip/ip6_addr.h"
@@ -49,31 +50,95 @@ extern "C" {
 #define CONFIG_ASYNC_TCP_USE_WDT 1 //if enabled, adds between 33us and 200us per event
 #endif
 
+//number of async_tcp tasks, each with its own event queue. Events are routed
+//per connection, so callbacks of different connections can run in parallel
+#ifndef CONFIG_ASYNC_TCP_WORKERS
+#define CONFIG_ASYNC_TCP_WORKERS 1
+#endif
+
 #ifndef CONFIG_ASYNC_TCP_STACK_SIZE
 #define CONFIG_ASYNC_TCP_STACK_SIZE 8192 * 2
 #endif
 
+//depth of each event queue, a few events per possible connection
+#ifndef CONFIG_ASYNC_TCP_QUEUE_SIZE
+#define CONFIG_ASYNC_TCP_QUEUE_SIZE (CONFIG_LWIP_MAX_ACTIVE_TCP * 4)
+#endif
+
+//event packets reserved when the async task starts, 0 allocates every event from the heap.
+//Unset or -1 (the Kconfig default) reserves one for every slot of the event queues
+#if !defined(CONFIG_ASYNC_TCP_EVENT_POOL_SIZE) || CONFIG_ASYNC_TCP_EVENT_POOL_SIZE < 0
+#undef CONFIG_ASYNC_TCP_EVENT_POOL_SIZE
+#define CONFIG_ASYNC_TCP_EVENT_POOL_SIZE (CONFIG_ASYNC_TCP_QUEUE_SIZE * CONFIG_ASYNC_TCP_WORKERS)
+#endif
+
+//AsyncClient objects reserved when the async task starts, one per connection LwIP allows
+#ifndef CONFIG_ASYNC_TCP_CLIENT_POOL_SIZE
+#define CONFIG_ASYNC_TCP_CLIENT_POOL_SIZE CONFIG_LWIP_MAX_ACTIVE_TCP
+#endif
+
+//zero-copy write records reserved when the async task starts, a few per connection
+#ifndef CONFIG_ASYNC_TCP_TX_REF_POOL_SIZE
+#define CONFIG_ASYNC_TCP_TX_REF_POOL_SIZE (CONFIG_LWIP_MAX_ACTIVE_TCP * 4)
+#endif
+
 class AsyncClient;
 
 #define ASYNC_MAX_ACK_TIME 5000
+#define ASYNC_POLL_INTERVAL 500 //default onPoll period in milliseconds
 #define ASYNC_WRITE_FLAG_COPY 0x01 //will allocate new buffer to hold the data while sending (else will hold reference to the data given)
 #define ASYNC_WRITE_FLAG_MORE 0x02 //will not send PSH flag, meaning that there should be more data to be sent before the application should react.
 
+//one buffer of a vectored write, see AsyncClient::addv()
+typedef struct {
+    const char * data;
+    size_t len;
+    uint8_t apiflags;   //ASYNC_WRITE_FLAG_*
+} async_tcp_segment_t;
+
+typedef struct {
+    async_pool_stats_t event_pool;
+    async_pool_stats_t client_pool; //misses are clients that found the pool exhausted
+    async_pool_stats_t tx_ref_pool; //misses are zero-copy writes that found the pool exhausted
+    uint32_t queue_size;        //capacity of each event queue
+    uint32_t queue_depth;       //events waiting right now, all queues together
+    uint32_t queue_high_water;  //most events ever waiting in one queue
+    uint32_t blocked_count;     //times the LwIP thread had to wait for queue space
+    uint32_t blocked_us;        //total time the LwIP thread spent waiting
+    uint32_t recv_refused;      //data left with LwIP because the queue was busy, redelivered later
+    uint32_t sent_coalesced;    //acks folded into a later SENT event
+    uint32_t poll_coalesced;    //timer re-checks skipped because one was still queued
+    uint32_t timers_armed;      //connections waiting for a deadline right now
+    uint32_t timers_fired;      //deadlines that came due
+    uint32_t dropped;           //events lost because they could not be queued at all
+    uint32_t stale_discarded;   //events of already closed connections dropped when dequeued
+} async_tcp_stats_t;
+
+void async_tcp_get_stats(async_tcp_stats_t * stats);
+
 typedef std::function<void(void*, AsyncClient*)> AcConnectHandler;
 typedef std::function<void(void*, AsyncClient*, size_t len, uint32_t time)> AcAckHandler;
 typedef std::function<void(void*, AsyncClient*, int8_t error)> AcErrorHandler;
 typedef std::function<void(void*, AsyncClient*, void *data, size_t len)> AcDataHandler;
 typedef std::function<void(void*, AsyncClient*, struct pbuf *pb)> AcPacketHandler;
 typedef std::function<void(void*, AsyncClient*, uint32_t time)> AcTimeoutHandler;
+typedef std::function<void(void*, AsyncClient*, const char *data)> AcReleaseHandler;
 
 struct tcp_pcb;
 struct ip_addr;
+struct async_event_owner;
+struct async_tx_ref;
 
 class AsyncClient {
   public:
     AsyncClient(tcp_pcb* pcb = 0);
     ~AsyncClient();
 
+    //clients come from a pool sized by CONFIG_ASYNC_TCP_CLIENT_POOL_SIZE and
+    //fall back to the heap when it is exhausted, NULL only if both are empty
+    static void* operator new(size_t size) noexcept;
+    static void operator delete(void* ptr);
+
     AsyncClient & operator=(const AsyncClient &other);
     AsyncClient & operator+=(const AsyncClient &other);
 
@@ -93,11 +158,19 @@ class AsyncClient {
     bool canSend();//ack is not pending
     size_t space();//space available in the TCP window
     size_t add(const char* data, size_t size, uint8_t apiflags=ASYNC_WRITE_FLAG_COPY);//add for sending
-    bool send();//send all data added with the method above
+    size_t addv(const async_tcp_segment_t * segments, size_t count);//add all segments in order with one call into LwIP, stops when the window is full
+    bool send();//send all data added with the methods above
 
-    //write equals add()+send()
+    //write equals add()+send(), writev equals addv()+send(), each in a single call into LwIP
     size_t write(const char* data);
     size_t write(const char* data, size_t size, uint8_t apiflags=ASYNC_WRITE_FLAG_COPY); //only when canSend() == true
+    size_t writev(const async_tcp_segment_t * segments, size_t count);
+
+    //zero-copy: LwIP sends straight from data, which must stay untouched until release is called.
+    //That happens once every accepted byte is acked, or when the connection is gone. Nothing
+    //accepted (0 returned) means no release. Closing with such data unacked resets the connection.
+    size_t addRef(const char* data, size_t size, AcReleaseHandler release, void* arg = 0, uint8_t apiflags = 0);
+    size_t writeRef(const char* data, size_t size, AcReleaseHandler release, void* arg = 0, uint8_t apiflags = 0);
 
     uint8_t state();
     bool connecting();
@@ -114,6 +187,9 @@ class AsyncClient {
     uint32_t getAckTimeout();
     void setAckTimeout(uint32_t timeout);//no ACK timeout for the last sent packet in milliseconds
 
+    uint32_t getPollInterval();
+    void setPollInterval(uint32_t interval);//onPoll period in milliseconds, 0 stops polling
+
     void setNoDelay(bool nodelay);
     bool getNoDelay();
 
@@ -141,7 +217,7 @@ class AsyncClient {
     void onData(AcDataHandler cb, void* arg = 0);           //data received (called if onPacket is not used)
     void onPacket(AcPacketHandler cb, void* arg = 0);       //data received
     void onTimeout(AcTimeoutHandler cb, void* arg = 0);     //ack timeout
-    void onPoll(AcConnectHandler cb, void* arg = 0);        //every 125ms when connected
+    void onPoll(AcConnectHandler cb, void* arg = 0);        //every poll interval when connected
 
     void ackPacket(struct pbuf * pb);//ack pbuf from onPacket
     size_t ack(size_t len); //ack data that you have not acked using the method below
@@ -163,11 +239,15 @@ class AsyncClient {
     int8_t _recv(tcp_pcb* pcb, pbuf* pb, int8_t err);
     tcp_pcb * pcb(){ return _pcb; }
 
+    std::atomic<bool> _poll_queued;         //a POLL event asking to re-check the timers is still queued
+    std::atomic<uint32_t> _sent_deferred;   //acked bytes not yet reported by a SENT event
+    async_event_owner * _events;            //tombstone shared with this connection's queued events
+
   protected:
     bool _connect(ip_addr_t addr, uint16_t port);
 
     tcp_pcb* _pcb;
-    int8_t  _closed_slot;
+    std::atomic<int32_t> _closed_slot;      //freed on FIN in the LwIP thread or by the destructor, whichever is first
 
     AcConnectHandler _connect_cb;
     void* _connect_cb_arg;
@@ -193,11 +273,26 @@ class AsyncClient {
     uint32_t _rx_timeout;
     uint32_t _rx_last_ack;
     uint32_t _ack_timeout;
+    uint32_t _poll_interval;
+    uint32_t _last_poll;
     uint16_t _connect_port;
 
+    uint32_t _tx_queued;                    //bytes handed to LwIP on this connection
+    std::atomic<uint32_t> _tx_acked;        //bytes acked on this connection
+    std::atomic<uint32_t> _tx_refs_pending; //zero-copy writes not released yet
+    async_tx_ref * _tx_refs;                //their release queue, oldest first
+    async_tx_ref * _tx_refs_tail;
+
     int8_t _close();
     void _free_closed_slot();
     void _allocate_closed_slot();
+    void _attach_event_owner();
+    bool _ack_pending();
+    void _arm_ack_timeout();
+    size_t _add_ref(const char* data, size_t size, AcReleaseHandler release, void* arg, uint8_t apiflags, bool output);
+    void _release_refs(bool all);
+    void _schedule_timer();
+    void _rearm_timer();
     int8_t _connected(void* pcb, int8_t err);
     void _error(int8_t err);
     int8_t _poll(tcp_pcb* pcb);
@@ -0,0 +1,190 @@
+/*
+  Asynchronous TCP library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ASYNCTCPPOOL_H_
+#define ASYNCTCPPOOL_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+/*
+ * Lock-free stack of slot indexes (Treiber stack).
+ * The head packs the top index in the low 16 bits and a tag in the high
+ * 16 bits, so a pop/push/pop race on the same index (ABA) fails the CAS.
+ * Everything fits in one 32-bit word, which is lock-free on Xtensa and ARM.
+ * */
+
+class AsyncIndexStack {
+  public:
+    static const uint16_t EMPTY = 0xFFFF;
+
+    AsyncIndexStack() : _head(EMPTY), _next(NULL), _capacity(0) {}
+    ~AsyncIndexStack(){ ::free(_next); }
+
+    //allocates the links and pushes every index, so all slots start out free
+    bool begin(uint16_t capacity){
+        if(_next){
+            return true;
+        }
+        if(!capacity || capacity >= EMPTY){
+            return false;
+        }
+        _next = (std::atomic<uint16_t> *)malloc(sizeof(std::atomic<uint16_t>) * capacity);
+        if(!_next){
+            return false;
+        }
+        for(uint16_t i = 0; i < capacity; ++i){
+            new (&_next[i]) std::atomic<uint16_t>((i + 1 < capacity) ? (i + 1) : EMPTY);
+        }
+        _capacity = capacity;
+        _head.store(0, std::memory_order_release);
+        return true;
+    }
+
+    uint16_t capacity() const { return _capacity; }
+
+    //returns EMPTY when there is nothing left
+    uint16_t pop(){
+        uint32_t head = _head.load(std::memory_order_acquire);
+        for(;;){
+            uint16_t index = head & 0xFFFF;
+            if(index == EMPTY){
+                return EMPTY;
+            }
+            uint32_t next = (head & 0xFFFF0000) + 0x10000 + _next[index].load(std::memory_order_relaxed);
+            if(_head.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire)){
+                return index;
+            }
+        }
+    }
+
+    void push(uint16_t index){
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        for(;;){
+            _next[index].store(head & 0xFFFF, std::memory_order_relaxed);
+            uint32_t top = (head & 0xFFFF0000) + 0x10000 + index;
+            if(_head.compare_exchange_weak(head, top, std::memory_order_release, std::memory_order_relaxed)){
+                return;
+            }
+        }
+    }
+
+  private:
+    std::atomic<uint32_t> _head;
+    std::atomic<uint16_t> * _next;
+    uint16_t _capacity;
+};
+
+typedef struct {
+    uint32_t size;       //slots reserved at startup
+    uint32_t hits;       //allocations served from the pool
+    uint32_t misses;     //allocations that fell back to the heap
+    uint32_t used;       //pool slots currently handed out
+    uint32_t high_water; //most pool slots ever handed out at once
+} async_pool_stats_t;
+
+/*
+ * Fixed-capacity pool of raw storage for T, sized once with begin().
+ * alloc() never blocks: when the pool is exhausted (or was never started)
+ * it falls back to malloc, and release() tells both kinds apart by address.
+ * Storage is uninitialized, construct with placement new when T needs it.
+ * */
+
+template<typename T>
+class AsyncObjectPool {
+  public:
+    AsyncObjectPool() : _items(NULL), _hits(0), _misses(0), _used(0), _high_water(0) {}
+    ~AsyncObjectPool(){ ::free(_items); }
+
+    bool begin(uint16_t capacity){
+        if(_items){
+            return true;
+        }
+        if(!capacity){
+            return false;
+        }
+        T * items = (T *)malloc(sizeof(T) * capacity);
+        if(!items){
+            return false;
+        }
+        if(!_free.begin(capacity)){
+            ::free(items);
+            return false;
+        }
+        _items = items;
+        return true;
+    }
+
+    T * alloc(){
+        uint16_t index = _items ? _free.pop() : AsyncIndexStack::EMPTY;
+        if(index == AsyncIndexStack::EMPTY){
+            _count(_misses);
+            return (T *)malloc(sizeof(T));
+        }
+        _count(_hits);
+        uint32_t used = _used.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint32_t high = _high_water.load(std::memory_order_relaxed);
+        while(used > high && !_high_water.compare_exchange_weak(high, used, std::memory_order_relaxed)){}
+        return &_items[index];
+    }
+
+    void release(T * item){
+        if(!item){
+            return;
+        }
+        if(!owns(item)){
+            ::free(item);
+            return;
+        }
+        _used.fetch_sub(1, std::memory_order_relaxed);
+        _free.push(item - _items);
+    }
+
+    bool owns(const T * item) const {
+        return _items && item >= _items && item < _items + _free.capacity();
+    }
+
+    void stats(async_pool_stats_t * s) const {
+        s->size = _free.capacity();
+        s->hits = _hits.load(std::memory_order_relaxed);
+        s->misses = _misses.load(std::memory_order_relaxed);
+        s->used = _used.load(std::memory_order_relaxed);
+        s->high_water = _high_water.load(std::memory_order_relaxed);
+    }
+
+  private:
+    //allocations come almost only from the LwIP thread, so a plain load/store
+    //is enough here and saves two atomic read-modify-writes per event
+    static void _count(std::atomic<uint32_t> & counter){
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    T * _items;
+    AsyncIndexStack _free;
+    std::atomic<uint32_t> _hits;
+    std::atomic<uint32_t> _misses;
+    std::atomic<uint32_t> _used;
+    std::atomic<uint32_t> _high_water;
+};
+
+#endif /* ASYNCTCPPOOL_H_ */
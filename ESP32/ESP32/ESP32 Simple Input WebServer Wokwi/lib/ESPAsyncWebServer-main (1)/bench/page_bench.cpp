@@ -0,0 +1,162 @@
+/*
+  Host benchmark: serving a 7 KB dashboard page, String vs send_P vs sendFlash
+
+  A client on the loopback loads the page over and over, one connection per
+  load. Every malloc, calloc and realloc made by the process while a page is
+  requested, sent and the connection closed is counted, with the bytes asked
+  for and the most heap held at once above what was held before the load.
+
+  "string" is how the WS dashboard served it: the page is copied into a
+  String, two placeholders are replaced and send() copies it again into the
+  response. "send_P" reads it from flash into the transmit buffer through
+  AsyncProgmemResponse. "flash" is sendFlash(): LwIP is handed pointers into
+  the page and only the head is copied.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -I../../AsyncTCP-main/host/include -I../../AsyncTCP-main/src -I../src page_bench.cpp ../src/*.cpp ../../AsyncTCP-main/src/AsyncTCPClient.cpp ../../AsyncTCP-main/host/src/*.cpp -o page_bench -lpthread
+//  ./page_bench [loads] [port]
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <malloc.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static std::atomic<bool> counting(false);
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> allocated(0);
+static std::atomic<int64_t> live(0);
+static std::atomic<int64_t> peak(0);
+
+static void *track(void *ptr){
+    if(ptr != NULL && counting){
+        size_t size = malloc_usable_size(ptr);
+        allocations++;
+        allocated += size;
+        int64_t now = (live += size);
+        int64_t high = peak;
+        while(now > high && !peak.compare_exchange_weak(high, now)){}
+    }
+    return ptr;
+}
+
+extern "C" void *malloc(size_t size){
+    return track(__libc_malloc(size));
+}
+
+extern "C" void *calloc(size_t count, size_t size){
+    return track(__libc_calloc(count, size));
+}
+
+extern "C" void *realloc(void *ptr, size_t size){
+    if(ptr != NULL && counting){
+        live -= malloc_usable_size(ptr);
+    }
+    return track(__libc_realloc(ptr, size));
+}
+
+extern "C" void free(void *ptr){
+    if(ptr != NULL && counting){
+        live -= malloc_usable_size(ptr);
+    }
+    __libc_free(ptr);
+}
+
+//stands in for index_html.h: static, about as long, two placeholders
+static char PAGE[7 * 1024];
+
+static void makePage(){
+    size_t len = 0;
+    len += snprintf(PAGE + len, sizeof(PAGE) - len, "<!DOCTYPE html><html><head><title>ESP32 Temperature Monitor</title><style>\n");
+    while(len < sizeof(PAGE) - 512){
+        len += snprintf(PAGE + len, sizeof(PAGE) - len, "  .reading-card { padding: 20px; border-radius: 15px; margin: 10px; }\n");
+    }
+    snprintf(PAGE + len, sizeof(PAGE) - len,
+        "</style></head><body>\n"
+        "<div class=\"reading-value temp-value\">TEMP_VALUE&#176;C</div>\n"
+        "<div class=\"reading-value humid-value\">HUM_VALUE%%</div>\n"
+        "</body></html>\n");
+}
+
+static size_t load(uint16_t port, const char* path){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
+        close(fd);
+        return 0;
+    }
+    char buf[2048];
+    int n = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n", path);
+    send(fd, buf, n, 0);
+    size_t received = 0;
+    ssize_t r;
+    while((r = recv(fd, buf, sizeof(buf), 0)) > 0){
+        received += r;
+    }
+    close(fd);
+    return received;
+}
+
+static void run(const char* name, uint16_t port, const char* path, uint32_t loads){
+    //one load first, so pools and LwIP stand-ins are warm
+    size_t expected = load(port, path);
+    delay(20);
+    allocations = 0;
+    allocated = 0;
+    int64_t worst = 0;
+    bool ok = expected > sizeof(PAGE) / 2;
+    for(uint32_t i = 0; i < loads; i++){
+        live = 0;
+        peak = 0;
+        counting = true;
+        ok &= (load(port, path) == expected);
+        //the server lets go of the request after the client saw the close
+        delay(2);
+        counting = false;
+        if(peak > worst){
+            worst = peak;
+        }
+    }
+    printf("%-7s: %5.1f allocations, %7.0f bytes per load | %6lld bytes peak%s\n", name,
+        (double)allocations / loads, (double)allocated / loads, (long long)worst, ok ? "" : " | BAD RESPONSE");
+}
+
+int main(int argc, char ** argv){
+    uint32_t loads = (argc > 1) ? atoi(argv[1]) : 500;
+    uint16_t port = (argc > 2) ? atoi(argv[2]) : 18090;
+
+    makePage();
+    AsyncWebServer server(port);
+    server.on("/string", HTTP_GET, [](AsyncWebServerRequest *request){
+        String page = PAGE;
+        page.replace("TEMP_VALUE", String(21.5f, 1));
+        page.replace("HUM_VALUE", String(40.0f, 1));
+        request->send(200, "text/html", page);
+    });
+    server.on("/progmem", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->send_P(200, "text/html", PAGE);
+    });
+    server.on("/flash", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->sendFlash(200, "text/html", PAGE);
+    });
+    server.begin();
+
+    printf("%u loads of a %u byte page\n", loads, (unsigned)strlen(PAGE));
+    run("string", port, "/string", loads);
+    run("send_P", port, "/progmem", loads);
+    run("flash", port, "/flash", loads);
+    return 0;
+}
@@ -0,0 +1,461 @@
+/*
+  Host benchmark: request head parsing, String lines vs arena slices
+
+  Feeds the head of a browser GET (13 headers, a query string) to a request
+  the way AsyncTCP delivers it, [segment] bytes per packet (0: all in one),
+  and counts every malloc, calloc and realloc made while it is parsed, the
+  request is answered and deleted.
+
+  "string" is the old parser, copied below: each line is concatenated into a
+  String, split with indexOf/substring, and every header becomes an
+  AsyncWebHeader with two Strings before the uninteresting ones are removed.
+  "arena" is AsyncWebServerRequest as it is now: lines are copied once into
+  the request's arena and headers stay slices into it.
+
+  The handler does not answer, so no response is part of the numbers. With
+  "any" it keeps every header like server.on() does, with "one" it keeps only
+  If-None-Match like serveStatic() does.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -I../../AsyncTCP-main/host/include -I../../AsyncTCP-main/src -I../src request_parser_bench.cpp ../src/*.cpp ../../AsyncTCP-main/src/AsyncTCPClient.cpp ../../AsyncTCP-main/host/src/*.cpp -o request_parser_bench -lpthread
+//  ./request_parser_bench [requests] [segment]
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <chrono>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static bool counting = false;
+static uint64_t allocations = 0;
+
+extern "C" void *malloc(size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr){
+    __libc_free(ptr);
+}
+
+static const char REQUEST[] =
+    "GET /sensors?unit=celsius&room=living%20room HTTP/1.1\r\n"
+    "Host: 192.168.4.1\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Referer: http://192.168.4.1/\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "If-None-Match: \"5f3a1c\"\r\n"
+    "DNT: 1\r\n"
+    "Sec-GPC: 1\r\n"
+    "Pragma: no-cache\r\n"
+    "\r\n";
+
+/*
+ * The parser before the arena, as it was in WebRequest.cpp
+ * */
+
+enum { PARSE_REQ_START, PARSE_REQ_HEADERS, PARSE_REQ_BODY, PARSE_REQ_END, PARSE_REQ_FAIL };
+
+static bool strContains(String src, String find, bool mindcase = true) {
+  int pos=0, i=0;
+  const int slen = src.length();
+  const int flen = find.length();
+
+  if (slen < flen) return false;
+  while (pos <= (slen - flen)) {
+    for (i=0; i < flen; i++) {
+      if (mindcase) {
+        if (src[pos+i] != find[i]) i = flen + 1; // no match
+      } else if (tolower(src[pos+i]) != tolower(find[i])) i = flen + 1; // no match
+    }
+    if (i == flen) return true;
+    pos++;
+  }
+  return false;
+}
+
+struct StringParser {
+  AsyncWebHandler* _handler;
+  AsyncWebServerRequest* _request; //only to hand to the handler
+  StringArray _interestingHeaders;
+  String _temp;
+  uint8_t _parseState;
+  uint8_t _version;
+  WebRequestMethodComposite _method;
+  String _url;
+  String _host;
+  String _contentType;
+  String _boundary;
+  String _authorization;
+  RequestedConnectionType _reqconntype;
+  bool _isDigest;
+  bool _isMultipart;
+  bool _keepAlive;
+  bool _expectingContinue;
+  size_t _contentLength;
+  LinkedList<AsyncWebHeader *> _headers;
+  LinkedList<AsyncWebParameter *> _params;
+
+  StringParser(AsyncWebHandler* handler)
+    : _handler(handler)
+    , _request(NULL)
+    , _temp()
+    , _parseState(0)
+    , _version(0)
+    , _method(HTTP_ANY)
+    , _reqconntype(RCT_HTTP)
+    , _isDigest(false)
+    , _isMultipart(false)
+    , _keepAlive(false)
+    , _expectingContinue(false)
+    , _contentLength(0)
+    , _headers(LinkedList<AsyncWebHeader *>([](AsyncWebHeader *h){ delete h; }))
+    , _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p){ delete p; }))
+  {}
+
+  ~StringParser(){
+    _headers.free();
+    _params.free();
+    _interestingHeaders.free();
+  }
+
+  String urlDecode(const String& text) const {
+    char temp[] = "0x00";
+    unsigned int len = text.length();
+    unsigned int i = 0;
+    String decoded = String();
+    decoded.reserve(len);
+    while (i < len){
+      char decodedChar;
+      char encodedChar = text.charAt(i++);
+      if ((encodedChar == '%') && (i + 1 < len)){
+        temp[2] = text.charAt(i++);
+        temp[3] = text.charAt(i++);
+        decodedChar = strtol(temp, NULL, 16);
+      } else if (encodedChar == '+') {
+        decodedChar = ' ';
+      } else {
+        decodedChar = encodedChar;
+      }
+      decoded.concat(decodedChar);
+    }
+    return decoded;
+  }
+
+  void _addGetParams(const String& params){
+    size_t start = 0;
+    while (start < params.length()){
+      int end = params.indexOf('&', start);
+      if (end < 0) end = params.length();
+      int equal = params.indexOf('=', start);
+      if (equal < 0 || equal > end) equal = end;
+      String name = params.substring(start, equal);
+      String value = equal + 1 < end ? params.substring(equal + 1, end) : String();
+      _params.add(new AsyncWebParameter(urlDecode(name), urlDecode(value)));
+      start = end + 1;
+    }
+  }
+
+  bool _parseReqHead(){
+    int index = _temp.indexOf(' ');
+    String m = _temp.substring(0, index);
+    index = _temp.indexOf(' ', index+1);
+    String u = _temp.substring(m.length()+1, index);
+    _temp = _temp.substring(index+1);
+
+    if(m == "GET"){
+      _method = HTTP_GET;
+    } else if(m == "POST"){
+      _method = HTTP_POST;
+    } else if(m == "DELETE"){
+      _method = HTTP_DELETE;
+    } else if(m == "PUT"){
+      _method = HTTP_PUT;
+    } else if(m == "PATCH"){
+      _method = HTTP_PATCH;
+    } else if(m == "HEAD"){
+      _method = HTTP_HEAD;
+    } else if(m == "OPTIONS"){
+      _method = HTTP_OPTIONS;
+    }
+
+    String g = String();
+    index = u.indexOf('?');
+    if(index > 0){
+      g = u.substring(index +1);
+      u = u.substring(0, index);
+    }
+    _url = urlDecode(u);
+    _addGetParams(g);
+
+    if(!_temp.startsWith("HTTP/1.0"))
+      _version = 1;
+    _keepAlive = _version;
+
+    _temp = String();
+    return true;
+  }
+
+  bool _parseReqHeader(){
+    int index = _temp.indexOf(':');
+    if(index){
+      String name = _temp.substring(0, index);
+      String value = _temp.substring(index + 2);
+      if(name.equalsIgnoreCase("Host")){
+        _host = value;
+      } else if(name.equalsIgnoreCase("Content-Type")){
+        _contentType = value.substring(0, value.indexOf(';'));
+        if (value.startsWith("multipart/")){
+          _boundary = value.substring(value.indexOf('=')+1);
+          _boundary.replace("\"","");
+          _isMultipart = true;
+        }
+      } else if(name.equalsIgnoreCase("Content-Length")){
+        _contentLength = atoi(value.c_str());
+      } else if(name.equalsIgnoreCase("Connection")){
+        if(strContains(value, "close", false)){
+          _keepAlive = false;
+        } else if(strContains(value, "keep-alive", false)){
+          _keepAlive = true;
+        }
+      } else if(name.equalsIgnoreCase("Expect") && value == "100-continue"){
+        _expectingContinue = true;
+      } else if(name.equalsIgnoreCase("Authorization")){
+        if(value.length() > 5 && value.substring(0,5).equalsIgnoreCase("Basic")){
+          _authorization = value.substring(6);
+        } else if(value.length() > 6 && value.substring(0,6).equalsIgnoreCase("Digest")){
+          _isDigest = true;
+          _authorization = value.substring(7);
+        }
+      } else {
+        if(name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket")){
+          _reqconntype = RCT_WS;
+        } else {
+          if(name.equalsIgnoreCase("Accept") && strContains(value, "text/event-stream", false)){
+            _reqconntype = RCT_EVENT;
+          }
+        }
+      }
+      _headers.add(new AsyncWebHeader(name, value));
+    }
+    _temp = String();
+    return true;
+  }
+
+  void _removeNotInterestingHeaders(){
+    if (_interestingHeaders.containsIgnoreCase("ANY")) return;
+    for(const auto& header: _headers){
+        if(!_interestingHeaders.containsIgnoreCase(header->name().c_str())){
+          _headers.remove(header);
+        }
+    }
+  }
+
+  void _parseLine(){
+    if(_parseState == PARSE_REQ_START){
+      if(!_temp.length()){
+        _parseState = PARSE_REQ_FAIL;
+      } else {
+        _parseReqHead();
+        _parseState = PARSE_REQ_HEADERS;
+      }
+      return;
+    }
+    if(_parseState == PARSE_REQ_HEADERS){
+      if(!_temp.length()){
+        //the handler is attached here, it names the headers it wants
+        _handler->canHandle(_request);
+        _removeNotInterestingHeaders();
+        _parseState = PARSE_REQ_END;
+      } else _parseReqHeader();
+    }
+  }
+
+  void _onData(void *buf, size_t len){
+    size_t i = 0;
+    while (true) {
+    if(_parseState < PARSE_REQ_BODY){
+      char *str = (char*)buf;
+      for (i = 0; i < len; i++) {
+        if (str[i] == '\n') {
+          break;
+        }
+      }
+      if (i == len) {
+        char ch = str[len-1];
+        str[len-1] = 0;
+        _temp.reserve(_temp.length()+len);
+        _temp.concat(str);
+        _temp.concat(ch);
+      } else {
+        str[i] = 0;
+        _temp.concat(str);
+        _temp.trim();
+        _parseLine();
+        if (++i < len) {
+          buf = str+i;
+          len-= i;
+          continue;
+        }
+      }
+    }
+    break;
+    }
+  }
+};
+
+/*
+ * Handlers
+ * */
+
+class KeepHandler : public AsyncWebHandler {
+  public:
+    const char* _keep;
+    size_t _seen;
+    KeepHandler(const char* keep): _keep(keep), _seen(0) {}
+    bool canHandle(AsyncWebServerRequest *request) override {
+      if(request != NULL){
+        request->addInterestingHeader(_keep);
+      }
+      return true;
+    }
+    void handleRequest(AsyncWebServerRequest *request) override {
+      //what a handler typically looks at
+      _seen += request->url().length() + request->headers();
+    }
+};
+
+//StringParser has no request to hand to canHandle(), this one names its headers itself
+class StringKeepHandler : public KeepHandler {
+  public:
+    StringParser* _parser;
+    StringKeepHandler(const char* keep): KeepHandler(keep), _parser(NULL) {}
+    bool canHandle(AsyncWebServerRequest *request) override {
+      (void)request;
+      _parser->_interestingHeaders.add(_keep);
+      return true;
+    }
+};
+
+/*
+ * Runs
+ * */
+
+struct Result {
+    double per_second;
+    double allocations;
+};
+
+static double now_s(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t next_segment(size_t offset, size_t segment){
+    size_t left = sizeof(REQUEST) - 1 - offset;
+    return (segment && segment < left) ? segment : left;
+}
+
+static Result run_string(const char* keep, uint32_t requests, size_t segment){
+    StringKeepHandler handler(keep);
+    char buffer[sizeof(REQUEST)];
+    allocations = 0;
+    double start = now_s();
+    for(uint32_t r = 0; r < requests; r++){
+        counting = true;
+        StringParser* parser = new StringParser(&handler);
+        handler._parser = parser;
+        for(size_t offset = 0; offset < sizeof(REQUEST) - 1; ){
+            size_t len = next_segment(offset, segment);
+            //the old parser writes into the packet
+            memcpy(buffer, REQUEST + offset, len);
+            parser->_onData(buffer, len);
+            offset += len;
+        }
+        handler._seen += parser->_url.length() + parser->_headers.length();
+        delete parser;
+        counting = false;
+    }
+    Result result;
+    result.per_second = requests / (now_s() - start);
+    result.allocations = (double)allocations / requests;
+    return result;
+}
+
+static Result run_arena(AsyncWebServer& server, AsyncClient& client, const char* keep, uint32_t requests, size_t segment){
+    KeepHandler& handler = (KeepHandler&)server.addHandler(new KeepHandler(keep));
+    allocations = 0;
+    double start = now_s();
+    for(uint32_t r = 0; r < requests; r++){
+        //the packets LwIP would hand over, they are not counted
+        pbuf* head = NULL;
+        pbuf** tail = &head;
+        for(size_t offset = 0; offset < sizeof(REQUEST) - 1; ){
+            size_t len = next_segment(offset, segment);
+            pbuf* pb = (pbuf*)__libc_malloc(sizeof(pbuf) + len);
+            pb->next = NULL;
+            pb->payload = pb + 1;
+            pb->len = pb->tot_len = len;
+            memcpy(pb->payload, REQUEST + offset, len);
+            *tail = pb;
+            tail = &pb->next;
+            offset += len;
+        }
+        counting = true;
+        AsyncWebServerRequest* request = new AsyncWebServerRequest(&server, &client);
+        client._recv(NULL, head, 0);
+        delete request;
+        counting = false;
+    }
+    Result result;
+    result.per_second = requests / (now_s() - start);
+    result.allocations = (double)allocations / requests;
+    server.removeHandler(&handler);
+    return result;
+}
+
+static void print(const char* name, const char* keep, const Result& r){
+    printf("%-6s keep %-3s: %9.0f heads/s | %5.1f allocations per request\n", name, keep, r.per_second, r.allocations);
+}
+
+int main(int argc, char ** argv){
+    uint32_t requests = (argc > 1) ? atoi(argv[1]) : 200000;
+    size_t segment = (argc > 2) ? atoi(argv[2]) : 0;
+
+    //begin() starts the request pool, the server itself is never connected to
+    AsyncWebServer server(0);
+    server.begin();
+    AsyncClient client;
+
+    printf("%u requests, %u byte head in %s\n", requests, (unsigned)(sizeof(REQUEST) - 1),
+        segment ? (String(segment) + " byte packets").c_str() : "one packet");
+    print("string", "any", run_string("ANY", requests, segment));
+    print("arena", "any", run_arena(server, client, "ANY", requests, segment));
+    print("string", "one", run_string("If-None-Match", requests, segment));
+    print("arena", "one", run_arena(server, client, "If-None-Match", requests, segment));
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+  Host benchmark: path parameter routes, regex per request vs compiled regex vs {name} segments
+
+  The routes of examples/regex_patterns: "/", a sensor number and a sensor
+  number with an action. Requests alternate between /sensor/42 and
+  /sensor/42/action/on, the handler reads both path arguments and does not
+  answer. Every malloc, calloc and realloc made while the request is parsed,
+  routed and deleted is counted.
+
+  "regex/request" is the regex handler as it was, copied below: std::regex is
+  built from the uri for every request, the url is copied into a std::string
+  and every group becomes a new String. "regex" is AsyncCallbackWebHandler as
+  it is now, compiled once in setUri() with the groups kept as slices of the
+  url. "segment" are the same routes written as /sensor/{id}, matched by the
+  router without a regex.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -DASYNCWEBSERVER_REGEX -I../../AsyncTCP-main/host/include -I../../AsyncTCP-main/src -I../src route_bench.cpp ../src/*.cpp ../../AsyncTCP-main/src/AsyncTCPClient.cpp ../../AsyncTCP-main/host/src/*.cpp -o route_bench -lpthread
+//  ./route_bench [requests]
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <chrono>
+#include <regex>
+
+#ifndef ASYNCWEBSERVER_REGEX
+#error build with -DASYNCWEBSERVER_REGEX
+#endif
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static bool counting = false;
+static uint64_t allocations = 0;
+
+extern "C" void *malloc(size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr){
+    __libc_free(ptr);
+}
+
+static const char* REQUESTS[] = {
+    "GET /sensor/42 HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n",
+    "GET /sensor/42/action/on HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n",
+};
+
+static const char* SENSOR_REGEX = "^\\/sensor\\/([0-9]+)$";
+static const char* ACTION_REGEX = "^\\/sensor\\/([0-9]+)\\/action\\/([a-zA-Z0-9]+)$";
+
+static size_t seen = 0;
+
+/*
+ * The regex handler before it was compiled once, as it was in WebHandlerImpl.h
+ * */
+
+class RegexPerRequestHandler : public AsyncWebHandler {
+  public:
+    String _uri;
+    LinkedList<String *> _pathParams;
+    RegexPerRequestHandler(const char* uri): _uri(uri), _pathParams([](String *p){ delete p; }) {}
+    bool canHandle(AsyncWebServerRequest *request) override {
+      std::regex pattern(_uri.c_str());
+      std::smatch matches;
+      std::string s(request->url().c_str());
+      if(std::regex_search(s, matches, pattern)) {
+        for (size_t i = 1; i < matches.size(); ++i) { // start from 1
+          _pathParams.add(new String(matches[i].str().c_str()));
+        }
+      } else {
+        return false;
+      }
+      request->addInterestingHeader("ANY");
+      return true;
+    }
+    void handleRequest(AsyncWebServerRequest *request) override {
+      (void)request;
+      for(const auto& p: _pathParams){
+        seen += p->length();
+      }
+      //the request used to delete them with itself
+      _pathParams.free();
+    }
+};
+
+static void readSlices(AsyncWebServerRequest *request){
+    for(size_t i = 0; i < request->pathArgs(); i++){
+        size_t len;
+        request->pathArg(i, &len);
+        seen += len;
+    }
+}
+
+static double now_s(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Result {
+    double per_second;
+    double allocations;
+};
+
+static Result run(AsyncWebServer& server, AsyncClient& client, uint32_t requests){
+    allocations = 0;
+    double start = now_s();
+    for(uint32_t r = 0; r < requests; r++){
+        //the packet LwIP would hand over, it is not counted
+        const char* head = REQUESTS[r & 1];
+        size_t len = strlen(head);
+        pbuf* pb = (pbuf*)__libc_malloc(sizeof(pbuf) + len);
+        pb->next = NULL;
+        pb->payload = pb + 1;
+        pb->len = pb->tot_len = len;
+        memcpy(pb->payload, head, len);
+        counting = true;
+        AsyncWebServerRequest* request = new AsyncWebServerRequest(&server, &client);
+        client._recv(NULL, pb, 0);
+        delete request;
+        counting = false;
+    }
+    Result result;
+    result.per_second = requests / (now_s() - start);
+    result.allocations = (double)allocations / requests;
+    return result;
+}
+
+static void print(const char* name, const Result& r){
+    printf("%-14s: %9.0f requests/s | %5.1f allocations per request\n", name, r.per_second, r.allocations);
+}
+
+static void regexPerRequest(AsyncWebServer& server){
+    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){ (void)request; });
+    server.addHandler(new RegexPerRequestHandler(SENSOR_REGEX));
+    server.addHandler(new RegexPerRequestHandler(ACTION_REGEX));
+}
+
+static void regexCompiled(AsyncWebServer& server){
+    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){ (void)request; });
+    server.on(SENSOR_REGEX, HTTP_GET, readSlices);
+    server.on(ACTION_REGEX, HTTP_GET, readSlices);
+}
+
+static void segments(AsyncWebServer& server){
+    //the longer route first, /sensor/{id} also answers everything below it
+    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){ (void)request; });
+    server.on("/sensor/{id}/action/{action}", HTTP_GET, readSlices);
+    server.on("/sensor/{id}", HTTP_GET, readSlices);
+}
+
+static Result bench(void (*setup)(AsyncWebServer&), uint32_t requests){
+    //handlers go in before begin(), which compiles their routes and starts the
+    //request pool. The server itself is never connected to
+    AsyncWebServer server(0);
+    setup(server);
+    server.begin();
+    AsyncClient client;
+    return run(server, client, requests);
+}
+
+int main(int argc, char ** argv){
+    uint32_t requests = (argc > 1) ? atoi(argv[1]) : 100000;
+
+    printf("%u requests, two regex_patterns routes\n", requests);
+    print("regex/request", bench(regexPerRequest, requests));
+    print("regex", bench(regexCompiled, requests));
+    print("segment", bench(segments, requests));
+
+    return seen == 0;
+}
@@ -32,6 +32,52 @@
 
 #define MAX_PRINTF_LEN 64
 
+//lets a byte buffer be read and written as words without breaking aliasing rules
+typedef uint32_t __attribute__((__may_alias__)) ws_mask_word_t;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+typedef uint32_t __attribute__((__vector_size__(16), __may_alias__)) ws_mask_vector_t;
+#endif
+
+/*
+ * Masking
+ * The key is rotated to the phase of the first byte, a few bytes are done
+ * one by one until the data is word aligned (the Xtensa cores fault on an
+ * unaligned word), then a word, or on the host 16 bytes, at a time.
+ */
+
+uint8_t webSocketMask(uint8_t *data, size_t len, const uint8_t *mask, uint8_t phase){
+  phase &= 3;
+  while(len && ((uintptr_t)data & 3)){
+    *data++ ^= mask[phase];
+    phase = (phase + 1) & 3;
+    len--;
+  }
+  if(len >= 4){
+    uint8_t key[4] = { mask[phase], mask[(phase + 1) & 3], mask[(phase + 2) & 3], mask[(phase + 3) & 3] };
+    uint32_t word;
+    memcpy(&word, key, 4);
+    ws_mask_word_t *words = (ws_mask_word_t *)data;
+    size_t count = len / 4;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    ws_mask_vector_t wide = { word, word, word, word };
+    for(; count >= 4 && ((uintptr_t)words & 15); count--)
+      *words++ ^= word;
+    for(; count >= 4; count -= 4, words += 4)
+      *(ws_mask_vector_t *)words ^= wide;
+#endif
+    for(; count; count--)
+      *words++ ^= word;
+    data = (uint8_t *)words;
+    len &= 3;
+  }
+  //a whole number of words leaves the phase where it was
+  while(len--){
+    *data++ ^= mask[phase];
+    phase = (phase + 1) & 3;
+  }
+  return phase;
+}
+
 size_t webSocketSendFrameWindow(AsyncClient *client){
   if(!client->canSend())
     return 0;
@@ -64,12 +110,7 @@ size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool
 
   if(len > space) len = space;
 
-  uint8_t *buf = (uint8_t*)malloc(headLen);
-  if(buf == NULL){
-    //os_printf("could not malloc %u bytes for frame header\n", headLen);
-    return 0;
-  }
-
+  uint8_t buf[8];
   buf[0] = opcode & 0x0F;
   if(final)
     buf[0] |= 0x80;
@@ -83,26 +124,37 @@ size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool
   if(len && mask){
     buf[1] |= 0x80;
     memcpy(buf + (headLen - 4), mbuf, 4);
+    webSocketMask(data, len, mbuf, 0);
+  }
+
+#if defined(ESP32)
+  //header, payload and output in one call into the TCP stack
+  async_tcp_segment_t segments[2] = {
+    { (const char *)buf, headLen, ASYNC_WRITE_FLAG_COPY },
+    { (const char *)data, len, ASYNC_WRITE_FLAG_COPY }
+  };
+  size_t written = client->writev(segments, len ? 2 : 1);
+  if(written != headLen + len){
+    //os_printf("error writing %lu frame bytes\n", headLen + len);
+    if(!written && len && mask){
+      //nothing went out, leave the payload as it was for the retry
+      webSocketMask(data, len, mbuf, 0);
+    }
+    return 0;
   }
+#else
   if(client->add((const char *)buf, headLen) != headLen){
     //os_printf("error adding %lu header bytes\n", headLen);
-    free(buf);
     return 0;
   }
-  free(buf);
-
   if(len){
-    if(len && mask){
-      size_t i;
-      for(i=0;i<len;i++)
-        data[i] = data[i] ^ mbuf[i%4];
-    }
     if(client->add((const char *)data, len) != len){
       //os_printf("error adding %lu data bytes\n", len);
       return 0;
     }
   }
   if (!client->send()) return 0;
+#endif
   return len;
 }
 
@@ -455,6 +507,61 @@ AsyncWebSocketMultiMessage::~AsyncWebSocketMultiMessage() {
 }
 
 
+/*
+ * Shared Frame
+ * The header is written once in front of the payload, so every client
+ * sends the same bytes as they are. The object, header and payload are
+ * one allocation.
+ */
+
+AsyncWebSocketSharedFrame::AsyncWebSocketSharedFrame(uint8_t opcode, size_t len)
+  :_refs(1)
+  ,_len(len)
+  ,_headLen(2)
+{
+  if(len > 0xFFFF)
+    _headLen = 10;
+  else if(len > 125)
+    _headLen = 4;
+  uint8_t * buf = _frame();
+  buf[0] = 0x80 | (opcode & 0x0F);
+  if(len < 126){
+    buf[1] = len;
+  } else if(_headLen == 4){
+    buf[1] = 126;
+    buf[2] = (uint8_t)(len >> 8);
+    buf[3] = (uint8_t)len;
+  } else {
+    buf[1] = 127;
+    for(int i = 0; i < 8; i++)
+      buf[9 - i] = (uint8_t)((uint64_t)len >> (i * 8));
+  }
+}
+
+AsyncWebSocketSharedFrame * AsyncWebSocketSharedFrame::create(uint8_t opcode, size_t len){
+  size_t headLen = (len > 0xFFFF) ? 10 : ((len > 125) ? 4 : 2);
+  void * mem = malloc(sizeof(AsyncWebSocketSharedFrame) + headLen + len);
+  if(mem == NULL)
+    return NULL;
+  return new (mem) AsyncWebSocketSharedFrame(opcode, len);
+}
+
+AsyncWebSocketSharedFrame * AsyncWebSocketSharedFrame::create(uint8_t opcode, const uint8_t * data, size_t len){
+  AsyncWebSocketSharedFrame * frame = create(opcode, len);
+  if(frame != NULL && len)
+    memcpy(frame->payload(), data, len);
+  return frame;
+}
+
+void AsyncWebSocketSharedFrame::unref(){
+  //the last reference can be dropped on the async task while the loop drops its own
+  if(_refs.fetch_sub(1, std::memory_order_acq_rel) == 1){
+    this->~AsyncWebSocketSharedFrame();
+    free(this);
+  }
+}
+
+
 /*
  * Async WebSocket Client
  */
@@ -463,7 +570,13 @@ AsyncWebSocketMultiMessage::~AsyncWebSocketMultiMessage() {
 
 AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server)
   : _controlQueue(LinkedList<AsyncWebSocketControl *>([](AsyncWebSocketControl *c){ delete  c; }))
-  , _messageQueue(LinkedList<AsyncWebSocketMessage *>([](AsyncWebSocketMessage *m){ delete  m; }))
+  , _queueHead(0)
+  , _queueLength(0)
+  , _frameSent(0)
+  , _frameAcked(0)
+  , _queueHighWater(0)
+  , _conflated(0)
+  , _dropped(0)
   , _tempObject(NULL)
 {
   _client = request->client();
@@ -471,6 +584,11 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
   _clientId = _server->_getNextId();
   _status = WS_CONNECTED;
   _pstate = 0;
+  _pheadLen = 0;
+  _pcontrol = NULL;
+  _pmessage = NULL;
+  _pmessageLen = 0;
+  _pdrop = false;
   _lastMessageTime = millis();
   _keepAlivePeriod = 0;
   _client->setRxTimeout(0);
@@ -480,18 +598,23 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
   _client->onTimeout([](void *r, AsyncClient* c, uint32_t time){ (void)c; ((AsyncWebSocketClient*)(r))->_onTimeout(time); }, this);
   _client->onData([](void *r, AsyncClient* c, void *buf, size_t len){ (void)c; ((AsyncWebSocketClient*)(r))->_onData(buf, len); }, this);
   _client->onPoll([](void *r, AsyncClient* c){ (void)c; ((AsyncWebSocketClient*)(r))->_onPoll(); }, this);
+  _schedulePoll();
   _server->_addClient(this);
   _server->_handleEvent(this, WS_EVT_CONNECT, request, NULL, 0);
   delete request;
 }
 
 AsyncWebSocketClient::~AsyncWebSocketClient(){
-  _messageQueue.free();
+  while(_queueLength)
+    _queuePop();
+  free(_pcontrol);
+  free(_pmessage);
   _controlQueue.free();
   _server->_handleEvent(this, WS_EVT_DISCONNECT, NULL, NULL, 0);
 }
 
 void AsyncWebSocketClient::_onAck(size_t len, uint32_t time){
+  AsyncWebLockGuard l(_lock);
   _lastMessageTime = millis();
   if(!_controlQueue.isEmpty()){
     auto head = _controlQueue.front();
@@ -500,67 +623,226 @@ void AsyncWebSocketClient::_onAck(size_t len, uint32_t time){
       if(_status == WS_DISCONNECTING && head->opcode() == WS_DISCONNECT){
         _controlQueue.remove(head);
         _status = WS_DISCONNECTED;
+        //closing deletes this client and its lock
+        l.unlock();
         _client->close(true);
         return;
       }
       _controlQueue.remove(head);
     }
   }
-  if(len && !_messageQueue.isEmpty()){
-    _messageQueue.front()->ack(len, time);
+  if(len && _queueLength){
+    AsyncWebSocketQueued &front = _messageQueue[_queueHead];
+    if(front.frame != NULL){
+      size_t inFlight = _frameSent - _frameAcked;
+      _frameAcked += (len < inFlight) ? len : inFlight;
+    } else {
+      front.message->ack(len, time);
+    }
   }
   _server->_cleanBuffers();
   _runQueue();
 }
 
 void AsyncWebSocketClient::_onPoll(){
-  if(_client->canSend() && (!_controlQueue.isEmpty() || !_messageQueue.isEmpty())){
+  AsyncWebLockGuard l(_lock);
+  if(_client->canSend() && (!_controlQueue.isEmpty() || _queueLength)){
     _runQueue();
-  } else if(_keepAlivePeriod > 0 && _controlQueue.isEmpty() && _messageQueue.isEmpty() && (millis() - _lastMessageTime) >= _keepAlivePeriod){
+  } else if(_keepAlivePeriod > 0 && _controlQueue.isEmpty() && !_queueLength && (millis() - _lastMessageTime) >= _keepAlivePeriod){
     ping((uint8_t *)AWSC_PING_PAYLOAD, AWSC_PING_PAYLOAD_LEN);
   }
+  _schedulePoll();
+}
+
+//an idle client is only polled when its keepalive ping is due,
+//a stalled queue is retried every poll interval until it drains
+void AsyncWebSocketClient::_schedulePoll(){
+#if defined(ESP32)
+  if(_client == NULL)
+    return;
+  uint32_t interval = 0;
+  if(!_controlQueue.isEmpty() || _queueLength){
+    interval = ASYNC_POLL_INTERVAL;
+  } else if(_keepAlivePeriod > 0){
+    uint32_t idle = millis() - _lastMessageTime;
+    interval = (idle < _keepAlivePeriod) ? (_keepAlivePeriod - idle) : 1;
+  }
+  _client->setPollInterval(interval);
+#endif
 }
 
 void AsyncWebSocketClient::_runQueue(){
-  while(!_messageQueue.isEmpty() && _messageQueue.front()->finished()){
-    _messageQueue.remove(_messageQueue.front());
+  while(_queueLength && _frontFinished()){
+    _queuePop();
   }
 
-  if(!_controlQueue.isEmpty() && (_messageQueue.isEmpty() || _messageQueue.front()->betweenFrames()) && webSocketSendFrameWindow(_client) > (size_t)(_controlQueue.front()->len() - 1)){
+  //a control frame sent stays in front until it is acked, and must not go out twice
+  if(!_controlQueue.isEmpty() && !_controlQueue.front()->finished() && (!_queueLength || _frontBetweenFrames()) && webSocketSendFrameWindow(_client) > (size_t)(_controlQueue.front()->len() - 1)){
     _controlQueue.front()->send(_client);
-  } else if(!_messageQueue.isEmpty() && _messageQueue.front()->betweenFrames() && webSocketSendFrameWindow(_client)){
-    _messageQueue.front()->send(_client);
+  } else if(_queueLength && _messageQueue[_queueHead].frame != NULL){
+    _sendFrame();
+  } else if(_queueLength && _frontBetweenFrames() && webSocketSendFrameWindow(_client)){
+    _messageQueue[_queueHead].message->send(_client);
   }
+  _schedulePoll();
+}
+
+bool AsyncWebSocketClient::_frontFinished(){
+  AsyncWebSocketQueued &front = _messageQueue[_queueHead];
+  if(front.frame != NULL)
+    return _frameAcked == front.frame->length();
+  return front.message->finished();
+}
+
+//a control frame may only go out before the first byte of a frame or after its last
+bool AsyncWebSocketClient::_frontBetweenFrames(){
+  AsyncWebSocketQueued &front = _messageQueue[_queueHead];
+  if(front.frame != NULL)
+    return _frameSent == 0 || _frameAcked == front.frame->length();
+  return front.message->betweenFrames();
+}
+
+//the frame goes out as it is, in as many writes as the send buffer needs
+void AsyncWebSocketClient::_sendFrame(){
+  AsyncWebSocketSharedFrame *frame = _messageQueue[_queueHead].frame;
+  size_t toSend = frame->length() - _frameSent;
+  if(!toSend || !_client->canSend())
+    return;
+  size_t space = _client->space();
+  if(space < toSend)
+    toSend = space;
+  if(!toSend)
+    return;
+  const char *data = (const char *)frame->data() + _frameSent;
+#if defined(ESP32)
+  //TCP keeps pointing into the frame until the peer acks, each write holds a reference
+  frame->ref();
+  size_t sent = _client->writeRef(data, toSend, [](void *arg, AsyncClient *c, const char *d){
+    (void)c; (void)d;
+    ((AsyncWebSocketSharedFrame *)arg)->unref();
+  }, frame);
+  if(!sent)
+    frame->unref();
+#else
+  size_t sent = _client->add(data, toSend);
+  if(sent && !_client->send())
+    sent = 0;
+#endif
+  _frameSent += sent;
+}
+
+//a frame of a topic takes the place of the one still waiting. When the queue is full, the
+//oldest frame of any topic that waits makes room; without one the new message is dropped
+void AsyncWebSocketClient::_queuePush(AsyncWebSocketMessage *dataMessage, AsyncWebSocketSharedFrame *frame, uint16_t topic){
+  if(topic){
+    for(uint16_t i = 0; i < _queueLength; i++){
+      AsyncWebSocketQueued &entry = _messageQueue[(_queueHead + i) % WS_MAX_QUEUED_MESSAGES];
+      if(entry.topic == topic && _queueWaiting(i)){
+        entry.frame->unref();
+        entry.frame = frame;
+        _conflated++;
+        return;
+      }
+    }
+  }
+  if(_queueLength >= WS_MAX_QUEUED_MESSAGES){
+    _dropped++;
+    uint16_t i = 0;
+    while(i < _queueLength && !_queueWaiting(i))
+      i++;
+    if(i == _queueLength){
+      if(frame != NULL)
+        frame->unref();
+      else
+        delete dataMessage;
+      return;
+    }
+    _queueRemove(i);
+  }
+  AsyncWebSocketQueued &entry = _messageQueue[(_queueHead + _queueLength) % WS_MAX_QUEUED_MESSAGES];
+  entry.message = dataMessage;
+  entry.frame = frame;
+  entry.topic = topic;
+  _queueLength++;
+  if(_queueLength > _queueHighWater)
+    _queueHighWater = _queueLength;
+}
+
+//entry i has a topic and none of it went out yet
+bool AsyncWebSocketClient::_queueWaiting(uint16_t i){
+  return _messageQueue[(_queueHead + i) % WS_MAX_QUEUED_MESSAGES].topic && (i || !_frameSent);
+}
+
+//takes a waiting frame out of the middle of the queue
+void AsyncWebSocketClient::_queueRemove(uint16_t i){
+  _messageQueue[(_queueHead + i) % WS_MAX_QUEUED_MESSAGES].frame->unref();
+  for(; i + 1 < _queueLength; i++)
+    _messageQueue[(_queueHead + i) % WS_MAX_QUEUED_MESSAGES] = _messageQueue[(_queueHead + i + 1) % WS_MAX_QUEUED_MESSAGES];
+  _queueLength--;
+}
+
+void AsyncWebSocketClient::_queuePop(){
+  AsyncWebSocketQueued &front = _messageQueue[_queueHead];
+  if(front.frame != NULL){
+    front.frame->unref();
+    _frameSent = 0;
+    _frameAcked = 0;
+  } else {
+    delete front.message;
+  }
+  _queueHead = (_queueHead + 1) % WS_MAX_QUEUED_MESSAGES;
+  _queueLength--;
 }
 
 bool AsyncWebSocketClient::queueIsFull(){
-  if((_messageQueue.length() >= WS_MAX_QUEUED_MESSAGES) || (_status != WS_CONNECTED) ) return true;
+  if((_queueLength >= WS_MAX_QUEUED_MESSAGES) || (_status != WS_CONNECTED) ) return true;
   return false;
 }
 
+void AsyncWebSocketClient::queueStats(async_ws_queue_stats_t *stats){
+  AsyncWebLockGuard l(_lock);
+  stats->queued = _queueLength;
+  stats->high_water = _queueHighWater;
+  stats->conflated = _conflated;
+  stats->dropped = _dropped;
+}
+
 void AsyncWebSocketClient::_queueMessage(AsyncWebSocketMessage *dataMessage){
+  AsyncWebLockGuard l(_lock);
   if(dataMessage == NULL)
     return;
   if(_status != WS_CONNECTED){
     delete dataMessage;
     return;
   }
-  if(_messageQueue.length() >= WS_MAX_QUEUED_MESSAGES){
-      ets_printf("ERROR: Too many messages queued\n");
-      delete dataMessage;
-  } else {
-      _messageQueue.add(dataMessage);
-  }
+  _queuePush(dataMessage, NULL, 0);
+  if(_client->canSend())
+    _runQueue();
+  else
+    _schedulePoll();
+}
+
+void AsyncWebSocketClient::_queueFrame(AsyncWebSocketSharedFrame *frame, uint16_t topic){
+  AsyncWebLockGuard l(_lock);
+  if(frame == NULL || _status != WS_CONNECTED)
+    return;
+  frame->ref();
+  _queuePush(NULL, frame, topic);
   if(_client->canSend())
     _runQueue();
+  else
+    _schedulePoll();
 }
 
 void AsyncWebSocketClient::_queueControl(AsyncWebSocketControl *controlMessage){
+  AsyncWebLockGuard l(_lock);
   if(controlMessage == NULL)
     return;
   _controlQueue.add(controlMessage);
   if(_client->canSend())
     _runQueue();
+  else
+    _schedulePoll();
 }
 
 void AsyncWebSocketClient::close(uint16_t code, const char * message){
@@ -605,90 +887,141 @@ void AsyncWebSocketClient::_onDisconnect(){
   _server->_handleDisconnect(this);
 }
 
+//bytes the frame header starting at head takes, 0 while fewer than 2 are known
+static size_t webSocketHeaderLength(const uint8_t *head, size_t have){
+  if(have < 2)
+    return 0;
+  size_t len = 2;
+  if((head[1] & 0x7F) == 126)
+    len += 2;
+  else if((head[1] & 0x7F) == 127)
+    len += 8;
+  if(head[1] & 0x80)
+    len += 4;
+  return len;
+}
+
+//takes up to the whole header from data, returns the header once all of it is there
+const uint8_t * AsyncWebSocketClient::_gatherHeader(uint8_t *&data, size_t &plen){
+  size_t need = webSocketHeaderLength(data, plen);
+  if(!_pheadLen && need && plen >= need){
+    //all in this read, parsed where it is
+    const uint8_t *head = data;
+    data += need;
+    plen -= need;
+    return head;
+  }
+  //split across reads, kept until the rest arrives
+  do {
+    need = webSocketHeaderLength(_phead, _pheadLen);
+    size_t take = (need ? need : 2) - _pheadLen;
+    if(take > plen)
+      take = plen;
+    memcpy(_phead + _pheadLen, data, take);
+    _pheadLen += take;
+    data += take;
+    plen -= take;
+    need = webSocketHeaderLength(_phead, _pheadLen);
+  } while(plen && (!need || _pheadLen < need));
+  if(!need || _pheadLen < need)
+    return NULL;
+  _pheadLen = 0;
+  return _phead;
+}
+
 void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
   _lastMessageTime = millis();
   uint8_t *data = (uint8_t*)pbuf;
   while(plen > 0){
     if(!_pstate){
-      const uint8_t *fdata = data;
+      const uint8_t *fdata = _gatherHeader(data, plen);
+      if(fdata == NULL)
+        return;
       _pinfo.index = 0;
       _pinfo.final = (fdata[0] & 0x80) != 0;
       _pinfo.opcode = fdata[0] & 0x0F;
       _pinfo.masked = (fdata[1] & 0x80) != 0;
       _pinfo.len = fdata[1] & 0x7F;
-      data += 2;
-      plen -= 2;
+      fdata += 2;
       if(_pinfo.len == 126){
-        _pinfo.len = fdata[3] | (uint16_t)(fdata[2]) << 8;
-        data += 2;
-        plen -= 2;
+        _pinfo.len = fdata[1] | (uint16_t)(fdata[0]) << 8;
+        fdata += 2;
       } else if(_pinfo.len == 127){
-        _pinfo.len = fdata[9] | (uint16_t)(fdata[8]) << 8 | (uint32_t)(fdata[7]) << 16 | (uint32_t)(fdata[6]) << 24 | (uint64_t)(fdata[5]) << 32 | (uint64_t)(fdata[4]) << 40 | (uint64_t)(fdata[3]) << 48 | (uint64_t)(fdata[2]) << 56;
-        data += 8;
-        plen -= 8;
+        _pinfo.len = fdata[7] | (uint16_t)(fdata[6]) << 8 | (uint32_t)(fdata[5]) << 16 | (uint32_t)(fdata[4]) << 24 | (uint64_t)(fdata[3]) << 32 | (uint64_t)(fdata[2]) << 40 | (uint64_t)(fdata[1]) << 48 | (uint64_t)(fdata[0]) << 56;
+        fdata += 8;
       }
 
       if(_pinfo.masked){
-        memcpy(_pinfo.mask, data, 4);
-        data += 4;
-        plen -= 4;
+        memcpy(_pinfo.mask, fdata, 4);
+      }
+
+      if(_pinfo.opcode >= 8 && _pinfo.len > 125){
+        //not a valid control frame, and the stream cannot be followed past it
+        _client->close(true);
+        return;
+      }
+
+      //control frames may come between the fragments of a message
+      if(_pinfo.opcode < 8){
+        if(_pinfo.opcode){
+          _pinfo.message_opcode = _pinfo.opcode;
+          _pinfo.num = 0;
+        } else _pinfo.num += 1;
+      }
+
+      if(!plen && _pinfo.len){
+        //the payload comes with the next read
+        _pstate = 1;
+        return;
       }
     }
 
     const size_t datalen = std::min((size_t)(_pinfo.len - _pinfo.index), plen);
-    const auto datalast = data[datalen];
+    //the handler may terminate the payload, which overwrites the first byte of the next frame
+    const uint8_t datalast = (datalen < plen) ? data[datalen] : 0;
 
     if(_pinfo.masked){
-      for(size_t i=0;i<datalen;i++)
-        data[i] ^= _pinfo.mask[(_pinfo.index+i)%4];
+      webSocketMask(data, datalen, _pinfo.mask, _pinfo.index & 3);
+    }
+
+    if(_pinfo.opcode >= 8 && (_pinfo.index || datalen < _pinfo.len)){
+      //a control frame split across reads is put together before it is handled
+      if(_pcontrol == NULL)
+        _pcontrol = (uint8_t*)malloc(_pinfo.len);
+      if(_pcontrol == NULL){
+        _client->close(true);
+        return;
+      }
+      memcpy(_pcontrol + _pinfo.index, data, datalen);
+      _pinfo.index += datalen;
+      data += datalen;
+      plen -= datalen;
+      if(_pinfo.index < _pinfo.len){
+        _pstate = 1;
+        continue;
+      }
+      _pstate = 0;
+      bool open = _handleFrame(_pcontrol, _pinfo.len);
+      if(!open)
+        return;
+      free(_pcontrol);
+      _pcontrol = NULL;
+      continue;
     }
 
     if((datalen + _pinfo.index) < _pinfo.len){
       _pstate = 1;
-
-      if(_pinfo.index == 0){
-        if(_pinfo.opcode){
-          _pinfo.message_opcode = _pinfo.opcode;
-          _pinfo.num = 0;
-        } else _pinfo.num += 1;
-      }
-      _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, (uint8_t*)data, datalen);
+      _handleData(data, datalen);
 
       _pinfo.index += datalen;
-    } else if((datalen + _pinfo.index) == _pinfo.len){
-      _pstate = 0;
-      if(_pinfo.opcode == WS_DISCONNECT){
-        if(datalen){
-          uint16_t reasonCode = (uint16_t)(data[0] << 8) + data[1];
-          char * reasonString = (char*)(data+2);
-          if(reasonCode > 1001){
-            _server->_handleEvent(this, WS_EVT_ERROR, (void *)&reasonCode, (uint8_t*)reasonString, strlen(reasonString));
-          }
-        }
-        if(_status == WS_DISCONNECTING){
-          _status = WS_DISCONNECTED;
-          _client->close(true);
-        } else {
-          _status = WS_DISCONNECTING;
-          _client->ackLater();
-          _queueControl(new AsyncWebSocketControl(WS_DISCONNECT, data, datalen));
-        }
-      } else if(_pinfo.opcode == WS_PING){
-        _queueControl(new AsyncWebSocketControl(WS_PONG, data, datalen));
-      } else if(_pinfo.opcode == WS_PONG){
-        if(datalen != AWSC_PING_PAYLOAD_LEN || memcmp(AWSC_PING_PAYLOAD, data, AWSC_PING_PAYLOAD_LEN) != 0)
-          _server->_handleEvent(this, WS_EVT_PONG, NULL, data, datalen);
-      } else if(_pinfo.opcode < 8){//continuation or text/binary frame
-        _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, data, datalen);
-      }
     } else {
-      //os_printf("frame error: len: %u, index: %llu, total: %llu\n", datalen, _pinfo.index, _pinfo.len);
-      //what should we do?
-      break;
+      _pstate = 0;
+      if(!_handleFrame(data, datalen))
+        return;
     }
 
     // restore byte as _handleEvent may have added a null terminator i.e., data[len] = 0;
-    if (datalen > 0)
+    if (datalen < plen)
       data[datalen] = datalast;
 
     data += datalen;
@@ -696,6 +1029,92 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
   }
 }
 
+//the last part of a frame, or a whole control frame; false once the connection is closed
+bool AsyncWebSocketClient::_handleFrame(uint8_t *data, size_t datalen){
+  if(_pinfo.opcode == WS_DISCONNECT){
+    if(datalen >= 2){
+      uint16_t reasonCode = (uint16_t)(data[0] << 8) + data[1];
+      char * reasonString = (char*)(data+2);
+      if(reasonCode > 1001){
+        _server->_handleEvent(this, WS_EVT_ERROR, (void *)&reasonCode, (uint8_t*)reasonString, datalen - 2);
+      }
+    }
+    if(_status == WS_DISCONNECTING){
+      _status = WS_DISCONNECTED;
+      //this deletes the client
+      _client->close(true);
+      return false;
+    } else {
+      _status = WS_DISCONNECTING;
+      _client->ackLater();
+      _queueControl(new AsyncWebSocketControl(WS_DISCONNECT, data, datalen));
+    }
+  } else if(_pinfo.opcode == WS_PING){
+    _queueControl(new AsyncWebSocketControl(WS_PONG, data, datalen));
+  } else if(_pinfo.opcode == WS_PONG){
+    if(datalen != AWSC_PING_PAYLOAD_LEN || memcmp(AWSC_PING_PAYLOAD, data, AWSC_PING_PAYLOAD_LEN) != 0)
+      _server->_handleEvent(this, WS_EVT_PONG, NULL, data, datalen);
+  } else if(_pinfo.opcode < 8){//continuation or text/binary frame
+    _handleData(data, datalen);
+  }
+  return true;
+}
+
+//a piece of a data frame, handed on as it is or kept until the message is whole
+void AsyncWebSocketClient::_handleData(uint8_t *data, size_t datalen){
+  const size_t maxLen = _server->wholeMessages();
+  if(!maxLen){
+    _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, data, datalen);
+    return;
+  }
+  if(_pdrop)
+    return;
+
+  if(!_pinfo.index){
+    if(_pinfo.final && !_pmessageLen && datalen == _pinfo.len && datalen <= maxLen){
+      //a whole message in one read, handed over where it is
+      AwsFrameInfo info = _pinfo;
+      info.opcode = info.message_opcode;
+      info.num = 0;
+      _server->_handleEvent(this, WS_EVT_DATA, (void *)&info, data, datalen);
+      return;
+    }
+    //one byte more, for the terminator handlers like to write
+    const bool fits = _pinfo.len <= maxLen - _pmessageLen;
+    uint8_t *grown = NULL;
+    if(fits)
+      grown = (uint8_t*)realloc(_pmessage, _pmessageLen + _pinfo.len + 1);
+    if(grown == NULL){
+      free(_pmessage);
+      _pmessage = NULL;
+      _pmessageLen = 0;
+      //the rest of the stream cannot be followed without the message
+      _pdrop = true;
+      close(fits ? 1011 : 1009);
+      return;
+    }
+    _pmessage = grown;
+  }
+  memcpy(_pmessage + _pmessageLen + _pinfo.index, data, datalen);
+  if((_pinfo.index + datalen) < _pinfo.len)
+    return;
+  _pmessageLen += _pinfo.len;
+  if(!_pinfo.final)
+    return;
+
+  AwsFrameInfo info = _pinfo;
+  info.opcode = info.message_opcode;
+  info.num = 0;
+  info.index = 0;
+  info.len = _pmessageLen;
+  _pmessage[_pmessageLen] = 0;
+  uint8_t *message = _pmessage;
+  _pmessage = NULL;
+  _pmessageLen = 0;
+  _server->_handleEvent(this, WS_EVT_DATA, (void *)&info, message, info.len);
+  free(message);
+}
+
 size_t AsyncWebSocketClient::printf(const char *format, ...) {
   va_list arg;
   va_start(arg, format);
@@ -825,6 +1244,17 @@ void AsyncWebSocketClient::binary(AsyncWebSocketMessageBuffer * buffer)
   _queueMessage(new AsyncWebSocketMultiMessage(buffer, WS_BINARY));
 }
 
+void AsyncWebSocketClient::textLatest(uint16_t topic, const char * message, size_t len){
+  AsyncWebSocketSharedFrame * frame = AsyncWebSocketSharedFrame::create(WS_TEXT, (const uint8_t *)message, len);
+  if(frame == NULL)
+    return;
+  _queueFrame(frame, topic);
+  frame->unref();
+}
+void AsyncWebSocketClient::textLatest(uint16_t topic, const String &message){
+  textLatest(topic, message.c_str(), message.length());
+}
+
 IPAddress AsyncWebSocketClient::remoteIP() {
     if(!_client) {
         return IPAddress((uint32_t)0);
@@ -850,6 +1280,7 @@ AsyncWebSocket::AsyncWebSocket(const String& url)
   ,_clients(LinkedList<AsyncWebSocketClient *>([](AsyncWebSocketClient *c){ delete c; }))
   ,_cNextId(1)
   ,_enabled(true)
+  ,_maxMessageLen(0)
   ,_buffers(LinkedList<AsyncWebSocketMessageBuffer *>([](AsyncWebSocketMessageBuffer *b){ delete b; }))
 {
   _eventHandler = NULL;
@@ -945,20 +1376,34 @@ void AsyncWebSocket::text(uint32_t id, const char * message, size_t len){
 
 void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer * buffer){
   if (!buffer) return;
-  buffer->lock();
-  for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED){
-        c->text(buffer);
-    }
-  }
-  buffer->unlock();
+  _broadcast(WS_TEXT, buffer->get(), buffer->length());
   _cleanBuffers();
 }
 
 
 void AsyncWebSocket::textAll(const char * message, size_t len){
-  AsyncWebSocketMessageBuffer * WSBuffer = makeBuffer((uint8_t *)message, len);
-    textAll(WSBuffer);
+  _broadcast(WS_TEXT, (const uint8_t *)message, len);
+}
+
+//the frame is built once and every client queue holds a reference to it
+void AsyncWebSocket::_broadcast(uint8_t opcode, const uint8_t * data, size_t len, uint16_t topic){
+  if(!count())
+    return;
+  AsyncWebSocketSharedFrame * frame = AsyncWebSocketSharedFrame::create(opcode, data, len);
+  if(frame == NULL)
+    return;
+  messageAll(frame, topic);
+  frame->unref();
+}
+
+void AsyncWebSocket::textLatestAll(uint16_t topic, const char * message, size_t len){
+  _broadcast(WS_TEXT, (const uint8_t *)message, len, topic);
+}
+void AsyncWebSocket::textLatestAll(uint16_t topic, const String &message){
+  textLatestAll(topic, message.c_str(), message.length());
+}
+void AsyncWebSocket::binaryLatestAll(uint16_t topic, const uint8_t * message, size_t len){
+  _broadcast(WS_BINARY, message, len, topic);
 }
 
 void AsyncWebSocket::binary(uint32_t id, const char * message, size_t len){
@@ -968,19 +1413,13 @@ void AsyncWebSocket::binary(uint32_t id, const char * message, size_t len){
 }
 
 void AsyncWebSocket::binaryAll(const char * message, size_t len){
-  AsyncWebSocketMessageBuffer * buffer = makeBuffer((uint8_t *)message, len);
-  binaryAll(buffer);
+  _broadcast(WS_BINARY, (const uint8_t *)message, len);
 }
 
 void AsyncWebSocket::binaryAll(AsyncWebSocketMessageBuffer * buffer)
 {
   if (!buffer) return;
-  buffer->lock();
-    for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED)
-      c->binary(buffer);
-  }
-  buffer->unlock();
+  _broadcast(WS_BINARY, buffer->get(), buffer->length());
   _cleanBuffers();
 }
 
@@ -998,6 +1437,13 @@ void AsyncWebSocket::messageAll(AsyncWebSocketMultiMessage *message){
   _cleanBuffers();
 }
 
+void AsyncWebSocket::messageAll(AsyncWebSocketSharedFrame *frame, uint16_t topic){
+  for(const auto& c: _clients){
+    if(c->status() == WS_CONNECTED)
+      c->message(frame, topic);
+  }
+}
+
 size_t AsyncWebSocket::printf(uint32_t id, const char *format, ...){
   AsyncWebSocketClient * c = client(id);
   if(c){
@@ -1102,10 +1548,22 @@ void AsyncWebSocket::textAll(const String &message){
   textAll(message.c_str(), message.length());
 }
 void AsyncWebSocket::textAll(const __FlashStringHelper *message){
-  for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED)
-      c->text(message);
+  if(!count())
+    return;
+  PGM_P p = reinterpret_cast<PGM_P>(message);
+  size_t n = 0;
+  while (1) {
+    if (pgm_read_byte(p+n) == 0) break;
+      n += 1;
   }
+  AsyncWebSocketSharedFrame * frame = AsyncWebSocketSharedFrame::create(WS_TEXT, n);
+  if(frame == NULL)
+    return;
+  uint8_t * payload = frame->payload();
+  for(size_t b=0; b<n; b++)
+    payload[b] = pgm_read_byte(p++);
+  messageAll(frame);
+  frame->unref();
 }
 void AsyncWebSocket::binary(uint32_t id, const char * message){
   binary(id, message, strlen(message));
@@ -1137,10 +1595,17 @@ void AsyncWebSocket::binaryAll(const String &message){
   binaryAll(message.c_str(), message.length());
 }
 void AsyncWebSocket::binaryAll(const __FlashStringHelper *message, size_t len){
-  for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED)
-      c-> binary(message, len);
-  }
+  if(!count())
+    return;
+  PGM_P p = reinterpret_cast<PGM_P>(message);
+  AsyncWebSocketSharedFrame * frame = AsyncWebSocketSharedFrame::create(WS_BINARY, len);
+  if(frame == NULL)
+    return;
+  uint8_t * payload = frame->payload();
+  for(size_t b=0; b<len; b++)
+    payload[b] = pgm_read_byte(p++);
+  messageAll(frame);
+  frame->unref();
  }
 
 const char * WS_STR_CONNECTION = "Connection";
@@ -1153,10 +1618,24 @@ const char * WS_STR_ACCEPT = "Sec-WebSocket-Accept";
 const char * WS_STR_UUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
 bool AsyncWebSocket::canHandle(AsyncWebServerRequest *request){
+  if(!AsyncWebRouter::match(request, ROUTE_EXACT, _url.c_str(), _url.length()) || !canHandleRoute(request))
+    return false;
+
+  AsyncWebRouter::capture(request, _url.c_str(), _url.length());
+  return true;
+}
+
+WebRouteMode AsyncWebSocket::route(const char *&pattern, size_t &length){
+  pattern = _url.c_str();
+  length = _url.length();
+  return ROUTE_EXACT;
+}
+
+bool AsyncWebSocket::canHandleRoute(AsyncWebServerRequest *request){
   if(!_enabled)
     return false;
 
-  if(request->method() != HTTP_GET || !request->url().equals(_url) || !request->isExpectedRequestedConnType(RCT_WS))
+  if(request->method() != HTTP_GET || !request->isExpectedRequestedConnType(RCT_WS))
     return false;
 
   request->addInterestingHeader(WS_STR_CONNECTION);
@@ -0,0 +1,288 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "ESPAsyncWebServer.h"
+#include "WebJson.h"
+
+enum {
+  JSON_OPEN,
+  JSON_KEY,
+  JSON_NAME,
+  JSON_VALUE,
+  JSON_STRING,
+  JSON_CLOSE,
+  JSON_DONE
+};
+
+AsyncJsonWriter::AsyncJsonWriter(const void* object, const AsyncJsonField* fields, size_t count)
+  : _object((const uint8_t*)object)
+  , _fields(fields)
+  , _count(count)
+  , _field(0)
+  , _state(JSON_OPEN)
+  , _offset(0)
+  , _scratchLength(0)
+  , _scratchOffset(0)
+{}
+
+bool AsyncJsonWriter::done() const {
+  return _state == JSON_DONE && _scratchOffset == _scratchLength;
+}
+
+size_t AsyncJsonWriter::write(uint8_t* data, size_t len){
+  size_t filled = 0;
+  while(filled < len){
+    if(_scratchOffset < _scratchLength){
+      size_t n = std::min(_scratchLength - _scratchOffset, len - filled);
+      memcpy(data + filled, _scratch + _scratchOffset, n);
+      _scratchOffset += n;
+      filled += n;
+      continue;
+    }
+    //values are written where they go, unless they might not fit
+    if(len - filled >= sizeof(_scratch)){
+      size_t n = _next((char*)data + filled, len - filled);
+      if(!n){
+        break;
+      }
+      filled += n;
+    } else {
+      _scratchOffset = 0;
+      _scratchLength = _next(_scratch, sizeof(_scratch));
+      if(!_scratchLength){
+        break;
+      }
+    }
+  }
+  return filled;
+}
+
+//Writes the next piece of the JSON into out, at least one byte unless it is
+//done. len is at least ASYNCWEBSERVER_JSON_SCRATCH_LENGTH.
+size_t AsyncJsonWriter::_next(char* out, size_t len){
+  switch(_state){
+    case JSON_OPEN:
+      _state = _count ? JSON_KEY : JSON_CLOSE;
+      out[0] = '{';
+      return 1;
+
+    case JSON_KEY: {
+      size_t n = 0;
+      if(_field){
+        out[n++] = ',';
+      }
+      out[n++] = '"';
+      _state = JSON_NAME;
+      _offset = 0;
+      return n;
+    }
+
+    case JSON_NAME: {
+      const char* name = _fields[_field].name + _offset;
+      size_t n = 0;
+      while(n < len && name[n]){
+        out[n] = name[n];
+        n++;
+      }
+      _offset += n;
+      if(!name[n]){
+        _state = JSON_VALUE;
+      }
+      if(n){
+        return n;
+      }
+      return _next(out, len);
+    }
+
+    case JSON_VALUE: {
+      const AsyncJsonField& field = _fields[_field];
+      out[0] = '"';
+      out[1] = ':';
+      if(field.type == JSON_FIELD_CHARS || field.type == JSON_FIELD_CSTR){
+        const char* value = (const char*)(_object + field.offset);
+        if(field.type == JSON_FIELD_CSTR){
+          memcpy(&value, _object + field.offset, sizeof(value));
+        }
+        if(value != NULL){
+          out[2] = '"';
+          _state = JSON_STRING;
+          _offset = 0;
+          return 3;
+        }
+        memcpy(out + 2, "null", 4);
+        _state = (++_field < _count) ? JSON_KEY : JSON_CLOSE;
+        return 6;
+      }
+      //as if in the scratch, so a number is written the same wherever it goes
+      size_t n = 2 + _value(field, out + 2, sizeof(_scratch) - 2);
+      _state = (++_field < _count) ? JSON_KEY : JSON_CLOSE;
+      return n;
+    }
+
+    case JSON_STRING: {
+      const AsyncJsonField& field = _fields[_field];
+      const char* value = (const char*)(_object + field.offset);
+      size_t size = field.size;
+      if(field.type == JSON_FIELD_CSTR){
+        memcpy(&value, _object + field.offset, sizeof(value));
+        size = SIZE_MAX;
+      }
+      return _string(value, size, out, len);
+    }
+
+    case JSON_CLOSE:
+      _state = JSON_DONE;
+      out[0] = '}';
+      return 1;
+
+    default:
+      return 0;
+  }
+}
+
+//A number or a bool, there is always room for one
+size_t AsyncJsonWriter::_value(const AsyncJsonField& field, char* out, size_t len){
+  const uint8_t* p = _object + field.offset;
+  if(field.type == JSON_FIELD_BOOL){
+    bool b = false;
+    for(size_t i = 0; i < field.size; i++){
+      b |= (p[i] != 0);
+    }
+    memcpy(out, b ? "true" : "false", b ? 4 : 5);
+    return b ? 4 : 5;
+  }
+  if(field.type == JSON_FIELD_FLOAT){
+    double d;
+    if(field.size == sizeof(float)){
+      float f;
+      memcpy(&f, p, sizeof(f));
+      d = f;
+    } else if(field.size == sizeof(double)){
+      memcpy(&d, p, sizeof(d));
+    } else {
+      long double l;
+      memcpy(&l, p, sizeof(l));
+      d = (double)l;
+    }
+    //JSON has no NaN, a failed DHT read is null
+    if(isnan(d) || isinf(d)){
+      memcpy(out, "null", 4);
+      return 4;
+    }
+    //rounded half up like Print does, without printf for everyday readings
+    if(field.decimals <= 9 && fabs(d) < 1e9){
+      uint64_t scale = 1;
+      for(uint8_t i = 0; i < field.decimals; i++){
+        scale *= 10;
+      }
+      uint64_t v = (uint64_t)(fabs(d) * scale + 0.5);
+      size_t n = 0;
+      if(d < 0 && v){
+        out[n++] = '-';
+      }
+      n += _digits(v / scale, out + n);
+      if(field.decimals){
+        out[n++] = '.';
+        uint64_t fraction = v % scale;
+        for(uint8_t i = field.decimals; i > 0; i--){
+          out[n + i - 1] = '0' + (fraction % 10);
+          fraction /= 10;
+        }
+        n += field.decimals;
+      }
+      return n;
+    }
+    int n = snprintf(out, len, "%.*f", field.decimals, d);
+    if(n < 0 || (size_t)n >= len){
+      n = snprintf(out, len, "%.*e", std::min((int)field.decimals, 15), d);
+    }
+    return (n < 0) ? 0 : std::min((size_t)n, len - 1);
+  }
+  uint64_t u;
+  bool negative = false;
+  if(field.type == JSON_FIELD_INT){
+    int64_t i;
+    if(field.size == 1){ int8_t v; memcpy(&v, p, 1); i = v; }
+    else if(field.size == 2){ int16_t v; memcpy(&v, p, 2); i = v; }
+    else if(field.size == 4){ int32_t v; memcpy(&v, p, 4); i = v; }
+    else { memcpy(&i, p, 8); }
+    negative = (i < 0);
+    u = negative ? (uint64_t)0 - (uint64_t)i : (uint64_t)i;
+  } else {
+    if(field.size == 1){ uint8_t v; memcpy(&v, p, 1); u = v; }
+    else if(field.size == 2){ uint16_t v; memcpy(&v, p, 2); u = v; }
+    else if(field.size == 4){ uint32_t v; memcpy(&v, p, 4); u = v; }
+    else { memcpy(&u, p, 8); }
+  }
+  size_t n = 0;
+  if(negative){
+    out[n++] = '-';
+  }
+  return n + _digits(u, out + n);
+}
+
+size_t AsyncJsonWriter::_digits(uint64_t value, char* out){
+  char digits[20];
+  size_t count = 0;
+  do {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while(value);
+  size_t n = 0;
+  while(count){
+    out[n++] = digits[--count];
+  }
+  return n;
+}
+
+//As much of a string as fits, escaped, and its closing quote once it all has
+size_t AsyncJsonWriter::_string(const char* value, size_t size, char* out, size_t len){
+  static const char hex[] = "0123456789abcdef";
+  size_t n = 0;
+  //the longest escape and the closing quote always fit
+  while(n + 7 <= len && _offset < size && value[_offset]){
+    uint8_t c = value[_offset++];
+    if(c == '"' || c == '\\'){
+      out[n++] = '\\';
+      out[n++] = c;
+    } else if(c >= 0x20){
+      out[n++] = c;
+    } else {
+      out[n++] = '\\';
+      switch(c){
+        case '\n': out[n++] = 'n'; break;
+        case '\r': out[n++] = 'r'; break;
+        case '\t': out[n++] = 't'; break;
+        case '\b': out[n++] = 'b'; break;
+        case '\f': out[n++] = 'f'; break;
+        default:
+          memcpy(out + n, "u00", 3);
+          out[n + 3] = hex[c >> 4];
+          out[n + 4] = hex[c & 15];
+          n += 5;
+      }
+    }
+  }
+  if(_offset == size || !value[_offset]){
+    out[n++] = '"';
+    _state = (++_field < _count) ? JSON_KEY : JSON_CLOSE;
+  }
+  return n;
+}
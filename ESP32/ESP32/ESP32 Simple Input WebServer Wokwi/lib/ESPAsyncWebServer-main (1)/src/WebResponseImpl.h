@@ -53,6 +53,9 @@ class AsyncAbstractResponse: public AsyncWebServerResponse {
     AwsTemplateProcessor _callback;
   public:
     AsyncAbstractResponse(AwsTemplateProcessor callback=nullptr);
+#if defined(ESP32)
+    static bool _beginPool();
+#endif
     void _respond(AsyncWebServerRequest *request);
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
     bool _sourceValid() const { return false; }
@@ -118,6 +121,69 @@ class AsyncProgmemResponse: public AsyncAbstractResponse {
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
 };
 
+//Renders a compiled template: text is copied from the content as it is and
+//every placeholder is written by the writer, nothing is searched again
+class AsyncTemplateResponse: public AsyncAbstractResponse {
+  private:
+    const AsyncWebTemplate& _template;
+    AwsTemplateWriter _writer;
+    size_t _segment;  //being sent
+    size_t _offset;   //into its text or value
+    size_t _valueLength;
+    char _value[ASYNCWEBSERVER_TEMPLATE_VALUE_LENGTH];
+  public:
+    AsyncTemplateResponse(int code, const String& contentType, const AsyncWebTemplate& content, AwsTemplateWriter writer);
+    bool _sourceValid() const { return _template.compiled(); }
+    virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+};
+
+//Writes a struct as JSON straight into the transmit buffers, chunked, so
+//there is no document, no measuring pass and no String in between
+class AsyncJsonStreamResponse: public AsyncAbstractResponse {
+  private:
+    AsyncJsonWriter _writer;
+  public:
+    AsyncJsonStreamResponse(int code, const void* object, const AsyncJsonField* fields, size_t count);
+    bool _sourceValid() const { return true; }
+    virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+};
+
+//Keeps its own copy of the struct, the handler's can go out of scope
+template<typename T>
+class AsyncJsonStructResponse: public AsyncJsonStreamResponse {
+  private:
+    const T _object;
+  public:
+    AsyncJsonStructResponse(int code, const T& object, const AsyncJsonField* fields, size_t count)
+      : AsyncJsonStreamResponse(code, &_object, fields, count), _object(object) {}
+};
+
+template<typename T, size_t N>
+AsyncWebServerResponse * AsyncWebServerRequest::beginJsonResponse(int code, const T& object, const AsyncJsonField (&fields)[N]){
+  return new AsyncJsonStructResponse<T>(code, object, fields, N);
+}
+
+template<typename T, size_t N>
+void AsyncWebServerRequest::sendJson(int code, const T& object, const AsyncJsonField (&fields)[N]){
+  send(beginJsonResponse(code, object, fields));
+}
+
+#if defined(ESP32)
+//Flash is mapped into the address space, so LwIP can point into it: the
+//content is written without a copy and has to stay where it is for as long
+//as the server runs, as PROGMEM and string literals do
+class AsyncFlashResponse: public AsyncWebServerResponse {
+  private:
+    const uint8_t * _content;
+    String _head;
+  public:
+    AsyncFlashResponse(int code, const String& contentType, const uint8_t * content, size_t len);
+    void _respond(AsyncWebServerRequest *request);
+    size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
+    bool _sourceValid() const { return _content != NULL || !_contentLength; }
+};
+#endif
+
 class cbuf;
 
 class AsyncResponseStream: public AsyncAbstractResponse, public Print {
@@ -34,6 +34,11 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
   : _server(port)
   , _rewrites(LinkedList<AsyncWebRewrite*>(nullptr))
   , _handlers(LinkedList<AsyncWebHandler*>(nullptr))
+  , _router(_handlers)
+  , _begun(false)
+  , _keepAliveTimeout(ASYNCWEBSERVER_KEEPALIVE_TIMEOUT)
+  , _keepAliveMax(ASYNCWEBSERVER_KEEPALIVE_MAX)
+  , _onArenaStats(NULL)
 {
   _catchAllHandler = new AsyncCallbackWebHandler();
   if(_catchAllHandler == NULL)
@@ -72,14 +77,43 @@ AsyncWebRewrite& AsyncWebServer::rewrite(const char* from, const char* to){
 
 AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler){
   _handlers.add(handler);
+  _routesChanged();
   return *handler;
 }
 
 bool AsyncWebServer::removeHandler(AsyncWebHandler *handler){
-  return _handlers.remove(handler);
+  bool removed = _handlers.remove(handler);
+  _routesChanged();
+  return removed;
+}
+
+//Once begin() has run, requests of several connections may be in _router.find(),
+//so the trie is left to them and the handlers are asked one by one instead
+void AsyncWebServer::_routesChanged(){
+  if(_begun){
+    _router.disable();
+  } else {
+    _router.build();
+  }
 }
 
 void AsyncWebServer::begin(){
+#if defined(ESP32)
+  if(!AsyncWebServerRequest::_beginPool()){
+    log_w("request pool disabled, falling back to heap");
+  }
+  if(!AsyncAbstractResponse::_beginPool()){
+    log_w("transmit buffer pool disabled, falling back to heap");
+  }
+#endif
+  //built with the handlers already, again if that ran out of memory or a route() has
+  //changed since. Not after an earlier begin(), its requests may still be routed
+  if(!_begun && !_router.ready() && !_router.build()){
+#if defined(ESP32)
+    log_w("router disabled, handlers are asked one by one");
+#endif
+  }
+  _begun = true;
   _server.setNoDelay(true);
   _server.begin();
 }
@@ -88,6 +122,11 @@ void AsyncWebServer::end(){
   _server.end();
 }
 
+void AsyncWebServer::setKeepAlive(uint16_t timeout, uint16_t maxRequests){
+  _keepAliveTimeout = timeout;
+  _keepAliveMax = maxRequests;
+}
+
 #if ASYNC_TCP_SSL_ENABLED
 void AsyncWebServer::onSslFileRequest(AcSSlFileHandler cb, void* arg){
   _server.onSslFileRequest(cb, arg);
@@ -106,19 +145,27 @@ void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request){
   for(const auto& r: _rewrites){
     if (r->match(request)){
       request->_url = r->toUrl();
-      request->_addGetParams(r->params());
+      request->_addGetParams(r->params().c_str(), r->params().length());
     }
   }
 }
 
 void AsyncWebServer::_attachHandler(AsyncWebServerRequest *request){
-  for(const auto& h: _handlers){
-    if (h->filter(request) && h->canHandle(request)){
-      request->setHandler(h);
+  AsyncWebHandler* handler;
+  if(_router.find(request, handler)){
+    if(handler != NULL){
+      request->setHandler(handler);
       return;
     }
+  } else {
+    for(const auto& h: _handlers){
+      if (h->filter(request) && h->canHandle(request)){
+        request->setHandler(h);
+        return;
+      }
+    }
   }
-  
+
   request->addInterestingHeader("ANY");
   request->setHandler(_catchAllHandler);
 }
@@ -168,6 +215,12 @@ AsyncStaticWebHandler& AsyncWebServer::serveStatic(const char* uri, fs::FS& fs,
   return *handler;
 }
 
+AsyncAssetWebHandler& AsyncWebServer::serveAsset(const char* uri, const char* contentType, const uint8_t * content, size_t len, const char* etag, const char* cache_control){
+  AsyncAssetWebHandler* handler = new AsyncAssetWebHandler(uri, contentType, content, len, etag, cache_control);
+  addHandler(handler);
+  return *handler;
+}
+
 void AsyncWebServer::onNotFound(ArRequestHandlerFunction fn){
   _catchAllHandler->onRequest(fn);
 }
@@ -180,9 +233,14 @@ void AsyncWebServer::onRequestBody(ArBodyHandlerFunction fn){
   _catchAllHandler->onBody(fn);
 }
 
+void AsyncWebServer::onArenaStats(ArArenaStatsHandler fn){
+  _onArenaStats = fn;
+}
+
 void AsyncWebServer::reset(){
   _rewrites.free();
   _handlers.free();
+  _routesChanged();
   
   if (_catchAllHandler != NULL){
     _catchAllHandler->onRequest(NULL);
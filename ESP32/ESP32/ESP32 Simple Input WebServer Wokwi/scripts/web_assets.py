@@ -0,0 +1,153 @@
+"""
+Web assets: minify and gzip the pages in web/ into a C header at build time.
+
+Runs before every PlatformIO build (extra_scripts = pre:scripts/web_assets.py).
+Every .html, .css, .js, .svg and .json file in web/ becomes, in
+$BUILD_DIR/web_assets/web_assets.h:
+
+    #define INDEX_HTML_TYPE "text/html"
+    #define INDEX_HTML_ETAG "\"<first 16 hex digits of the sha256 of the gzip>\""
+    const uint8_t index_html_gz[] PROGMEM = { ... };
+
+which the sketch serves with
+
+    server.serveAsset("/", INDEX_HTML_TYPE, index_html_gz, sizeof(index_html_gz), INDEX_HTML_ETAG);
+
+The header is only rewritten when an asset changed, so an unchanged page
+does not rebuild the firmware. It can also be run by hand:
+
+    python scripts/web_assets.py web/ web_assets.h
+
+Minifying is deliberately conservative, it needs nothing beyond Python:
+HTML comments and the whitespace between lines go, CSS loses comments and
+the spaces around its punctuation, JavaScript keeps one statement per line
+and only loses indentation, blank lines and whole-line // comments.
+Text in <pre> and <textarea> is left as it is.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".svg": "image/svg+xml",
+    ".json": "application/json",
+}
+
+
+def minify_css(css):
+    css = re.sub(r"/\*.*?\*/", "", css, flags=re.S)
+    css = re.sub(r"\s+", " ", css)
+    css = re.sub(r"\s*([{};,>])\s*", r"\1", css)
+    css = re.sub(r":\s+", ":", css)
+    css = css.replace(";}", "}")
+    return css.strip()
+
+
+def minify_js(js):
+    lines = []
+    for line in js.splitlines():
+        line = line.strip()
+        if line and not line.startswith("//"):
+            lines.append(line)
+    return "\n".join(lines)
+
+
+def _minify_markup(html):
+    html = re.sub(r"<!--(?!\[if).*?-->", "", html, flags=re.S)
+    # whitespace with a line break between two tags is only layout
+    html = re.sub(r">\s*\n\s*<", "><", html)
+    return re.sub(r"\s+", " ", html)
+
+
+def minify_html(html):
+    out = []
+    pos = 0
+    blocks = re.compile(r"(<(script|style|pre|textarea)\b[^>]*>)(.*?)(</\2\s*>)", re.S | re.I)
+    for m in blocks.finditer(html):
+        out.append(_minify_markup(html[pos:m.start()]))
+        tag = m.group(2).lower()
+        body = m.group(3)
+        if tag == "style":
+            body = minify_css(body)
+        elif tag == "script":
+            body = minify_js(body)
+        out.append(_minify_markup(m.group(1)) + body + m.group(4))
+        pos = m.end()
+    out.append(_minify_markup(html[pos:]))
+    return "".join(out).strip()
+
+
+MINIFY = {
+    ".html": minify_html,
+    ".css": minify_css,
+    ".js": minify_js,
+    ".svg": _minify_markup,
+}
+
+
+def symbol(name):
+    return re.sub(r"[^0-9a-zA-Z]", "_", name)
+
+
+def render(source_dir):
+    parts = [
+        "// Generated from %s by scripts/web_assets.py, do not edit\n"
+        "#pragma once\n"
+        "#include <Arduino.h>\n" % os.path.basename(os.path.normpath(source_dir))
+    ]
+    for name in sorted(os.listdir(source_dir)):
+        ext = os.path.splitext(name)[1].lower()
+        if ext not in TYPES:
+            continue
+        with open(os.path.join(source_dir, name), "r", encoding="utf-8") as f:
+            text = f.read()
+        if ext in MINIFY:
+            text = MINIFY[ext](text)
+        raw = text.encode("utf-8")
+        # mtime=0 and no file name, the same page always gives the same bytes and ETag
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = hashlib.sha256(packed).hexdigest()[:16]
+        var = symbol(name)
+        body = ",\n".join(
+            "  " + ", ".join("0x%02x" % b for b in packed[i:i + 16])
+            for i in range(0, len(packed), 16)
+        )
+        parts.append(
+            "\n// %s: %d bytes minified, %d gzipped\n"
+            "#define %s_TYPE \"%s\"\n"
+            "#define %s_ETAG \"\\\"%s\\\"\"\n"
+            "const uint8_t %s_gz[] PROGMEM = {\n%s\n};\n"
+            % (name, len(raw), len(packed), var.upper(), TYPES[ext], var.upper(), etag, var, body)
+        )
+    return "".join(parts)
+
+
+def generate(source_dir, header):
+    text = render(source_dir)
+    if os.path.isfile(header):
+        with open(header, "r", encoding="utf-8") as f:
+            if f.read() == text:
+                return False
+    os.makedirs(os.path.dirname(os.path.abspath(header)), exist_ok=True)
+    with open(header, "w", encoding="utf-8") as f:
+        f.write(text)
+    return True
+
+
+if "Import" not in globals():
+    # run by hand: python scripts/web_assets.py web/ web_assets.h
+    generate(sys.argv[1], sys.argv[2])
+else:
+    Import("env")  # noqa: F821, provided by PlatformIO
+
+    source_dir = os.path.join(env.subst("$PROJECT_DIR"), "web")  # noqa: F821
+    out_dir = os.path.join(env.subst("$BUILD_DIR"), "web_assets")  # noqa: F821
+    if generate(source_dir, os.path.join(out_dir, "web_assets.h")):
+        print("web_assets: regenerated web_assets.h from web/")
+    env.Append(CPPPATH=[out_dir])  # noqa: F821
@@ -89,9 +89,7 @@ void setup() {
   Serial.println("HTTP server started (http://localhost:8180)");  // Direct localhost link
   
   // Async Web Server Routes
-  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-    request->send_P(200, "text/html", MAIN_page);
-  });
+  server.serveAsset("/", INDEX_HTML_TYPE, index_html_gz, sizeof(index_html_gz), INDEX_HTML_ETAG);
 
   server.on("/toggle", HTTP_GET, [](AsyncWebServerRequest *request){
     if(request->hasParam("state")) {
@@ -15,7 +15,7 @@
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
-#include "html.h"
+#include "web_assets.h"  // generated from web/ by scripts/web_assets.py
 
 // Hardware configuration
 #define LED_PIN 5        // GPIO pin connected to LED
@@ -33,7 +33,6 @@ extern volatile bool ledState;        // Current state of LED
 void IRAM_ATTR buttonISR();          // Button interrupt service routine
 void ledControlTask(void *parameter); // FreeRTOS task for LED control
 void webServerTask(void *parameter);  // FreeRTOS task for web server
-String processor(const String& var);  // Template processor for web page
 
 #endif
 
@@ -0,0 +1,44 @@
+/*
+  Host shim: IPv6 address as the ESP32 core has it.
+*/
+
+#ifndef IPV6ADDRESS_H_HOST
+#define IPV6ADDRESS_H_HOST
+
+#include <stdint.h>
+#include "WString.h"
+#include "Printable.h"
+
+class IPv6Address: public Printable {
+  private:
+    union {
+      uint8_t bytes[16];
+      uint32_t dword[4];
+    } _address;
+
+    uint8_t* raw_address() { return _address.bytes; }
+
+  public:
+    IPv6Address();
+    IPv6Address(const uint8_t *address);
+    IPv6Address(const uint32_t *address);
+    virtual ~IPv6Address() {}
+
+    bool fromString(const char *address);
+    bool fromString(const String &address) { return fromString(address.c_str()); }
+
+    operator const uint8_t*() const { return _address.bytes; }
+    operator const uint32_t*() const { return _address.dword; }
+    bool operator==(const IPv6Address& addr) const;
+    bool operator!=(const IPv6Address& addr) const { return !(*this == addr); }
+
+    uint8_t operator[](int index) const { return _address.bytes[index]; }
+    uint8_t& operator[](int index) { return _address.bytes[index]; }
+
+    IPv6Address& operator=(const uint8_t *address);
+
+    virtual size_t printTo(Print& p) const;
+    String toString() const;
+};
+
+#endif /* IPV6ADDRESS_H_HOST */
@@ -0,0 +1,18 @@
+/*
+  Host shim: Arduino Printable.
+*/
+
+#ifndef PRINTABLE_H_HOST
+#define PRINTABLE_H_HOST
+
+#include <stddef.h>
+
+class Print;
+
+class Printable {
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+#endif /* PRINTABLE_H_HOST */
@@ -0,0 +1,28 @@
+/*
+  Host shim: binary, counting and mutex semaphores on top of pthreads.
+*/
+
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void * SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEMAPHORE_H */
@@ -0,0 +1,23 @@
+/*
+  Host shim: a task is a thread, its handle is unique per thread.
+*/
+
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void * TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskDelay(const TickType_t xTicksToDelay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_TASK_H */
@@ -0,0 +1,38 @@
+/*
+  Host shim: LwIP dual-stack address, same layout as the real one.
+*/
+
+#ifndef LWIP_HDR_IP_ADDR_H
+#define LWIP_HDR_IP_ADDR_H
+
+#include <stdint.h>
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/ip6_addr.h"
+
+typedef struct ip4_addr {
+  uint32_t addr;    //network byte order
+} ip4_addr_t;
+
+#define IPADDR_TYPE_V4  0U
+#define IPADDR_TYPE_V6  6U
+#define IPADDR_TYPE_ANY 46U
+
+typedef struct ip_addr {
+  union {
+    ip6_addr_t ip6;
+    ip4_addr_t ip4;
+  } u_addr;
+  uint8_t type;
+} ip_addr_t;
+
+#define IPADDR_ANY ((uint32_t)0x00000000UL)
+
+#define IPADDR6_INIT(a, b, c, d) { { { { a, b, c, d }, 0 } }, IPADDR_TYPE_V6 }
+
+#define IP_IS_V4(ipaddr) ((ipaddr)->type == IPADDR_TYPE_V4)
+#define IP_IS_V6(ipaddr) ((ipaddr)->type == IPADDR_TYPE_V6)
+#define ip_addr_get_ip4_u32(ipaddr) ((ipaddr)->u_addr.ip4.addr)
+#define ip_addr_set_ip4_u32(ipaddr, val) do { (ipaddr)->u_addr.ip4.addr = (val); (ipaddr)->type = IPADDR_TYPE_V4; } while(0)
+
+#endif /* LWIP_HDR_IP_ADDR_H */
@@ -0,0 +1,13 @@
+/*
+  Host shim: there is no ESP-IDF config, the host backend runs a single event
+  loop thread and has no task watchdog.
+*/
+
+#ifndef SDKCONFIG_H_HOST
+#define SDKCONFIG_H_HOST
+
+#define CONFIG_LWIP_MAX_ACTIVE_TCP 16
+#define CONFIG_ASYNC_TCP_RUNNING_CORE -1
+#define CONFIG_ASYNC_TCP_USE_WDT 0
+
+#endif /* SDKCONFIG_H_HOST */
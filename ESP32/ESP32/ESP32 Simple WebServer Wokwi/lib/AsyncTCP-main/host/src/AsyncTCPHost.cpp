@@ -0,0 +1,1194 @@
+/*
+  Asynchronous TCP library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Linux backend, builds instead of src/AsyncTCP.cpp with src/AsyncTCPClient.cpp.
+ * A tcp_pcb is a non-blocking socket. One event loop thread owns all of them:
+ * it is the LwIP thread and the async task at once, so every callback runs
+ * there, in the same order and with the same arguments as on the board.
+ * Other threads only queue data or requests on a pcb and wake the loop up.
+ * Bytes the kernel has taken count as acked, onAck() follows every send.
+ * */
+
+#include "Arduino.h"
+
+#include "AsyncTCPBackend.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//what space() offers at most, TCP_SND_BUF of the ESP32 LwIP
+#ifndef CONFIG_ASYNC_TCP_HOST_SND_BUF
+#define CONFIG_ASYNC_TCP_HOST_SND_BUF 5744
+#endif
+
+//received data is handed out in pbufs of this size
+#ifndef CONFIG_ASYNC_TCP_HOST_MSS
+#define CONFIG_ASYNC_TCP_HOST_MSS 1436
+#endif
+
+//received bytes the application may hold before reading stops, TCP_WND of the ESP32 LwIP
+#ifndef CONFIG_ASYNC_TCP_HOST_WND
+#define CONFIG_ASYNC_TCP_HOST_WND 5744
+#endif
+
+//how long a closed connection may take to send what was left before it is reset
+#ifndef CONFIG_ASYNC_TCP_HOST_LINGER
+#define CONFIG_ASYNC_TCP_HOST_LINGER 10000
+#endif
+
+static int _host_epoll = -1;
+static int _host_wake = -1;
+static std::atomic<TaskHandle_t> _host_task(NULL);
+static std::mutex _host_lock;
+static std::vector<tcp_pcb *> _host_pcbs;
+static std::vector<tcp_pcb *> _host_kicked;
+static std::vector<async_event_owner *> _host_rearm;
+static AsyncTimerWheel _host_timers;
+static uint32_t _host_dead = 0;
+static uint32_t _host_last_sweep = 0;
+
+SemaphoreHandle_t _tx_refs_lock = NULL;
+AsyncObjectPool<AsyncClient> _client_pool;
+AsyncObjectPool<async_tx_ref> _tx_ref_pool;
+
+static uint32_t _poll_coalesced = 0;
+static uint32_t _timers_fired = 0;
+static uint32_t _stale_discarded = 0;
+
+void async_tcp_get_stats(async_tcp_stats_t * stats){
+    //there is no event queue, only the timers have something to report
+    memset(stats, 0, sizeof(async_tcp_stats_t));
+    _client_pool.stats(&stats->client_pool);
+    _tx_ref_pool.stats(&stats->tx_ref_pool);
+    stats->poll_coalesced = _poll_coalesced;
+    stats->timers_armed = _host_timers.armed();
+    stats->timers_fired = _timers_fired;
+    stats->stale_discarded = _stale_discarded;
+}
+
+async_event_owner * _new_event_owner(AsyncClient * client){
+    async_event_owner * owner = new (std::nothrow) async_event_owner();
+    if(owner){
+        owner->timer.prev = owner->timer.next = NULL;
+        owner->refs = 1;
+        owner->dead = false;
+        owner->due = 0;
+        owner->client = client;
+    }
+    return owner;
+}
+
+void _release_event_owner(async_event_owner * owner){
+    if(owner && owner->refs.fetch_sub(1) == 1){
+        delete owner;
+    }
+}
+
+static inline bool _in_async_task_for(void * arg){
+    TaskHandle_t task = _host_task;
+    return task && task == xTaskGetCurrentTaskHandle();
+}
+
+//wakes the loop up when called from another thread, it services the pcb before it sleeps again
+static void _host_kick(tcp_pcb * pcb){
+    {
+        std::lock_guard<std::mutex> guard(_host_lock);
+        if(!pcb->kicked){
+            pcb->kicked = true;
+            _host_kicked.push_back(pcb);
+        }
+    }
+    if(!_in_async_task_for(pcb)){
+        uint64_t one = 1;
+        if(::write(_host_wake, &one, sizeof(one)) < 0 && errno != EAGAIN){
+            log_e("wake error: %d", errno);
+        }
+    }
+}
+
+static int8_t _host_error(int error){
+    switch(error){
+        case ECONNREFUSED:
+        case ECONNRESET:
+        case EPIPE: return ERR_RST;
+        case ETIMEDOUT: return ERR_TIMEOUT;
+        case ENETUNREACH:
+        case EHOSTUNREACH: return ERR_RTE;
+        case ENOMEM:
+        case ENOBUFS: return ERR_MEM;
+        default: return ERR_CONN;
+    }
+}
+
+static int _host_socket_error(int fd){
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if(getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0){
+        return errno;
+    }
+    return error;
+}
+
+//a v4 client of a dual-stack socket shows up v4-mapped, LwIP reports it as v4
+static void _host_ip_addr(const sockaddr_storage * ss, ip_addr_t * ip, uint16_t * port){
+    memset(ip, 0, sizeof(ip_addr_t));
+    if(ss->ss_family == AF_INET){
+        const sockaddr_in * in = (const sockaddr_in *)ss;
+        ip_addr_set_ip4_u32(ip, in->sin_addr.s_addr);
+        *port = ntohs(in->sin_port);
+    } else if(ss->ss_family == AF_INET6){
+        const sockaddr_in6 * in6 = (const sockaddr_in6 *)ss;
+        if(IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)){
+            uint32_t v4;
+            memcpy(&v4, &in6->sin6_addr.s6_addr[12], sizeof(v4));
+            ip_addr_set_ip4_u32(ip, v4);
+        } else {
+            memcpy(ip->u_addr.ip6.addr, &in6->sin6_addr, 16);
+            ip->type = IPADDR_TYPE_V6;
+        }
+        *port = ntohs(in6->sin6_port);
+    }
+}
+
+static socklen_t _host_sockaddr(const ip_addr_t * ip, uint16_t port, sockaddr_storage * ss){
+    memset(ss, 0, sizeof(sockaddr_storage));
+    if(ip->type == IPADDR_TYPE_V6){
+        sockaddr_in6 * in6 = (sockaddr_in6 *)ss;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        memcpy(&in6->sin6_addr, ip->u_addr.ip6.addr, 16);
+        return sizeof(sockaddr_in6);
+    }
+    sockaddr_in * in = (sockaddr_in *)ss;
+    in->sin_family = AF_INET;
+    in->sin_port = htons(port);
+    in->sin_addr.s_addr = ip->u_addr.ip4.addr;
+    return sizeof(sockaddr_in);
+}
+
+static void _host_addresses(tcp_pcb * pcb){
+    sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    if(getsockname(pcb->fd, (sockaddr *)&ss, &len) == 0){
+        _host_ip_addr(&ss, &pcb->local_ip, &pcb->local_port);
+    }
+    len = sizeof(ss);
+    if(getpeername(pcb->fd, (sockaddr *)&ss, &len) == 0){
+        _host_ip_addr(&ss, &pcb->remote_ip, &pcb->remote_port);
+    }
+}
+
+//the loop adds it to the epoll set once it is kicked, which the caller does after it has
+//stored the pcb: from then on callbacks can run in the loop before the caller gets to it
+static tcp_pcb * _host_new_pcb(int fd, uint8_t state, async_event_owner * owner, AsyncServer * server = NULL){
+    tcp_pcb * pcb = new tcp_pcb();
+    pcb->fd = fd;
+    pcb->state = state;
+    pcb->server = server;
+    if(owner){
+        owner->refs++;
+        pcb->owner = owner;
+    }
+    if(state == ESTABLISHED){
+        _host_addresses(pcb);
+    }
+    {
+        std::lock_guard<std::mutex> guard(_host_lock);
+        _host_pcbs.push_back(pcb);
+    }
+    return pcb;
+}
+
+//pcb lock held, returns the owner with an extra reference for a callback
+static inline async_event_owner * _host_hold(tcp_pcb * pcb){
+    if(pcb->owner){
+        pcb->owner->refs++;
+    }
+    return pcb->owner;
+}
+
+static void _host_attach(tcp_pcb * pcb, async_event_owner * owner){
+    async_event_owner * old;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        old = pcb->owner;
+        if(owner){
+            owner->refs++;
+        }
+        pcb->owner = owner;
+    }
+    _release_event_owner(old);
+}
+
+void _tcp_attach(tcp_pcb * pcb, AsyncClient * client){
+    _host_attach(pcb, client->_events);
+}
+
+void _tcp_detach(tcp_pcb * pcb){
+    _host_attach(pcb, NULL);
+}
+
+/*
+ * TCP/IP API Calls
+ * From any thread, they queue on the pcb and leave the rest to the loop.
+ * A pcb is only freed once its client has let go, so there is no closed slot to check.
+ * */
+
+size_t tcp_sndbuf(tcp_pcb * pcb){
+    std::lock_guard<std::mutex> guard(pcb->lock);
+    return (pcb->tx_len < CONFIG_ASYNC_TCP_HOST_SND_BUF) ? CONFIG_ASYNC_TCP_HOST_SND_BUF - pcb->tx_len : 0;
+}
+
+uint16_t tcp_mss(tcp_pcb * pcb){
+    return CONFIG_ASYNC_TCP_HOST_MSS;
+}
+
+static void _host_nodelay(tcp_pcb * pcb, bool nodelay){
+    std::lock_guard<std::mutex> guard(pcb->lock);
+    int value = nodelay ? 1 : 0;
+    if(pcb->fd >= 0 && setsockopt(pcb->fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) == 0) {
+        pcb->nodelay = nodelay;
+    }
+}
+
+void tcp_nagle_disable(tcp_pcb * pcb){
+    _host_nodelay(pcb, true);
+}
+
+void tcp_nagle_enable(tcp_pcb * pcb){
+    _host_nodelay(pcb, false);
+}
+
+bool tcp_nagle_disabled(tcp_pcb * pcb){
+    return pcb->nodelay;
+}
+
+//the loop sends what is queued right away
+int8_t _tcp_output(tcp_pcb * pcb, int32_t closed_slot) {
+    if(!pcb){
+        return ERR_CONN;
+    }
+    _host_kick(pcb);
+    return ERR_OK;
+}
+
+//queues as much as space() allows, with output the loop sends it right away
+int8_t _tcp_writev(tcp_pcb * pcb, int32_t closed_slot, const async_tcp_segment_t * segments, size_t count, bool output, size_t * written){
+    *written = 0;
+    if(!pcb){
+        return ERR_CONN;
+    }
+    int8_t err = ERR_OK;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        if(pcb->closing || pcb->state != ESTABLISHED){
+            return ERR_CONN;
+        }
+        for(size_t i = 0; i < count; ++i){
+            size_t room = (pcb->tx_len < CONFIG_ASYNC_TCP_HOST_SND_BUF) ? CONFIG_ASYNC_TCP_HOST_SND_BUF - pcb->tx_len : 0;
+            size_t len = (segments[i].len < room) ? segments[i].len : room;
+            if(!segments[i].data || !segments[i].len){
+                continue;
+            }
+            if(!len){
+                break;
+            }
+            host_segment_t segment = { segments[i].data, len, NULL };
+            if(segments[i].apiflags & ASYNC_WRITE_FLAG_COPY){
+                segment.buffer = (char *)malloc(len);
+                if(!segment.buffer){
+                    err = ERR_MEM;
+                    break;
+                }
+                memcpy(segment.buffer, segments[i].data, len);
+                segment.data = segment.buffer;
+            }
+            pcb->tx.push_back(segment);
+            pcb->tx_len += len;
+            *written += len;
+            if(len < segments[i].len){
+                break;
+            }
+        }
+    }
+    if(output && *written){
+        _host_kick(pcb);
+    }
+    if(!*written && err == ERR_OK){
+        err = ERR_MEM;
+    }
+    return err;
+}
+
+int8_t _tcp_recved(tcp_pcb * pcb, int32_t closed_slot, size_t len) {
+    if(!pcb){
+        return ERR_CONN;
+    }
+    if(!len){
+        return ERR_OK;
+    }
+    bool resume;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        resume = pcb->rx_held >= CONFIG_ASYNC_TCP_HOST_WND;
+        pcb->rx_held = (len < pcb->rx_held) ? pcb->rx_held - len : 0;
+        resume = resume && pcb->rx_held < CONFIG_ASYNC_TCP_HOST_WND;
+    }
+    //reading stopped with a full window
+    if(resume){
+        _host_kick(pcb);
+    }
+    return ERR_OK;
+}
+
+//Lets go of the connection. The loop sends what is queued and closes, or resets at once.
+static void _host_close(tcp_pcb * pcb, bool rst){
+    async_event_owner * owner;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        owner = pcb->owner;
+        pcb->owner = NULL;
+        pcb->server = NULL;
+        if(!pcb->closing){
+            pcb->closing = true;
+            pcb->closed_at = millis();
+        }
+        //nobody is told when the peer got it, so the data has to be ours
+        for(auto & segment : pcb->tx){
+            if(rst || segment.buffer){
+                continue;
+            }
+            segment.buffer = (char *)malloc(segment.len);
+            if(!segment.buffer){
+                rst = true;
+                break;
+            }
+            memcpy(segment.buffer, segment.data, segment.len);
+            segment.data = segment.buffer;
+        }
+        pcb->rst = pcb->rst || rst;
+    }
+    _release_event_owner(owner);
+    _host_kick(pcb);
+}
+
+int8_t _tcp_close(tcp_pcb * pcb, int32_t closed_slot) {
+    if(!pcb){
+        return ERR_CONN;
+    }
+    _host_close(pcb, false);
+    return ERR_OK;
+}
+
+//like tcp_abort(), the client still gets ERR_ABRT from the loop
+int8_t _tcp_abort(tcp_pcb * pcb, int32_t closed_slot) {
+    if(!pcb){
+        return ERR_CONN;
+    }
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        pcb->aborted = true;
+        pcb->rst = true;
+        pcb->closing = true;
+        pcb->state = CLOSED;
+    }
+    _host_kick(pcb);
+    return ERR_OK;
+}
+
+/*
+ * Connection Timers
+ * Same as on the board: the loop keeps the RX, ACK and poll deadlines of
+ * all connections in a timer wheel and sleeps until the earliest is due.
+ * */
+
+//in the event loop only
+void _arm_event_timer(async_event_owner * owner, uint32_t due){
+    if(!AsyncTimerWheel::scheduled(&owner->timer)){
+        //the wheel keeps the tombstone alive until the timer fires or is cancelled
+        owner->refs++;
+    }
+    _host_timers.schedule(&owner->timer, due);
+    owner->due = due ? due : 1;
+}
+
+//in the event loop only
+void _disarm_event_timer(async_event_owner * owner){
+    if(!AsyncTimerWheel::scheduled(&owner->timer)){
+        return;
+    }
+    _host_timers.cancel(&owner->timer);
+    owner->due = 0;
+    _release_event_owner(owner);
+}
+
+//from anywhere, the timer of a dead connection is dropped when it fires
+void _kill_event_owner(async_event_owner * owner){
+    owner->dead = true;
+    if(_in_async_task_for(owner->client)){
+        _disarm_event_timer(owner);
+    }
+}
+
+static void _event_timer_expired(async_timer_node_t * node, void * arg){
+    async_event_owner * owner = reinterpret_cast<async_event_owner*>(node);
+    owner->due = 0;
+    if(!owner->dead){
+        _timers_fired++;
+        AsyncClient::_s_poll(owner->client, owner->client->pcb());
+    }
+    _release_event_owner(owner);
+}
+
+int8_t _tcp_clear_events(void * arg) {
+    async_event_owner * owner = reinterpret_cast<AsyncClient*>(arg)->_events;
+    if(owner){
+        _kill_event_owner(owner);
+    }
+    return ERR_OK;
+}
+
+/*
+ * Event Loop
+ * */
+
+//pcb lock held
+static void _host_shut(tcp_pcb * pcb, bool rst){
+    if(pcb->fd >= 0){
+        if(rst){
+            struct linger reset = { 1, 0 };
+            setsockopt(pcb->fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+        }
+        //also takes it out of the epoll set
+        ::close(pcb->fd);
+        pcb->fd = -1;
+    }
+    for(auto & segment : pcb->tx){
+        ::free(segment.buffer);
+    }
+    pcb->tx.clear();
+    pcb->tx_len = 0;
+    pcb->state = CLOSED;
+    pcb->registered = false;
+    pcb->dead = true;
+    _host_dead++;
+}
+
+//pcb lock held
+static void _host_update(tcp_pcb * pcb){
+    uint32_t want = 0;
+    if(pcb->state == LISTEN){
+        want = EPOLLIN;
+    } else if(pcb->state == SYN_SENT){
+        want = EPOLLOUT;
+    } else {
+        bool window = pcb->rx_held < CONFIG_ASYNC_TCP_HOST_WND;
+        if(pcb->hup && !pcb->closing && !window){
+            //a hangup is reported whatever we ask for, wait outside the set until the client acks
+            if(pcb->registered){
+                epoll_ctl(_host_epoll, EPOLL_CTL_DEL, pcb->fd, NULL);
+                pcb->registered = false;
+            }
+            return;
+        }
+        if(pcb->closing || window){
+            want |= EPOLLIN;
+        }
+        if(pcb->tx_len){
+            want |= EPOLLOUT;
+        }
+    }
+    if(pcb->registered && want == pcb->events){
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = want;
+    ev.data.ptr = pcb;
+    if(epoll_ctl(_host_epoll, pcb->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, pcb->fd, &ev) < 0){
+        log_e("epoll error: %d", errno);
+        return;
+    }
+    pcb->registered = true;
+    pcb->events = want;
+}
+
+//pcb lock held, returns an errno when the connection is broken
+static int _host_flush(tcp_pcb * pcb){
+    while(pcb->tx_len){
+        struct iovec iov[64];
+        size_t count = 0;
+        for(auto it = pcb->tx.begin(); it != pcb->tx.end() && count < 64; ++it, ++count){
+            iov[count].iov_base = (void *)it->data;
+            iov[count].iov_len = it->len;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t sent = sendmsg(pcb->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(sent < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : errno;
+        }
+        size_t left = sent;
+        pcb->tx_len -= left;
+        pcb->tx_done += left;
+        while(left){
+            host_segment_t & segment = pcb->tx.front();
+            if(left < segment.len){
+                segment.data += left;
+                segment.len -= left;
+                break;
+            }
+            left -= segment.len;
+            ::free(segment.buffer);
+            pcb->tx.pop_front();
+        }
+    }
+    return 0;
+}
+
+//the owner reference is the caller's, it is released afterwards
+static void _host_report_error(async_event_owner * owner, tcp_pcb * pcb, int8_t err){
+    if(!owner){
+        return;
+    }
+    if(owner->dead){
+        _stale_discarded++;
+        return;
+    }
+    //after abort() the client has let go of the pcb, unless it has a new one already
+    AsyncClient * client = owner->client;
+    if(client->pcb() == pcb || client->pcb() == NULL){
+        AsyncClient::_s_error(client, err);
+    }
+}
+
+static void _host_report_sent(async_event_owner * owner, tcp_pcb * pcb, uint32_t len){
+    //anything above 64K goes in more than one call, the client may close in between
+    while(owner && len && !owner->dead){
+        uint16_t report = (len > 0xFFFF) ? 0xFFFF : len;
+        len -= report;
+        AsyncClient::_s_sent(owner->client, pcb, report);
+    }
+}
+
+static void _host_fail(tcp_pcb * pcb, int8_t err){
+    async_event_owner * owner;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        if(pcb->dead){
+            return;
+        }
+        owner = pcb->owner;
+        pcb->owner = NULL;
+        _host_shut(pcb, true);
+    }
+    _host_report_error(owner, pcb, err);
+    _release_event_owner(owner);
+}
+
+//flushes, closes and updates what epoll waits for, then reports what was sent
+static void _host_service(tcp_pcb * pcb){
+    async_event_owner * owner = NULL;
+    uint32_t done = 0;
+    int8_t err = ERR_OK;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        if(pcb->dead){
+            return;
+        }
+        uint8_t state = pcb->state;
+        if(pcb->aborted){
+            owner = pcb->owner;
+            pcb->owner = NULL;
+            _host_shut(pcb, true);
+            err = ERR_ABRT;
+        } else if(pcb->closing && (pcb->rst || (state != ESTABLISHED && state != CLOSE_WAIT && state != FIN_WAIT_1))){
+            _host_shut(pcb, pcb->rst);
+        } else {
+            int error = _host_flush(pcb);
+            if(error){
+                owner = pcb->owner;
+                pcb->owner = NULL;
+                _host_shut(pcb, true);
+                err = _host_error(error);
+            } else if(pcb->closing && !pcb->tx_len){
+                //closed and everything is out: send FIN, then wait for the peer's
+                //so whatever it still sends does not turn the close into a reset
+                if(state != FIN_WAIT_1){
+                    shutdown(pcb->fd, SHUT_WR);
+                    pcb->state = FIN_WAIT_1;
+                }
+                if(pcb->eof){
+                    _host_shut(pcb, false);
+                } else {
+                    _host_update(pcb);
+                }
+            } else {
+                if(!pcb->closing && pcb->tx_done){
+                    done = pcb->tx_done;
+                    pcb->tx_done = 0;
+                    owner = _host_hold(pcb);
+                }
+                _host_update(pcb);
+            }
+        }
+    }
+    if(err != ERR_OK){
+        _host_report_error(owner, pcb, err);
+    } else {
+        _host_report_sent(owner, pcb, done);
+    }
+    _release_event_owner(owner);
+}
+
+static void _host_accept(tcp_pcb * listener){
+    for(;;){
+        int fd = accept4(listener->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            if(errno != EAGAIN && errno != EWOULDBLOCK){
+                log_e("accept error: %d", errno);
+            }
+            return;
+        }
+        AsyncServer * server;
+        {
+            std::lock_guard<std::mutex> guard(listener->lock);
+            server = listener->server;
+        }
+        if(!server){
+            //ended meanwhile
+            ::close(fd);
+            continue;
+        }
+        tcp_pcb * pcb = _host_new_pcb(fd, ESTABLISHED, NULL);
+        _host_kick(pcb);
+        AsyncServer::_s_accept(server, pcb, ERR_OK);
+    }
+}
+
+static void _host_connected(tcp_pcb * pcb){
+    int error = _host_socket_error(pcb->fd);
+    if(error){
+        _host_fail(pcb, _host_error(error));
+        return;
+    }
+    async_event_owner * owner;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        if(pcb->closing){
+            //closed before it was up, the next service shuts it
+            _host_update(pcb);
+            return;
+        }
+        pcb->state = ESTABLISHED;
+        _host_addresses(pcb);
+        _host_update(pcb);
+        owner = _host_hold(pcb);
+    }
+    if(owner && !owner->dead){
+        AsyncClient::_s_connected(owner->client, pcb, ERR_OK);
+    }
+    _release_event_owner(owner);
+    _host_kick(pcb);
+}
+
+static void _host_fin(tcp_pcb * pcb){
+    async_event_owner * owner;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        pcb->eof = true;
+        if(pcb->closing){
+            //we closed first and were waiting for this
+            if(!pcb->tx_len){
+                _host_shut(pcb, false);
+            }
+            return;
+        }
+        pcb->state = CLOSE_WAIT;
+        owner = _host_hold(pcb);
+    }
+    if(owner && !owner->dead && owner->client->pcb() == pcb){
+        //like LwIP: closed (or aborted) first, then the async side is told
+        AsyncClient * client = owner->client;
+        AsyncClient::_s_lwip_fin(client, pcb, ERR_OK);
+        if(!owner->dead){
+            AsyncClient::_s_fin(client, pcb, ERR_OK);
+        }
+    } else {
+        _host_close(pcb, false);
+    }
+    _release_event_owner(owner);
+}
+
+static void _host_read(tcp_pcb * pcb, uint32_t events){
+    static char buffer[CONFIG_ASYNC_TCP_HOST_WND];
+    async_event_owner * owner = NULL;
+    size_t room;
+    bool discard;
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        if(pcb->dead){
+            return;
+        }
+        discard = pcb->closing;
+        room = discard ? sizeof(buffer) : CONFIG_ASYNC_TCP_HOST_WND - pcb->rx_held;
+        if(!room){
+            if(events & EPOLLHUP){
+                pcb->hup = true;
+            }
+            _host_update(pcb);
+            return;
+        }
+        if(!discard){
+            owner = _host_hold(pcb);
+        }
+    }
+    ssize_t len = recv(pcb->fd, buffer, room, MSG_DONTWAIT);
+    if(len < 0){
+        int error = errno;
+        _release_event_owner(owner);
+        if(error != EAGAIN && error != EWOULDBLOCK && error != EINTR){
+            _host_fail(pcb, _host_error(error));
+        }
+        return;
+    }
+    if(len == 0){
+        _release_event_owner(owner);
+        _host_fin(pcb);
+        return;
+    }
+    if(discard || !owner || owner->dead){
+        _release_event_owner(owner);
+        return;
+    }
+    //one pbuf per MSS, like LwIP hands them over
+    pbuf * head = NULL;
+    pbuf ** tail = &head;
+    size_t offset = 0;
+    while(offset < (size_t)len){
+        uint16_t part = ((size_t)len - offset > CONFIG_ASYNC_TCP_HOST_MSS) ? CONFIG_ASYNC_TCP_HOST_MSS : (uint16_t)(len - offset);
+        pbuf * pb = (pbuf *)malloc(sizeof(pbuf) + part);
+        if(!pb){
+            break;
+        }
+        pb->next = NULL;
+        pb->payload = pb + 1;
+        pb->len = part;
+        pb->tot_len = (uint16_t)(len - offset);
+        memcpy(pb->payload, buffer + offset, part);
+        *tail = pb;
+        tail = &pb->next;
+        offset += part;
+    }
+    if(offset < (size_t)len){
+        pbuf_free(head);
+        _release_event_owner(owner);
+        _host_fail(pcb, ERR_MEM);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(pcb->lock);
+        pcb->rx_held += len;
+    }
+    AsyncClient::_s_recv(owner->client, pcb, head, ERR_OK);
+    _release_event_owner(owner);
+    //a full window stops reading until the client acks
+    _host_kick(pcb);
+}
+
+static void _host_dispatch(tcp_pcb * pcb, uint32_t events){
+    if(pcb->dead){
+        return;
+    }
+    uint8_t state = pcb->state;
+    if(state == LISTEN){
+        _host_accept(pcb);
+    } else if(state == SYN_SENT){
+        _host_connected(pcb);
+    } else {
+        if(events & EPOLLERR){
+            int error = _host_socket_error(pcb->fd);
+            if(error){
+                _host_fail(pcb, _host_error(error));
+                return;
+            }
+        }
+        if(events & (EPOLLIN | EPOLLHUP)){
+            _host_read(pcb, events);
+        }
+        if(events & EPOLLOUT){
+            _host_service(pcb);
+        }
+    }
+}
+
+//services kicked pcbs and timer re-checks asked for by other threads, until there are none
+static void _host_drain(){
+    std::vector<tcp_pcb *> kicked;
+    std::vector<async_event_owner *> rearm;
+    for(;;){
+        {
+            std::lock_guard<std::mutex> guard(_host_lock);
+            kicked.swap(_host_kicked);
+            rearm.swap(_host_rearm);
+            for(tcp_pcb * pcb : kicked){
+                pcb->kicked = false;
+            }
+        }
+        if(kicked.empty() && rearm.empty()){
+            return;
+        }
+        for(tcp_pcb * pcb : kicked){
+            _host_service(pcb);
+        }
+        for(async_event_owner * owner : rearm){
+            if(owner->dead){
+                _stale_discarded++;
+            } else {
+                owner->client->_poll_queued = false;
+                AsyncClient::_s_poll(owner->client, owner->client->pcb());
+            }
+            _release_event_owner(owner);
+        }
+        kicked.clear();
+        rearm.clear();
+    }
+}
+
+//frees the pcbs closed in this iteration, once a second resets those that take too long to close
+static void _host_reap(){
+    uint32_t now = millis();
+    bool sweep = (now - _host_last_sweep) >= 1000;
+    if(!_host_dead && !sweep){
+        return;
+    }
+    std::vector<tcp_pcb *> pcbs;
+    {
+        std::lock_guard<std::mutex> guard(_host_lock);
+        pcbs = _host_pcbs;
+    }
+    if(sweep){
+        _host_last_sweep = now;
+        for(tcp_pcb * pcb : pcbs){
+            std::lock_guard<std::mutex> guard(pcb->lock);
+            if(!pcb->dead && pcb->closing && (now - pcb->closed_at) >= CONFIG_ASYNC_TCP_HOST_LINGER){
+                _host_shut(pcb, true);
+            }
+        }
+    }
+    if(!_host_dead){
+        return;
+    }
+    std::vector<tcp_pcb *> dead;
+    {
+        std::lock_guard<std::mutex> guard(_host_lock);
+        auto alive = [](tcp_pcb * pcb){ return !pcb->dead; };
+        auto split = std::stable_partition(_host_pcbs.begin(), _host_pcbs.end(), alive);
+        dead.assign(split, _host_pcbs.end());
+        _host_pcbs.erase(split, _host_pcbs.end());
+        _host_kicked.erase(std::remove_if(_host_kicked.begin(), _host_kicked.end(), [](tcp_pcb * pcb){ return pcb->dead; }), _host_kicked.end());
+    }
+    for(tcp_pcb * pcb : dead){
+        _release_event_owner(pcb->owner);
+        delete pcb;
+    }
+    _host_dead = 0;
+}
+
+static void _host_loop(){
+    _host_task = xTaskGetCurrentTaskHandle();
+    _host_timers.begin(millis());
+    _host_last_sweep = millis();
+    struct epoll_event events[64];
+    for(;;){
+        uint32_t wait = _host_timers.next(millis());
+        if(wait > 1000){
+            wait = 1000;
+        }
+        int count = epoll_wait(_host_epoll, events, 64, (int)wait);
+        if(count < 0 && errno != EINTR){
+            log_e("epoll error: %d", errno);
+        }
+        for(int i = 0; i < count; ++i){
+            tcp_pcb * pcb = reinterpret_cast<tcp_pcb *>(events[i].data.ptr);
+            if(!pcb){
+                uint64_t value;
+                while(read(_host_wake, &value, sizeof(value)) > 0);
+                continue;
+            }
+            _host_dispatch(pcb, events[i].events);
+        }
+        _host_drain();
+        _host_timers.advance(millis(), _event_timer_expired, NULL);
+        _host_drain();
+        _host_reap();
+    }
+}
+
+static bool _host_start(){
+    static std::once_flag once;
+    static bool started = false;
+    std::call_once(once, [](){
+        _host_epoll = epoll_create1(EPOLL_CLOEXEC);
+        _host_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(_host_epoll < 0 || _host_wake < 0){
+            log_e("epoll/eventfd error: %d", errno);
+            return;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        if(epoll_ctl(_host_epoll, EPOLL_CTL_ADD, _host_wake, &ev) < 0){
+            log_e("epoll error: %d", errno);
+            return;
+        }
+        _tx_refs_lock = xSemaphoreCreateMutex();
+        if(CONFIG_ASYNC_TCP_CLIENT_POOL_SIZE && !_client_pool.begin(CONFIG_ASYNC_TCP_CLIENT_POOL_SIZE)){
+            log_w("client pool disabled, falling back to heap");
+        }
+        if(CONFIG_ASYNC_TCP_TX_REF_POOL_SIZE > 0 && !_tx_ref_pool.begin(CONFIG_ASYNC_TCP_TX_REF_POOL_SIZE)){
+            log_w("tx ref pool disabled, falling back to heap");
+        }
+        std::thread(_host_loop).detach();
+        started = true;
+    });
+    return started;
+}
+
+extern "C" uint8_t pbuf_free(struct pbuf *p){
+    uint8_t count = 0;
+    while(p){
+        pbuf * next = p->next;
+        ::free(p);
+        p = next;
+        count++;
+    }
+    return count;
+}
+
+/*
+  Async TCP Client, the parts that talk to the event loop directly.
+  Everything else is in src/AsyncTCPClient.cpp.
+ */
+
+bool AsyncClient::_connect(ip_addr_t addr, uint16_t port){
+    if (_pcb){
+        log_w("already connected, state %d", _pcb->state.load());
+        return false;
+    }
+    if(!_host_start()){
+        log_e("failed to start task");
+        return false;
+    }
+
+    sockaddr_storage ss;
+    socklen_t len = _host_sockaddr(&addr, port, &ss);
+    int fd = socket(ss.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0){
+        log_e("socket error: %d", errno);
+        return false;
+    }
+    if (::connect(fd, (sockaddr *)&ss, len) < 0 && errno != EINPROGRESS){
+        log_e("connect error: %d", errno);
+        ::close(fd);
+        return false;
+    }
+
+    _attach_event_owner();
+    //unlike LwIP the pcb is ours right away, so close() works while connecting
+    _pcb = _host_new_pcb(fd, SYN_SENT, _events);
+    _host_kick(_pcb);
+    return true;
+}
+
+//resolves in the calling thread, there is no DNS callback on the host
+bool AsyncClient::connect(const char* host, uint16_t port){
+    struct addrinfo hints;
+    struct addrinfo * result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int err = getaddrinfo(host, NULL, &hints, &result);
+    if(err != 0 || !result) {
+        log_e("error: %d", err);
+        return false;
+    }
+    sockaddr_storage ss;
+    memcpy(&ss, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    ip_addr_t addr;
+    uint16_t unused;
+    _host_ip_addr(&ss, &addr, &unused);
+    return _connect(addr, port);
+}
+
+//From any thread: the wheel belongs to the event loop, so others ask it to re-check
+void AsyncClient::_rearm_timer(){
+    if(!_events || _events->dead){
+        return;
+    }
+    if(_in_async_task_for(this)){
+        _schedule_timer();
+        return;
+    }
+    //a re-check that is still pending will do the same job
+    if(_poll_queued.exchange(true)){
+        _poll_coalesced++;
+        return;
+    }
+    if(!_host_start()){
+        _poll_queued = false;
+        return;
+    }
+    _events->refs++;
+    {
+        std::lock_guard<std::mutex> guard(_host_lock);
+        _host_rearm.push_back(_events);
+    }
+    uint64_t one = 1;
+    if(::write(_host_wake, &one, sizeof(one)) < 0 && errno != EAGAIN){
+        log_e("wake error: %d", errno);
+    }
+}
+
+//the loop never frees a pcb a client still points to, there is no slot to track
+void AsyncClient::_allocate_closed_slot(){
+}
+
+void AsyncClient::_free_closed_slot(){
+}
+
+//In the event loop, first half of the FIN
+int8_t AsyncClient::_lwip_fin(tcp_pcb* pcb, int8_t err) {
+    if(!_pcb || pcb != _pcb){
+        log_e("%p != %p", pcb, _pcb);
+        return ERR_OK;
+    }
+    int8_t result = ERR_OK;
+    //unacked zero-copy data must not outlive the connection, see _close()
+    if(_tx_refs_pending) {
+        result = ERR_ABRT;
+    }
+    _host_close(_pcb, result != ERR_OK);
+    _pcb = NULL;
+    return result;
+}
+
+/*
+  Async TCP Server
+ */
+
+static int _host_listen(const ip_addr_t * addr, uint16_t port, bool v6only){
+    sockaddr_storage ss;
+    socklen_t len = _host_sockaddr(addr, port, &ss);
+    int fd = socket(ss.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0){
+        return -1;
+    }
+    int on = 1;
+    int v6 = v6only ? 1 : 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (ss.ss_family == AF_INET6){
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6, sizeof(v6));
+    }
+    if (bind(fd, (sockaddr *)&ss, len) < 0 || listen(fd, SOMAXCONN) < 0){
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+void AsyncServer::begin(){
+    if(_pcb) {
+        return;
+    }
+
+    if(!_host_start()){
+        log_e("failed to start task");
+        return;
+    }
+
+    ip_addr_t local_addr;
+    int fd = -1;
+    if(_bind6) {
+        //both: one dual-stack socket, the v6 address is the any address then
+        memset(&local_addr, 0, sizeof(local_addr));
+        memcpy(local_addr.u_addr.ip6.addr, static_cast<const uint32_t*>(_addr6), 16);
+        local_addr.type = IPADDR_TYPE_V6;
+        fd = _host_listen(&local_addr, _port, !_bind4);
+    }
+    if(fd < 0 && _bind4) {
+        //also when the host has no IPv6
+        ip_addr_set_ip4_u32(&local_addr, _addr);
+        fd = _host_listen(&local_addr, _port, false);
+    }
+    if (fd < 0) {
+        log_e("bind error: %d", errno);
+        return;
+    }
+
+    _pcb = _host_new_pcb(fd, LISTEN, NULL, this);
+    _host_kick(_pcb);
+}
+
+void AsyncServer::end(){
+    if(_pcb){
+        _host_close(_pcb, false);
+        _pcb = NULL;
+    }
+}
+
+//runs in the event loop
+int8_t AsyncServer::_accept(tcp_pcb* pcb, int8_t err){
+    if(_connect_cb){
+        AsyncClient *c = new AsyncClient(pcb);
+        if(c){
+            c->setNoDelay(_noDelay);
+            return _s_accepted(this, c);
+        }
+    }
+    _host_close(pcb, false);
+    log_e("FAIL");
+    return ERR_OK;
+}
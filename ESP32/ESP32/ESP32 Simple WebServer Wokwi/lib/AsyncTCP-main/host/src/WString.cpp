@@ -0,0 +1,415 @@
+/*
+  Host shim: Arduino String, see include/WString.h
+*/
+
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static std::string _number(unsigned long long value, bool negative, unsigned char base){
+    char buf[8 * sizeof(value) + 2];
+    char *p = buf + sizeof(buf);
+    if(base < 2 || base > 36){
+        base = 10;
+    }
+    *--p = '\0';
+    do {
+        unsigned digit = value % base;
+        *--p = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
+        value /= base;
+    } while(value);
+    if(negative){
+        *--p = '-';
+    }
+    return std::string(p);
+}
+
+static std::string _signed(long long value, unsigned char base){
+    //like itoa() only base 10 gets a sign, other bases show the two's complement
+    if(base == 10 && value < 0){
+        return _number(0ULL - (unsigned long long)value, true, base);
+    }
+    return _number((unsigned long long)value, false, base);
+}
+
+static std::string _float(double value, unsigned int decimalPlaces){
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+    return std::string(buf);
+}
+
+/*
+ * Constructors
+ * */
+
+String::String(const char *cstr){
+    if(cstr){
+        _buffer = cstr;
+    }
+}
+
+String::String(const char *cstr, unsigned int length){
+    if(cstr){
+        _buffer.assign(cstr, length);
+    }
+}
+
+String::String(char c) : _buffer(1, c) {}
+String::String(unsigned char value, unsigned char base) : _buffer(_number(value, false, base)) {}
+String::String(int value, unsigned char base) : _buffer(_signed(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _buffer(_number(value, false, base)) {}
+String::String(long value, unsigned char base) : _buffer(_signed(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _buffer(_number(value, false, base)) {}
+String::String(long long value, unsigned char base) : _buffer(_signed(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _buffer(_number(value, false, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _buffer(_float(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _buffer(_float(value, decimalPlaces)) {}
+
+bool String::reserve(unsigned int size){
+    _buffer.reserve(size);
+    return true;
+}
+
+/*
+ * Assignment and Concatenation
+ * */
+
+String & String::operator =(const String &rhs){
+    if(this != &rhs){
+        _buffer = rhs._buffer;
+    }
+    return *this;
+}
+
+String & String::operator =(String &&rval){
+    if(this != &rval){
+        _buffer.swap(rval._buffer);
+    }
+    return *this;
+}
+
+String & String::operator =(const char *cstr){
+    if(cstr){
+        _buffer = cstr;
+    } else {
+        _buffer.clear();
+    }
+    return *this;
+}
+
+String & String::operator =(const __FlashStringHelper *str){
+    return *this = reinterpret_cast<const char *>(str);
+}
+
+bool String::concat(const String &str){
+    _buffer.append(str._buffer);
+    return true;
+}
+
+bool String::concat(const char *cstr){
+    if(!cstr){
+        return false;
+    }
+    _buffer.append(cstr);
+    return true;
+}
+
+bool String::concat(const char *cstr, unsigned int length){
+    if(!cstr){
+        return false;
+    }
+    _buffer.append(cstr, length);
+    return true;
+}
+
+bool String::concat(const __FlashStringHelper *str){
+    return concat(reinterpret_cast<const char *>(str));
+}
+
+bool String::concat(char c){
+    _buffer.push_back(c);
+    return true;
+}
+
+bool String::concat(unsigned char num){ _buffer.append(_number(num, false, 10)); return true; }
+bool String::concat(int num){ _buffer.append(_signed(num, 10)); return true; }
+bool String::concat(unsigned int num){ _buffer.append(_number(num, false, 10)); return true; }
+bool String::concat(long num){ _buffer.append(_signed(num, 10)); return true; }
+bool String::concat(unsigned long num){ _buffer.append(_number(num, false, 10)); return true; }
+bool String::concat(long long num){ _buffer.append(_signed(num, 10)); return true; }
+bool String::concat(unsigned long long num){ _buffer.append(_number(num, false, 10)); return true; }
+bool String::concat(float num){ _buffer.append(_float(num, 2)); return true; }
+bool String::concat(double num){ _buffer.append(_float(num, 2)); return true; }
+
+//the left side is always a temporary, it collects the whole expression like the ESP32 core does
+#define STRING_SUM(type) \
+StringSumHelper & operator +(const StringSumHelper &lhs, type rhs){ \
+    StringSumHelper &a = const_cast<StringSumHelper&>(lhs); \
+    a.concat(rhs); \
+    return a; \
+}
+
+STRING_SUM(const String &)
+STRING_SUM(const char *)
+STRING_SUM(const __FlashStringHelper *)
+STRING_SUM(char)
+STRING_SUM(unsigned char)
+STRING_SUM(int)
+STRING_SUM(unsigned int)
+STRING_SUM(long)
+STRING_SUM(unsigned long)
+STRING_SUM(long long)
+STRING_SUM(unsigned long long)
+STRING_SUM(float)
+STRING_SUM(double)
+
+/*
+ * Comparison
+ * */
+
+int String::compareTo(const String &s) const {
+    return strcmp(c_str(), s.c_str());
+}
+
+bool String::equals(const String &s) const {
+    return _buffer == s._buffer;
+}
+
+bool String::equals(const char *cstr) const {
+    if(!cstr){
+        return _buffer.empty();
+    }
+    return strcmp(c_str(), cstr) == 0;
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+    return length() == s.length() && strcasecmp(c_str(), s.c_str()) == 0;
+}
+
+bool String::equalsConstantTime(const String &s) const {
+    if(length() != s.length()){
+        return false;
+    }
+    unsigned char diff = 0;
+    for(unsigned int i = 0; i < length(); i++){
+        diff |= _buffer[i] ^ s._buffer[i];
+    }
+    return diff == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+    return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+    if(offset > length() || prefix.length() > length() - offset){
+        return false;
+    }
+    return _buffer.compare(offset, prefix.length(), prefix._buffer) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+    if(suffix.length() > length()){
+        return false;
+    }
+    return _buffer.compare(length() - suffix.length(), suffix.length(), suffix._buffer) == 0;
+}
+
+/*
+ * Character Access
+ * */
+
+char String::charAt(unsigned int index) const {
+    return operator [](index);
+}
+
+void String::setCharAt(unsigned int index, char c){
+    if(index < length()){
+        _buffer[index] = c;
+    }
+}
+
+char String::operator [](unsigned int index) const {
+    if(index >= length()){
+        return 0;
+    }
+    return _buffer[index];
+}
+
+char & String::operator [](unsigned int index){
+    static char dummy_writable_char;
+    if(index >= length()){
+        dummy_writable_char = 0;
+        return dummy_writable_char;
+    }
+    return _buffer[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const {
+    if(!bufsize || !buf){
+        return;
+    }
+    if(index >= length()){
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if(n > length() - index){
+        n = length() - index;
+    }
+    memcpy(buf, c_str() + index, n);
+    buf[n] = 0;
+}
+
+/*
+ * Search
+ * */
+
+int String::indexOf(char ch) const {
+    return indexOf(ch, 0);
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if(fromIndex >= length()){
+        return -1;
+    }
+    size_t found = _buffer.find(ch, fromIndex);
+    return (found == std::string::npos) ? -1 : (int)found;
+}
+
+int String::indexOf(const String &str) const {
+    return indexOf(str, 0);
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+    if(fromIndex >= length()){
+        return -1;
+    }
+    size_t found = _buffer.find(str._buffer, fromIndex);
+    return (found == std::string::npos) ? -1 : (int)found;
+}
+
+int String::lastIndexOf(char ch) const {
+    return lastIndexOf(ch, length() - 1);
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+    if(fromIndex >= length()){
+        return -1;
+    }
+    size_t found = _buffer.rfind(ch, fromIndex);
+    return (found == std::string::npos) ? -1 : (int)found;
+}
+
+int String::lastIndexOf(const String &str) const {
+    if(str.length() > length()){
+        return -1;
+    }
+    return lastIndexOf(str, length() - str.length());
+}
+
+int String::lastIndexOf(const String &str, unsigned int fromIndex) const {
+    if(str.length() == 0 || str.length() > length() || fromIndex >= length()){
+        return -1;
+    }
+    size_t found = _buffer.rfind(str._buffer, fromIndex);
+    return (found == std::string::npos) ? -1 : (int)found;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+    if(left > right){
+        unsigned int temp = right;
+        right = left;
+        left = temp;
+    }
+    String out;
+    if(left >= length()){
+        return out;
+    }
+    if(right > length()){
+        right = length();
+    }
+    out._buffer.assign(_buffer, left, right - left);
+    return out;
+}
+
+/*
+ * Modification
+ * */
+
+void String::replace(char find, char replace){
+    for(char &c : _buffer){
+        if(c == find){
+            c = replace;
+        }
+    }
+}
+
+void String::replace(const String &find, const String &replace){
+    if(find.length() == 0){
+        return;
+    }
+    size_t pos = 0;
+    while((pos = _buffer.find(find._buffer, pos)) != std::string::npos){
+        _buffer.replace(pos, find.length(), replace._buffer);
+        pos += replace.length();
+    }
+}
+
+void String::remove(unsigned int index){
+    remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count){
+    if(index >= length()){
+        return;
+    }
+    if(count > length() - index){
+        count = length() - index;
+    }
+    _buffer.erase(index, count);
+}
+
+void String::toLowerCase(){
+    for(char &c : _buffer){
+        c = tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase(){
+    for(char &c : _buffer){
+        c = toupper((unsigned char)c);
+    }
+}
+
+void String::trim(){
+    size_t begin = 0;
+    size_t end = _buffer.length();
+    while(begin < end && isspace((unsigned char)_buffer[begin])){
+        begin++;
+    }
+    while(end > begin && isspace((unsigned char)_buffer[end - 1])){
+        end--;
+    }
+    _buffer = _buffer.substr(begin, end - begin);
+}
+
+/*
+ * Parsing/Conversion
+ * */
+
+long String::toInt() const {
+    return atol(c_str());
+}
+
+float String::toFloat() const {
+    return atof(c_str());
+}
+
+double String::toDouble() const {
+    return atof(c_str());
+}
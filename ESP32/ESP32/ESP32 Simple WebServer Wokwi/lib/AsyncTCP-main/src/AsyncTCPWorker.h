@@ -0,0 +1,37 @@
+/*
+  Asynchronous TCP library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ASYNCTCPWORKER_H_
+#define ASYNCTCPWORKER_H_
+
+#include <stdint.h>
+
+/*
+ * Which of the async_tcp workers handles the events of an object.
+ * All events of one connection go to the same worker, so they stay in order.
+ * The hash only has to be stable for the lifetime of the object.
+ * */
+static inline int async_tcp_worker_for(const void * owner, int workers){
+    uint32_t hash = (uint32_t)((uintptr_t)owner >> 3) * 2654435761u;
+    return (hash >> 16) % workers;
+}
+
+#endif /* ASYNCTCPWORKER_H_ */
@@ -0,0 +1,249 @@
+/*
+  Host benchmark: a sensor snapshot as JSON, String concatenation vs sendJson()
+
+  The snapshot of the WS dashboard with the servo, the uptime and a status
+  next to the two readings is loaded over and over on one keep-alive
+  connection from the loopback. Every malloc, calloc and realloc made by the
+  process while it is served is counted, with the bytes asked for.
+
+  "string" is how the /sensors handler of the WS project builds it, one
+  String added to the next, and send() copies it again into the response.
+  "snprintf" formats it into a buffer on the stack first, which send() still
+  copies into a String. "sendJson" writes the fields of the struct straight
+  into the transmit buffer. AsyncJsonResponse is not measured, ArduinoJson
+  is not in lib/; it builds a DynamicJsonDocument of 1024 bytes before it
+  measures and then writes it.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -I../../AsyncTCP-main/host/include -I../../AsyncTCP-main/src -I../src json_bench.cpp ../src/*.cpp ../../AsyncTCP-main/src/AsyncTCPClient.cpp ../../AsyncTCP-main/host/src/*.cpp -o json_bench -lpthread
+//  ./json_bench [loads] [port]
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <malloc.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static std::atomic<bool> counting(false);
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> allocated(0);
+
+static void *track(void *ptr){
+    if(ptr != NULL && counting){
+        allocations++;
+        allocated += malloc_usable_size(ptr);
+    }
+    return ptr;
+}
+
+extern "C" void *malloc(size_t size){
+    return track(__libc_malloc(size));
+}
+
+extern "C" void *calloc(size_t count, size_t size){
+    return track(__libc_calloc(count, size));
+}
+
+extern "C" void *realloc(void *ptr, size_t size){
+    return track(__libc_realloc(ptr, size));
+}
+
+extern "C" void free(void *ptr){
+    __libc_free(ptr);
+}
+
+struct SensorSnapshot {
+    float temperature;
+    float humidity;
+    int servo;
+    uint32_t uptime;
+    int8_t rssi;
+    char status[12];
+};
+
+static const AsyncJsonField SENSOR_SNAPSHOT_JSON[] = {
+    ASYNC_JSON_FLOAT(SensorSnapshot, temperature, 1),
+    ASYNC_JSON_FLOAT(SensorSnapshot, humidity, 1),
+    ASYNC_JSON_FIELD(SensorSnapshot, servo),
+    ASYNC_JSON_FIELD(SensorSnapshot, uptime),
+    ASYNC_JSON_FIELD(SensorSnapshot, rssi),
+    ASYNC_JSON_FIELD(SensorSnapshot, status)
+};
+
+static SensorSnapshot readings = { 21.5f, 40.0f, 90, 123456, -61, "ok" };
+
+static int connectTo(uint16_t port){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//the body of a response, by its Content-Length or its chunks
+static std::string body(const std::string& response){
+    size_t head = response.find("\r\n\r\n");
+    if(head == std::string::npos){
+        return std::string();
+    }
+    if(response.find("Transfer-Encoding: chunked") > head){
+        return response.substr(head + 4);
+    }
+    std::string out;
+    size_t pos = head + 4;
+    for(;;){
+        size_t size = strtoul(response.c_str() + pos, NULL, 16);
+        pos = response.find("\r\n", pos) + 2;
+        if(!size){
+            return out;
+        }
+        out += response.substr(pos, size);
+        pos += size + 2;
+    }
+}
+
+//one request on the connection, returns the whole answer
+static std::string load(int fd, const char* path){
+    char buf[2048];
+    int n = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n", path);
+    send(fd, buf, n, 0);
+    std::string response;
+    ssize_t r;
+    while((r = recv(fd, buf, sizeof(buf), 0)) > 0){
+        response.append(buf, r);
+        size_t head = response.find("\r\n\r\n");
+        if(head == std::string::npos){
+            continue;
+        }
+        size_t length = response.find("Content-Length: ");
+        if(length < head){
+            if(response.size() >= head + 4 + strtoul(response.c_str() + length + 16, NULL, 10)){
+                break;
+            }
+        } else if(response.size() >= 7 && !response.compare(response.size() - 4, 4, "\r\n\r\n")
+            && response.find("\r\n0", head) != std::string::npos){
+            break;
+        }
+    }
+    return response;
+}
+
+static double now_s(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static String concatenate(){
+    return "{\"temperature\":" + String(readings.temperature, 1) +
+           ",\"humidity\":" + String(readings.humidity, 1) +
+           ",\"servo\":" + String(readings.servo) +
+           ",\"uptime\":" + String(readings.uptime) +
+           ",\"rssi\":" + String(readings.rssi) +
+           ",\"status\":\"" + String(readings.status) + "\"}";
+}
+
+static size_t format(char* json, size_t size){
+    return snprintf(json, size,
+        "{\"temperature\":%.1f,\"humidity\":%.1f,\"servo\":%d,\"uptime\":%u,\"rssi\":%d,\"status\":\"%s\"}",
+        readings.temperature, readings.humidity, readings.servo, readings.uptime, readings.rssi, readings.status);
+}
+
+//the serializing alone, into a buffer the size of the transmit buffer
+static void serialize(uint32_t rounds){
+    static uint8_t buf[ASYNCWEBSERVER_TX_BUFFER_SIZE];
+    size_t seen = 0;
+    double start;
+
+    allocations = 0;
+    counting = true;
+    start = now_s();
+    for(uint32_t i = 0; i < rounds; i++){
+        String json = concatenate();
+        memcpy(buf, json.c_str(), json.length());
+        seen += json.length();
+    }
+    printf("%-8s: %9.0f snapshots/s | %5.1f allocations per snapshot\n", "string", rounds / (now_s() - start), (double)allocations / rounds);
+
+    allocations = 0;
+    start = now_s();
+    for(uint32_t i = 0; i < rounds; i++){
+        seen += format((char*)buf, sizeof(buf));
+    }
+    printf("%-8s: %9.0f snapshots/s | %5.1f allocations per snapshot\n", "snprintf", rounds / (now_s() - start), (double)allocations / rounds);
+
+    allocations = 0;
+    start = now_s();
+    for(uint32_t i = 0; i < rounds; i++){
+        AsyncJsonWriter writer(&readings, SENSOR_SNAPSHOT_JSON, sizeof(SENSOR_SNAPSHOT_JSON) / sizeof(AsyncJsonField));
+        seen += writer.write(buf, sizeof(buf));
+    }
+    printf("%-8s: %9.0f snapshots/s | %5.1f allocations per snapshot\n", "writer", rounds / (now_s() - start), (double)allocations / rounds);
+    counting = false;
+    if(!seen){
+        printf("nothing written\n");
+    }
+}
+
+static void run(const char* name, uint16_t port, const char* path, uint32_t loads){
+    int fd = connectTo(port);
+    std::string expected = body(load(fd, path));
+    bool ok = expected == "{\"temperature\":21.5,\"humidity\":40.0,\"servo\":90,\"uptime\":123456,\"rssi\":-61,\"status\":\"ok\"}";
+    allocations = 0;
+    allocated = 0;
+    counting = true;
+    double start = now_s();
+    for(uint32_t i = 0; i < loads; i++){
+        ok &= (body(load(fd, path)) == expected);
+    }
+    double elapsed = now_s() - start;
+    counting = false;
+    close(fd);
+    //the client's own strings are counted too, the same for every variant
+    printf("%-8s: %6.0f loads/s | %5.1f allocations, %6.0f bytes per load%s\n", name,
+        loads / elapsed, (double)allocations / loads, (double)allocated / loads, ok ? "" : " | BAD RESPONSE");
+}
+
+int main(int argc, char ** argv){
+    uint32_t loads = (argc > 1) ? atoi(argv[1]) : 20000;
+    uint16_t port = (argc > 2) ? atoi(argv[2]) : 18092;
+
+    AsyncWebServer server(port);
+    //every load on the one connection
+    server.setKeepAlive(ASYNCWEBSERVER_KEEPALIVE_TIMEOUT, 0);
+    server.on("/string", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->send(200, "application/json", concatenate());
+    });
+    server.on("/snprintf", HTTP_GET, [](AsyncWebServerRequest *request){
+        char json[160];
+        format(json, sizeof(json));
+        request->send(200, "application/json", json);
+    });
+    server.on("/json", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->sendJson(200, readings, SENSOR_SNAPSHOT_JSON);
+    });
+    server.begin();
+
+    printf("%u snapshots serialized\n", loads * 50);
+    serialize(loads * 50);
+    printf("%u loads of a sensor snapshot\n", loads);
+    run("string", port, "/string", loads);
+    run("snprintf", port, "/snprintf", loads);
+    run("sendJson", port, "/json", loads);
+    return 0;
+}
@@ -0,0 +1,179 @@
+/*
+  Host benchmark: template pages, send_P() with a processor vs sendTemplate()
+
+  A 7 KB page with 16 placeholders is loaded over and over on one keep-alive
+  connection from the loopback. Every malloc, calloc and realloc made by the
+  process while the pages are served is counted.
+
+  "processor" is send_P() with an AwsTemplateProcessor: every block that is
+  sent is searched for '%', text after a placeholder is moved through the
+  response cache and every name and value is a String. "compiled" is
+  sendTemplate() with an AsyncWebTemplate compiled once: the text is copied
+  between the placeholders it found and the values are written with
+  snprintf() into the response.
+
+  Names and values this short fit inside the String itself, on the host as
+  on the ESP32 core, so the allocations are the request's own and the same
+  for both; the difference is the time spent filling the buffers. Longer
+  values allocate once each with the processor.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -I../../AsyncTCP-main/host/include -I../../AsyncTCP-main/src -I../src template_bench.cpp ../src/*.cpp ../../AsyncTCP-main/src/AsyncTCPClient.cpp ../../AsyncTCP-main/host/src/*.cpp -o template_bench -lpthread
+//  ./template_bench [loads] [port]
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static volatile bool counting = false;
+static std::atomic<uint64_t> allocations(0);
+
+extern "C" void *malloc(size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size){
+    if(counting){
+        allocations++;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr){
+    __libc_free(ptr);
+}
+
+//no other '%' in it, the processor would take the text between two for a name
+static char PAGE[7 * 1024];
+
+static void makePage(){
+    size_t len = 0;
+    len += snprintf(PAGE + len, sizeof(PAGE) - len, "<!DOCTYPE html><html><head><title>ESP32 Sensor Monitor</title></head><body>\n");
+    int row = 0;
+    while(len < sizeof(PAGE) - 256){
+        if(row < 16){
+            len += snprintf(PAGE + len, sizeof(PAGE) - len, "  <div class=\"reading\">sensor %d: %%SENSOR_%d%%</div>\n", row, row);
+        } else {
+            len += snprintf(PAGE + len, sizeof(PAGE) - len, "  <div class=\"reading-card\" style=\"padding: 20px; margin: 10px\"></div>\n");
+        }
+        row++;
+    }
+    snprintf(PAGE + len, sizeof(PAGE) - len, "</body></html>\n");
+}
+
+static float reading(const char* name){
+    return 20.0f + atoi(name + 7) / 10.0f;
+}
+
+static int connectTo(uint16_t port){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//the last chunk, its size is padded with spaces: "\r\n0   \r\n\r\n"
+static bool lastChunk(const std::string& response){
+    size_t end = response.size();
+    if(end < 7 || response.compare(end - 4, 4, "\r\n\r\n")){
+        return false;
+    }
+    end -= 4;
+    while(end && response[end - 1] == ' '){
+        end--;
+    }
+    return end >= 3 && !response.compare(end - 3, 3, "\r\n0");
+}
+
+//one request on the connection, returns the bytes of the chunked answer
+static std::string load(int fd, const char* path){
+    char buf[4096];
+    int n = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n", path);
+    send(fd, buf, n, 0);
+    std::string response;
+    ssize_t r;
+    while((r = recv(fd, buf, sizeof(buf), 0)) > 0){
+        response.append(buf, r);
+        if(lastChunk(response)){
+            break;
+        }
+    }
+    return response;
+}
+
+static double now_s(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void run(const char* name, uint16_t port, const char* path, uint32_t loads){
+    int fd = connectTo(port);
+    std::string expected = load(fd, path);
+    bool ok = expected.find("sensor 15: 21.5") != std::string::npos;
+    allocations = 0;
+    counting = true;
+    double start = now_s();
+    for(uint32_t i = 0; i < loads; i++){
+        ok &= (load(fd, path).size() == expected.size());
+    }
+    double elapsed = now_s() - start;
+    counting = false;
+    close(fd);
+    printf("%-9s: %6.0f loads/s | %6.1f allocations per load%s\n", name,
+        loads / elapsed, (double)allocations / loads, ok ? "" : " | BAD RESPONSE");
+}
+
+int main(int argc, char ** argv){
+    uint32_t loads = (argc > 1) ? atoi(argv[1]) : 2000;
+    uint16_t port = (argc > 2) ? atoi(argv[2]) : 18091;
+
+    makePage();
+    static AsyncWebTemplate page(PAGE);
+    AsyncWebServer server(port);
+    //every load on the one connection
+    server.setKeepAlive(ASYNCWEBSERVER_KEEPALIVE_TIMEOUT, 0);
+    server.on("/processor", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->send_P(200, "text/html", PAGE, [](const String& var) -> String {
+            return String(reading(var.c_str()), 1);
+        });
+    });
+    server.on("/compiled", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->sendTemplate(200, "text/html", page, [](const char* name, char* buffer, size_t size) -> size_t {
+            return snprintf(buffer, size, "%.1f", reading(name));
+        });
+    });
+    server.begin();
+
+    printf("%u loads of a %u byte page, %u placeholders\n", loads, (unsigned)strlen(PAGE), (unsigned)page.placeholders());
+    run("processor", port, "/processor", loads);
+    run("compiled", port, "/compiled", loads);
+    return 0;
+}
@@ -0,0 +1,238 @@
+/*
+  Host benchmark: one WebSocket message to every client, copied per client vs a shared frame
+
+  1, 8 and 32 WebSocket clients connect from a second process over the
+  loopback and read everything they are sent. The same text message is
+  broadcast to all of them over and over, the next one as soon as every
+  queue has room again. Every malloc, calloc and realloc made by the server
+  process from the first broadcast until the last byte was read is counted,
+  with the bytes asked for, and so is the CPU time of the server process.
+
+  "copies" is client->text() for each client: every client copies the
+  payload into its own message and frames it itself, as textAll() did
+  before. "buffer" is the makeBuffer() way: one copy of the payload shared
+  by the clients, each still with its own message, and the header built and
+  the payload copied into TCP once per client. "shared" is textAll(): one
+  frame, header and payload, that every client queue points at and hands
+  to TCP without a copy.
+
+  The host backend mallocs a copy of every write that is not zero-copy, as
+  LwIP allocates a pbuf for it on the board. Its CPU time is mostly the
+  send() each client costs, the same for all three; on the board the copies
+  into LwIP count for more.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -I../../AsyncTCP-main/host/include -I../../AsyncTCP-main/src -I../src ws_broadcast_bench.cpp ../src/*.cpp ../../AsyncTCP-main/src/AsyncTCPClient.cpp ../../AsyncTCP-main/host/src/*.cpp -o ws_broadcast_bench -lpthread
+//  ./ws_broadcast_bench [broadcasts] [port]
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <string>
+#include <malloc.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static std::atomic<bool> counting(false);
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> allocated(0);
+
+static void *track(void *ptr){
+    if(ptr != NULL && counting){
+        allocations++;
+        allocated += malloc_usable_size(ptr);
+    }
+    return ptr;
+}
+
+extern "C" void *malloc(size_t size){
+    return track(__libc_malloc(size));
+}
+
+extern "C" void *calloc(size_t count, size_t size){
+    return track(__libc_calloc(count, size));
+}
+
+extern "C" void *realloc(void *ptr, size_t size){
+    return track(__libc_realloc(ptr, size));
+}
+
+extern "C" void free(void *ptr){
+    __libc_free(ptr);
+}
+
+#define MAX_CLIENTS 32
+
+static AsyncWebSocketClient *clients[MAX_CLIENTS];
+static std::atomic<uint32_t> connected(0);
+
+static int connectTo(uint16_t port){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//the second process: opens the clients and reads until each has every frame
+static void readers(uint16_t port, uint32_t count, size_t expected){
+    int fds[MAX_CLIENTS];
+    size_t received[MAX_CLIENTS];
+    char buf[16384];
+    for(uint32_t i = 0; i < count; i++){
+        fds[i] = connectTo(port);
+        const char *upgrade = "GET /ws HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+        send(fds[i], upgrade, strlen(upgrade), 0);
+        std::string head;
+        while(head.find("\r\n\r\n") == std::string::npos){
+            ssize_t r = recv(fds[i], buf, 1, 0);
+            if(r <= 0){
+                _exit(1);
+            }
+            head.append(buf, r);
+        }
+        received[i] = 0;
+    }
+    uint32_t done = 0;
+    while(done < count){
+        pollfd pfds[MAX_CLIENTS];
+        for(uint32_t i = 0; i < count; i++){
+            pfds[i].fd = (received[i] < expected) ? fds[i] : -1;
+            pfds[i].events = POLLIN;
+        }
+        if(poll(pfds, count, 10000) <= 0){
+            _exit(1);
+        }
+        for(uint32_t i = 0; i < count; i++){
+            if(!(pfds[i].revents & POLLIN)){
+                continue;
+            }
+            ssize_t r = recv(fds[i], buf, sizeof(buf), 0);
+            if(r <= 0){
+                _exit(1);
+            }
+            received[i] += r;
+            if(received[i] >= expected){
+                done++;
+            }
+        }
+    }
+    for(uint32_t i = 0; i < count; i++){
+        close(fds[i]);
+    }
+    _exit(0);
+}
+
+static double cpu_us(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void broadcast(AsyncWebSocket &ws, const char *name, const char *message, size_t len){
+    if(!strcmp(name, "copies")){
+        for(uint32_t i = 0; i < MAX_CLIENTS; i++){
+            if(clients[i]){
+                clients[i]->text(message, len);
+            }
+        }
+    } else if(!strcmp(name, "buffer")){
+        AsyncWebSocketMessageBuffer *buffer = ws.makeBuffer((uint8_t *)message, len);
+        buffer->lock();
+        for(uint32_t i = 0; i < MAX_CLIENTS; i++){
+            if(clients[i]){
+                clients[i]->text(buffer);
+            }
+        }
+        buffer->unlock();
+        ws._cleanBuffers();
+    } else {
+        ws.textAll(message, len);
+    }
+}
+
+static void run(AsyncWebSocket &ws, uint16_t port, const char *name, uint32_t count, const char *message, size_t len, uint32_t broadcasts){
+    size_t frame = len + ((len < 126) ? 2 : 4);
+    pid_t child = fork();
+    if(child == 0){
+        readers(port, count, frame * broadcasts);
+    }
+    while(connected < count){
+        delay(1);
+    }
+    allocations = 0;
+    allocated = 0;
+    counting = true;
+    double start = cpu_us();
+    for(uint32_t i = 0; i < broadcasts; i++){
+        while(!ws.availableForWriteAll()){
+            usleep(20);
+        }
+        broadcast(ws, name, message, len);
+    }
+    int status = 1;
+    waitpid(child, &status, 0);
+    double cpu = cpu_us() - start;
+    counting = false;
+    while(connected){
+        delay(1);
+    }
+    printf("%-6s %2u clients: %6.1f allocations | %7.0f bytes | %6.1f us CPU per broadcast%s\n", name, count,
+        (double)allocations / broadcasts, (double)allocated / broadcasts, cpu / broadcasts,
+        (WIFEXITED(status) && !WEXITSTATUS(status)) ? "" : " | CLIENTS FAILED");
+}
+
+int main(int argc, char **argv){
+    uint32_t broadcasts = (argc > 1) ? atoi(argv[1]) : 2000;
+    uint16_t port = (argc > 2) ? atoi(argv[2]) : 18094;
+
+    AsyncWebServer server(port);
+    AsyncWebSocket ws("/ws");
+    ws.onEvent([](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len){
+        (void)server; (void)arg; (void)data; (void)len;
+        uint32_t slot = client->id() % MAX_CLIENTS;
+        if(type == WS_EVT_CONNECT){
+            clients[slot] = client;
+            connected++;
+        } else if(type == WS_EVT_DISCONNECT){
+            clients[slot] = NULL;
+            connected--;
+        }
+    });
+    server.addHandler(&ws);
+    server.begin();
+
+    static char sensors[] = "{\"temperature\":21.5,\"humidity\":40.0,\"timestamp\":123456}";
+    static char page[1024];
+    memset(page, 'x', sizeof(page));
+    const uint32_t counts[] = { 1, 8, 32 };
+    const char *names[] = { "copies", "buffer", "shared" };
+    for(size_t len : { strlen(sensors), sizeof(page) }){
+        const char *message = (len == sizeof(page)) ? page : sensors;
+        printf("%u broadcasts of %u bytes\n", broadcasts, (unsigned)len);
+        for(uint32_t count : counts){
+            for(const char *name : names){
+                run(ws, port, name, count, message, len, broadcasts);
+            }
+        }
+    }
+    return 0;
+}
@@ -81,8 +81,24 @@ AsyncStaticWebHandler& AsyncStaticWebHandler::setLastModified(){
 }
 #endif
 bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request){
+  if(!request->url().startsWith(_uri)){
+    return false;
+  }
+  return canHandleRoute(request);
+}
+
+WebRouteMode AsyncStaticWebHandler::route(const char *&pattern, size_t &length){
+  //the uri is a file system path here, a { in it is not a parameter
+  if(_uri.indexOf('{') >= 0){
+    return ROUTE_NONE;
+  }
+  pattern = _uri.c_str();
+  length = _uri.length();
+  return ROUTE_PREFIX;
+}
+
+bool AsyncStaticWebHandler::canHandleRoute(AsyncWebServerRequest *request){
   if(request->method() != HTTP_GET 
-    || !request->url().startsWith(_uri) 
     || !request->isExpectedRequestedConnType(RCT_DEFAULT, RCT_HTTP)
   ){
     return false;
@@ -218,3 +234,92 @@ void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request)
     request->send(404);
   }
 }
+
+AsyncAssetWebHandler::AsyncAssetWebHandler(const char* uri, const char* contentType, const uint8_t * content, size_t len, const char* etag, const char* cache_control)
+  : _uri(uri), _contentType(contentType), _content(content), _length(len), _etag(etag), _cache_control(cache_control)
+{
+  // Ensure leading '/'
+  if (_uri.length() == 0 || _uri[0] != '/') _uri = "/" + _uri;
+}
+
+AsyncAssetWebHandler& AsyncAssetWebHandler::setCacheControl(const char* cache_control){
+  _cache_control = String(cache_control);
+  return *this;
+}
+
+bool AsyncAssetWebHandler::canHandle(AsyncWebServerRequest *request){
+  if(!AsyncWebRouter::match(request, ROUTE_EXACT, _uri.c_str(), _uri.length())){
+    return false;
+  }
+  return canHandleRoute(request);
+}
+
+WebRouteMode AsyncAssetWebHandler::route(const char *&pattern, size_t &length){
+  pattern = _uri.c_str();
+  length = _uri.length();
+  return ROUTE_EXACT;
+}
+
+bool AsyncAssetWebHandler::canHandleRoute(AsyncWebServerRequest *request){
+  if(request->method() != HTTP_GET 
+    || !request->isExpectedRequestedConnType(RCT_DEFAULT, RCT_HTTP)
+  ){
+    return false;
+  }
+  request->addInterestingHeader("If-None-Match");
+  return true;
+}
+
+//If-None-Match holds one or more ETags, weak ones with a W/ in front, or *
+bool AsyncAssetWebHandler::_notModified(AsyncWebServerRequest *request) const {
+  AsyncWebHeader* header = request->getHeader("If-None-Match");
+  if(header == NULL){
+    return false;
+  }
+  const char* p = header->value().c_str();
+  for(;;){
+    while(*p == ' ' || *p == ','){
+      p++;
+    }
+    if(!*p){
+      return false;
+    }
+    if(*p == '*'){
+      return true;
+    }
+    if(p[0] == 'W' && p[1] == '/'){
+      p += 2;
+    }
+    const char* end = strchr(p, ',');
+    size_t len = end ? (size_t)(end - p) : strlen(p);
+    while(len && p[len - 1] == ' '){
+      len--;
+    }
+    if(len == _etag.length() && !memcmp(p, _etag.c_str(), len)){
+      return true;
+    }
+    if(!end){
+      return false;
+    }
+    p = end;
+  }
+}
+
+void AsyncAssetWebHandler::handleRequest(AsyncWebServerRequest *request)
+{
+  if((_username != "" && _password != "") && !request->authenticate(_username.c_str(), _password.c_str()))
+      return request->requestAuthentication();
+
+  AsyncWebServerResponse * response;
+  if(_notModified(request)){
+    response = new AsyncBasicResponse(304); // Not modified
+  } else {
+    response = request->beginFlashResponse(200, _contentType, _content, _length);
+    response->addHeader("Content-Encoding", "gzip");
+  }
+  if(_cache_control.length()){
+    response->addHeader("Cache-Control", _cache_control);
+  }
+  response->addHeader("ETag", _etag);
+  request->send(response);
+}
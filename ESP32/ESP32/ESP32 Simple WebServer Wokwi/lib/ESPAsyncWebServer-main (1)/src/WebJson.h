@@ -0,0 +1,114 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef WEBJSON_H_
+#define WEBJSON_H_
+
+#include "Arduino.h"
+#include <stddef.h>
+#include <type_traits>
+
+//Decimals of a float or double field made with ASYNC_JSON_FIELD()
+#ifndef ASYNCWEBSERVER_JSON_DECIMALS
+#define ASYNCWEBSERVER_JSON_DECIMALS 2
+#endif
+
+//A value is written straight into the response when this much room is left,
+//the last bytes before the end of a buffer go through a scratch of this size
+#ifndef ASYNCWEBSERVER_JSON_SCRATCH_LENGTH
+#define ASYNCWEBSERVER_JSON_SCRATCH_LENGTH 48
+#endif
+
+/*
+ * JSON :: Structs described at compile time, written as a JSON object
+ * */
+
+typedef enum {
+  JSON_FIELD_BOOL,
+  JSON_FIELD_INT,
+  JSON_FIELD_UINT,
+  JSON_FIELD_FLOAT,
+  JSON_FIELD_CHARS, //char array, up to its terminator or its size
+  JSON_FIELD_CSTR   //const char*, NULL is written as null
+} AsyncJsonFieldType;
+
+typedef struct {
+  const char* name;
+  uint16_t offset;
+  uint16_t size;
+  uint8_t type;
+  uint8_t decimals;
+} AsyncJsonField;
+
+template<typename T>
+struct AsyncJsonFieldTypeOf {
+  typedef typename std::remove_cv<T>::type V;
+  static const bool chars = std::is_array<V>::value
+    && std::is_same<typename std::remove_cv<typename std::remove_extent<V>::type>::type, char>::value;
+  static const bool cstr = std::is_same<V, const char*>::value || std::is_same<V, char*>::value;
+  static_assert(std::is_arithmetic<V>::value || chars || cstr, "a JSON field is a number, a bool, a char array or a C string");
+  static const uint8_t value =
+      std::is_same<V, bool>::value ? JSON_FIELD_BOOL
+    : std::is_floating_point<V>::value ? JSON_FIELD_FLOAT
+    : std::is_integral<V>::value ? (std::is_signed<V>::value ? JSON_FIELD_INT : JSON_FIELD_UINT)
+    : chars ? JSON_FIELD_CHARS
+    : JSON_FIELD_CSTR;
+};
+
+//One member of a struct, named as it is in the struct:
+//  struct Snapshot { float temperature; uint32_t timestamp; char status[8]; };
+//  const AsyncJsonField SNAPSHOT_JSON[] = {
+//    ASYNC_JSON_FLOAT(Snapshot, temperature, 1),
+//    ASYNC_JSON_FIELD(Snapshot, timestamp),
+//    ASYNC_JSON_FIELD(Snapshot, status)
+//  };
+//is written as {"temperature":21.5,"timestamp":1234,"status":"ok"}
+#define ASYNC_JSON_FLOAT(type, member, decimals) \
+  { #member, (uint16_t)offsetof(type, member), (uint16_t)sizeof(((type*)0)->member), \
+    AsyncJsonFieldTypeOf<decltype(((type*)0)->member)>::value, (uint8_t)(decimals) }
+#define ASYNC_JSON_FIELD(type, member) ASYNC_JSON_FLOAT(type, member, ASYNCWEBSERVER_JSON_DECIMALS)
+
+//Writes an object as JSON into as many buffers as it takes, without building
+//it or measuring it first. The object and the fields are not copied.
+class AsyncJsonWriter {
+  private:
+    const uint8_t* _object;
+    const AsyncJsonField* _fields;
+    size_t _count;
+    size_t _field;      //being written
+    uint8_t _state;
+    size_t _offset;     //into the name or the string value
+    char _scratch[ASYNCWEBSERVER_JSON_SCRATCH_LENGTH];
+    size_t _scratchLength;
+    size_t _scratchOffset;
+
+    size_t _next(char* out, size_t len);
+    size_t _value(const AsyncJsonField& field, char* out, size_t len);
+    size_t _string(const char* value, size_t size, char* out, size_t len);
+    static size_t _digits(uint64_t value, char* out);
+
+  public:
+    AsyncJsonWriter(const void* object, const AsyncJsonField* fields, size_t count);
+    //the next bytes of the JSON, 0 once it is all written
+    size_t write(uint8_t* data, size_t len);
+    bool done() const;
+};
+
+#endif /* WEBJSON_H_ */
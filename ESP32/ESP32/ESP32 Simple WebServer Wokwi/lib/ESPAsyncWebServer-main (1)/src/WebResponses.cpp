@@ -137,7 +137,7 @@ String AsyncWebServerResponse::_assembleHead(uint8_t version){
   out.concat(buf);
 
   if(_sendContentLength) {
-    snprintf(buf, bufSize, "Content-Length: %d\r\n", _contentLength);
+    snprintf(buf, bufSize, "Content-Length: %u\r\n", (unsigned)_contentLength);
     out.concat(buf);
   }
   if(_contentType.length()) {
@@ -156,9 +156,20 @@ String AsyncWebServerResponse::_assembleHead(uint8_t version){
   return out;
 }
 
+void AsyncWebServerResponse::_addConnectionHeader(AsyncWebServerRequest *request){
+  if(!request->keepAlive()){
+    addHeader("Connection","close");
+  } else if(!request->version()){
+    addHeader("Connection","keep-alive");
+  }
+}
+
 bool AsyncWebServerResponse::_started() const { return _state > RESPONSE_SETUP; }
 bool AsyncWebServerResponse::_finished() const { return _state > RESPONSE_WAIT_ACK; }
 bool AsyncWebServerResponse::_failed() const { return _state == RESPONSE_FAILED; }
+bool AsyncWebServerResponse::_sent() const { return _state == RESPONSE_WAIT_ACK || _state == RESPONSE_END; }
+size_t AsyncWebServerResponse::_unacked() const { return (_writtenLength > _ackedLength) ? (_writtenLength - _ackedLength) : 0; }
+bool AsyncWebServerResponse::_delimited(uint8_t version) const { return _sendContentLength || (_chunked && version); }
 bool AsyncWebServerResponse::_sourceValid() const { return false; }
 void AsyncWebServerResponse::_respond(AsyncWebServerRequest *request){ _state = RESPONSE_END; request->client()->close(); }
 size_t AsyncWebServerResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time){ (void)request; (void)len; (void)time; return 0; }
@@ -175,10 +186,10 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, cons
     if(!_contentType.length())
       _contentType = "text/plain";
   }
-  addHeader("Connection","close");
 }
 
 void AsyncBasicResponse::_respond(AsyncWebServerRequest *request){
+  _addConnectionHeader(request);
   _state = RESPONSE_HEADERS;
   String out = _assembleHead(request->version());
   size_t outLen = out.length();
@@ -244,6 +255,57 @@ size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint
  * Abstract Response
  * */
 
+//One transmit buffer fills one write of an _ack() and is given back before it
+//returns, so a small pool serves every connection. _ack() runs on the async task
+//of its connection, there are CONFIG_ASYNC_TCP_WORKERS of them, or in whichever
+//task sends the response: the pool and the counters are shared between them.
+struct AsyncWebTxBuffer {
+  uint8_t data[ASYNCWEBSERVER_TX_BUFFER_SIZE];
+};
+
+static std::atomic<uint32_t> _txResponses(0);
+static std::atomic<uint64_t> _txBytes(0);
+
+#if defined(ESP32)
+static AsyncObjectPool<AsyncWebTxBuffer> _txPool;
+
+//called from AsyncWebServer::begin() before any response can exist
+bool AsyncAbstractResponse::_beginPool(){
+  return !ASYNCWEBSERVER_TX_POOL_SIZE || _txPool.begin(ASYNCWEBSERVER_TX_POOL_SIZE);
+}
+
+void AsyncWebServer::transmitStats(async_tx_stats_t * stats){
+  _txPool.stats(&stats->pool);
+  stats->responses = _txResponses;
+  stats->bytes = _txBytes;
+}
+
+static uint8_t* _txAcquire(){
+  AsyncWebTxBuffer *buffer = _txPool.alloc();
+  return buffer ? buffer->data : NULL;
+}
+
+static void _txRelease(uint8_t *data){
+  _txPool.release(reinterpret_cast<AsyncWebTxBuffer*>(data));
+}
+#else
+static uint8_t* _txAcquire(){
+  return (uint8_t*)malloc(ASYNCWEBSERVER_TX_BUFFER_SIZE);
+}
+
+static void _txRelease(uint8_t *data){
+  free(data);
+}
+#endif
+
+//Shortens room so that used + room ends on a segment boundary, as long as more
+//than reserve bytes are left. The cut goes with the next ack instead of as a
+//short segment of its own.
+static size_t _txAlign(size_t used, size_t room, size_t reserve){
+  size_t cut = (used + room) % ASYNCWEBSERVER_TX_MSS;
+  return (room > cut + reserve) ? room - cut : room;
+}
+
 AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _callback(callback)
 {
   // In case of template processing, we're unable to determine real response size
@@ -255,7 +317,11 @@ AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _ca
 }
 
 void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request){
-  addHeader("Connection","close");
+  //HTTP/1.0 has no chunks, the body ends with the connection instead
+  if(!request->version()){
+    _chunked = false;
+  }
+  _addConnectionHeader(request);
   _head = _assembleHead(request->version());
   _state = RESPONSE_HEADERS;
   _ack(request, 0, 0);
@@ -269,88 +335,97 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     return 0;
   }
   _ackedLength += len;
-  size_t space = request->client()->space();
 
-  size_t headLen = _head.length();
-  if(_state == RESPONSE_HEADERS){
-    if(space >= headLen){
-      _state = RESPONSE_CONTENT;
-      space -= headLen;
-    } else {
-      String out = _head.substring(0, space);
-      _head = _head.substring(space);
-      _writtenLength += request->client()->write(out.c_str(), out.length());
-      return out.length();
+  if(_state == RESPONSE_HEADERS || _state == RESPONSE_CONTENT){
+    size_t space = request->client()->space();
+    if(space > ASYNCWEBSERVER_TX_BUFFER_SIZE){
+      space = ASYNCWEBSERVER_TX_BUFFER_SIZE;
     }
-  }
-
-  if(_state == RESPONSE_CONTENT){
-    size_t outLen;
-    if(_chunked){
-      if(space <= 8){
-        return 0;
-      }
-      outLen = space;
-    } else if(!_sendContentLength){
-      outLen = space;
-    } else {
-      outLen = ((_contentLength - _sentLength) > space)?space:(_contentLength - _sentLength);
+    if(!space){
+      return 0;
     }
-
-    uint8_t *buf = (uint8_t *)malloc(outLen+headLen);
-    if (!buf) {
-      // os_printf("_ack malloc %d failed\n", outLen+headLen);
+    uint8_t *buf = _txAcquire();
+    if(!buf){
       return 0;
     }
 
+    //what is left of the head goes first, in the same write as the body
+    size_t outLen = 0;
+    size_t headLen = _head.length();
     if(headLen){
-      memcpy(buf, _head.c_str(), _head.length());
-    }
-
-    size_t readLen = 0;
-
-    if(_chunked){
-      // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
-      // See RFC2616 sections 2, 3.6.1.
-      readLen = _fillBufferAndProcessTemplates(buf+headLen+6, outLen - 8);
-      if(readLen == RESPONSE_TRY_AGAIN){
-          free(buf);
-          return 0;
+      outLen = (headLen > space) ? space : headLen;
+      memcpy(buf, _head.c_str(), outLen);
+      if(outLen == headLen){
+        _head = String();
+        _state = RESPONSE_CONTENT;
+      } else {
+        _head.remove(0, outLen);
       }
-      outLen = sprintf((char*)buf+headLen, "%x", readLen) + headLen;
-      while(outLen < headLen + 4) buf[outLen++] = ' ';
-      buf[outLen++] = '\r';
-      buf[outLen++] = '\n';
-      outLen += readLen;
-      buf[outLen++] = '\r';
-      buf[outLen++] = '\n';
     } else {
-      readLen = _fillBufferAndProcessTemplates(buf+headLen, outLen);
-      if(readLen == RESPONSE_TRY_AGAIN){
-          free(buf);
-          return 0;
-      }
-      outLen = readLen + headLen;
+      _state = RESPONSE_CONTENT;
     }
 
-    if(headLen){
-        _head = String();
+    size_t room = space - outLen;
+    size_t readLen = 0;
+    bool filled = false;
+    if(_state == RESPONSE_CONTENT){
+      if(_chunked){
+        if(room > 8){
+          room = _txAlign(outLen, room, 8);
+        }
+        //a source that ran short is asked again while there is room, so a
+        //small body and its last chunk go out in one write
+        while(room > 8){
+          // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
+          // See RFC2616 sections 2, 3.6.1.
+          size_t chunkLen = _fillBufferAndProcessTemplates(buf + outLen + 6, room - 8);
+          if(chunkLen == RESPONSE_TRY_AGAIN){
+            break;
+          }
+          uint8_t *chunk = buf + outLen;
+          size_t frame = sprintf((char*)chunk, "%x", (unsigned)chunkLen);
+          while(frame < 4) chunk[frame++] = ' ';
+          chunk[frame++] = '\r';
+          chunk[frame++] = '\n';
+          frame += chunkLen;
+          chunk[frame++] = '\r';
+          chunk[frame++] = '\n';
+          outLen += frame;
+          room -= frame;
+          _sentLength += chunkLen;
+          readLen = chunkLen;
+          filled = true;
+          if(!chunkLen){
+            break;
+          }
+        }
+      } else {
+        if(_sendContentLength && (_contentLength - _sentLength) <= room){
+          room = _contentLength - _sentLength;
+        } else {
+          room = _txAlign(outLen, room, 0);
+        }
+        //without a length an empty read ends the response, so only read with room
+        if(room || _sendContentLength){
+          readLen = room ? _fillBufferAndProcessTemplates(buf + outLen, room) : 0;
+          filled = (readLen != RESPONSE_TRY_AGAIN);
+        }
+        if(filled){
+          outLen += readLen;
+          _sentLength += readLen;
+        }
+      }
     }
 
     if(outLen){
-        _writtenLength += request->client()->write((const char*)buf, outLen);
-    }
-
-    if(_chunked){
-        _sentLength += readLen;
-    } else {
-        _sentLength += outLen - headLen;
+      _writtenLength += request->client()->write((const char*)buf, outLen);
+      _txBytes += outLen;
     }
+    _txRelease(buf);
 
-    free(buf);
-
-    if((_chunked && readLen == 0) || (!_sendContentLength && outLen == 0) || (!_chunked && _sentLength == _contentLength)){
+    if(filled && ((_chunked && readLen == 0) || (!_sendContentLength && readLen == 0) || (!_chunked && _sentLength == _contentLength))){
       _state = RESPONSE_WAIT_ACK;
+      _txResponses++;
     }
     return outLen;
 
@@ -396,7 +471,7 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
     // If closing placeholder is found:
     if(pTemplateEnd) {
       // prepare argument to callback
-      const size_t paramNameLength = std::min(sizeof(buf) - 1, (unsigned int)(pTemplateEnd - pTemplateStart - 1));
+      const size_t paramNameLength = std::min(sizeof(buf) - 1, (size_t)(pTemplateEnd - pTemplateStart - 1));
       if(paramNameLength) {
         memcpy(buf, pTemplateStart + 1, paramNameLength);
         buf[paramNameLength] = 0;
@@ -661,6 +736,142 @@ size_t AsyncProgmemResponse::_fillBuffer(uint8_t *data, size_t len){
   return left;
 }
 
+/*
+ * Template Response
+ * */
+
+AsyncTemplateResponse::AsyncTemplateResponse(int code, const String& contentType, const AsyncWebTemplate& content, AwsTemplateWriter writer)
+  : _template(content)
+  , _writer(writer)
+  , _segment(0)
+  , _offset(0)
+  , _valueLength(0)
+{
+  _code = code;
+  _contentType = contentType;
+  _contentLength = 0;
+  _sendContentLength = false;
+  _chunked = true;
+}
+
+size_t AsyncTemplateResponse::_fillBuffer(uint8_t *data, size_t len){
+  size_t filled = 0;
+  while(filled < len && _segment < _template._count){
+    const AsyncWebTemplate::Segment& segment = _template._segments[_segment];
+    size_t length;
+    if(segment.name == NULL){
+      length = segment.length;
+      size_t n = std::min(length - _offset, len - filled);
+      memcpy_P(data + filled, _template._content + segment.offset + _offset, n);
+      filled += n;
+      _offset += n;
+    } else {
+      //the value is written once, when the placeholder is reached
+      if(_offset == 0){
+        _valueLength = _writer ? _writer(segment.name, _value, sizeof(_value)) : 0;
+        if(_valueLength >= sizeof(_value)){
+          //cut, snprintf() left its terminator in the last byte
+          _valueLength = sizeof(_value) - 1;
+        }
+      }
+      length = _valueLength;
+      size_t n = std::min(length - _offset, len - filled);
+      memcpy(data + filled, _value + _offset, n);
+      filled += n;
+      _offset += n;
+    }
+    if(_offset == length){
+      _segment++;
+      _offset = 0;
+    }
+  }
+  return filled;
+}
+
+/*
+ * Json Stream Response
+ * */
+
+AsyncJsonStreamResponse::AsyncJsonStreamResponse(int code, const void* object, const AsyncJsonField* fields, size_t count)
+  : _writer(object, fields, count)
+{
+  _code = code;
+  _contentType = "application/json";
+  _contentLength = 0;
+  _sendContentLength = false;
+  _chunked = true;
+}
+
+size_t AsyncJsonStreamResponse::_fillBuffer(uint8_t *data, size_t len){
+  return _writer.write(data, len);
+}
+
+#if defined(ESP32)
+/*
+ * Flash Response
+ * */
+
+AsyncFlashResponse::AsyncFlashResponse(int code, const String& contentType, const uint8_t * content, size_t len){
+  _code = code;
+  _content = content;
+  _contentType = contentType;
+  _contentLength = len;
+}
+
+void AsyncFlashResponse::_respond(AsyncWebServerRequest *request){
+  _addConnectionHeader(request);
+  _head = _assembleHead(request->version());
+  _state = RESPONSE_HEADERS;
+  _ack(request, 0, 0);
+}
+
+size_t AsyncFlashResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time){
+  (void)time;
+  _ackedLength += len;
+  if(_state == RESPONSE_HEADERS || _state == RESPONSE_CONTENT){
+    size_t space = request->client()->space();
+    if(!space){
+      return 0;
+    }
+    //the head is copied, the body goes out by reference, both in one write
+    async_tcp_segment_t segments[2];
+    size_t count = 0;
+    size_t headLen = _head.length();
+    if(headLen){
+      size_t outLen = (headLen > space) ? space : headLen;
+      segments[count++] = { _head.c_str(), outLen, ASYNC_WRITE_FLAG_COPY };
+      space -= outLen;
+    }
+    size_t bodyLen = _contentLength - _sentLength;
+    if(bodyLen > space){
+      bodyLen = space;
+    }
+    if(bodyLen){
+      segments[count++] = { (const char*)_content + _sentLength, bodyLen, 0 };
+    }
+    size_t written = count ? request->client()->writev(segments, count) : 0;
+    _writtenLength += written;
+
+    size_t headWritten = (written > headLen) ? headLen : written;
+    if(headWritten == headLen){
+      _head = String();
+      _state = RESPONSE_CONTENT;
+    } else {
+      _head.remove(0, headWritten);
+    }
+    _sentLength += written - headWritten;
+    if(_state == RESPONSE_CONTENT && _sentLength == _contentLength){
+      _state = RESPONSE_WAIT_ACK;
+    }
+    return written;
+  } else if(_state == RESPONSE_WAIT_ACK){
+    if(_ackedLength >= _writtenLength){
+      _state = RESPONSE_END;
+    }
+  }
+  return 0;
+}
+#endif
 
 /*
  * Response Stream (You can print/write/printf to it, up to the contentLen bytes)
@@ -0,0 +1,123 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef WEBROUTER_H_
+#define WEBROUTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "StringArray.h"
+
+class AsyncWebHandler;
+class AsyncWebServerRequest;
+
+//Matching routes found for one request before the router gives up and asks
+//every handler instead
+#ifndef ASYNCWEBSERVER_ROUTER_CANDIDATES
+#define ASYNCWEBSERVER_ROUTER_CANDIDATES 8
+#endif
+
+//Which URLs a route pattern stands for. {name} in a pattern matches one
+//path segment, up to the next '/', and is passed on as a pathArg()
+typedef enum {
+  ROUTE_NONE,      //no pattern, canHandle() decides on every request
+  ROUTE_EXACT,     //the pattern and nothing else
+  ROUTE_PATH,      //the pattern and anything below it: /uri, /uri/...
+  ROUTE_PREFIX,    //anything that starts with the pattern
+  ROUTE_EXTENSION  //anything that ends with the pattern, a .ext without parameters
+} WebRouteMode;
+
+/*
+ * ROUTER :: Radix trie over the handler routes, compiled before the server begins
+ * */
+
+class AsyncWebRouter {
+  private:
+    struct Route {
+      AsyncWebHandler* handler;
+      char* pattern;   //own copy, node labels point into it
+      size_t length;
+      size_t index;    //position in the handler list, the first one that accepts wins
+      WebRouteMode mode;
+      bool params;
+      Route* next;     //next route ending on the same node
+    };
+    struct Node {
+      const char* label;
+      size_t length;
+      Node* child;     //children start with distinct characters
+      Node* sibling;
+      Node* param;     //a {name} segment
+      Route* routes;
+    };
+    struct Match {
+      const Route* routes[ASYNCWEBSERVER_ROUTER_CANDIDATES];
+      size_t count;
+      bool overflow;
+    };
+
+    const LinkedList<AsyncWebHandler*>& _handlers;
+    Route* _routes;
+    size_t _count;
+    Node* _paths;
+    Node* _extensions;
+    Route* _opaque;    //ROUTE_NONE handlers, in order
+    std::atomic<bool> _ready;
+    uint32_t _changes; //_routeChanges the trie was built with
+
+    static std::atomic<uint32_t> _routeChanges;
+
+    static Node* _node(const char* label, size_t length);
+    static void _free(Node* node);
+    static Node* _insert(Node* node, const char* s, size_t len);
+    static bool _add(Node* root, Route* route, bool params);
+    static void _collect(const Node* node, const char* url, size_t pos, size_t len, Match& match);
+    static bool _match(const char* url, size_t len, WebRouteMode mode, const char* pattern, size_t length, AsyncWebServerRequest* capture);
+    void _clear();
+
+  public:
+    AsyncWebRouter(const LinkedList<AsyncWebHandler*>& handlers);
+    ~AsyncWebRouter();
+
+    //Compiles the routes of all handlers. It frees the trie find() reads, so it may
+    //only run while no request is routed: before the server begins and in begin()
+    bool build();
+    //built, and no route() has changed since
+    bool ready() const { return _ready && _changes == _routeChanges; }
+    //Stops find() from using the trie without freeing it, for handlers changed while
+    //requests are routed. They are asked one by one until the next build()
+    void disable(){ _ready = false; }
+    //for a handler whose route() has changed, it is no longer where the trie has it
+    static void changed(){ _routeChanges++; }
+
+    //Finds the first handler, in the order they were added, whose route matches and
+    //whose filter and canHandleRoute() accept the request. false means the router could
+    //not decide (no memory for it, too many candidates) and the handlers have to be asked.
+    //Only reads the trie, requests of several connections may be routed at the same time
+    bool find(AsyncWebServerRequest* request, AsyncWebHandler*& handler) const;
+
+    //the same match without the router, for canHandle() and handlers added by hand
+    static bool match(AsyncWebServerRequest* request, WebRouteMode mode, const char* pattern, size_t length);
+    //adds the {name} segments of a matching pattern to the request path arguments
+    static void capture(AsyncWebServerRequest* request, const char* pattern, size_t length);
+};
+
+#endif /* WEBROUTER_H_ */
@@ -14,18 +14,6 @@ volatile unsigned long lastDebounceTime = 0;
 const unsigned long debounceDelay = 200;
 AsyncWebServer server(80);  // Web server on port 80
 
-/**
- * @brief Processes template variables for the web page
- * @param var Template variable to process
- * @return String containing the processed value
- */
-String processor(const String& var) {
-    if(var == "STATE") {
-        return ledState ? "ON" : "OFF";
-    }
-    return String();
-}
-
 /**
  * @brief ISR for button press
  * @details Called when button is pressed (FALLING edge)
@@ -68,9 +56,7 @@ void webServerTask(void *parameter) {
     DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
     
     // Define web server routes
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        request->send_P(200, "text/html", index_html, processor);
-    });
+    server.serveAsset("/", INDEX_HTML_TYPE, index_html_gz, sizeof(index_html_gz), INDEX_HTML_ETAG);
 
     // Route for getting LED status
     server.on("/status", HTTP_GET, [](AsyncWebServerRequest *request){
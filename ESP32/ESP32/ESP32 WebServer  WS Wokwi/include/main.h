@@ -10,7 +10,7 @@
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 #include <AsyncWebSocket.h>
-#include "index_html.h"
+#include "web_assets.h"  // generated from web/ by scripts/web_assets.py
 #include <ESP32Servo.h>
 
 // Pin Definitions
@@ -18,10 +18,12 @@
 #define DHT_TYPE DHT22
 #define SERVO_PIN 12
 
+// WebSocket topics: a slow browser only gets the latest message of each
+#define WS_TOPIC_SENSORS 1
+
 // Function declarations
 void TaskSensor(void *pvParameters);
 void TaskDisplay(void *pvParameters);
-String createHtml();
 
 // External declarations
 extern DHT dht;
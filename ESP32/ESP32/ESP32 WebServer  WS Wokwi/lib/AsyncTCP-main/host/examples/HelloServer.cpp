@@ -0,0 +1,127 @@
+/*
+ * ESPAsyncWebServer on Linux, served by the epoll backend of AsyncTCP.
+ * Same routes as the board: a page, the sensor JSON, a WebSocket at /ws
+ * and server-sent events at /events. The readings are made up. /stats
+ * shows how the client, request and transmit pools hold up under load,
+ * and every time a route needs more request arena than before it is
+ * printed.
+ *
+ *   make && ./build/HelloServer 8080
+ *   curl http://127.0.0.1:8080/sensors
+ */
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+static float temperature = 21.5;
+static float humidity = 40.0;
+//a client that falls behind only gets the latest reading
+static const uint16_t SENSORS_TOPIC = 1;
+
+static String sensorJson(){
+  char json[128];
+  snprintf(json, sizeof(json),
+      "{\"temperature\":%.1f,\"humidity\":%.1f,\"timestamp\":%lu}",
+      temperature, humidity, millis());
+  return String(json);
+}
+
+//what /sensors answers, written as JSON without a String in between
+struct SensorSnapshot {
+  float temperature;
+  float humidity;
+  unsigned long timestamp;
+};
+
+static const AsyncJsonField SENSOR_SNAPSHOT_JSON[] = {
+  ASYNC_JSON_FLOAT(SensorSnapshot, temperature, 1),
+  ASYNC_JSON_FLOAT(SensorSnapshot, humidity, 1),
+  ASYNC_JSON_FIELD(SensorSnapshot, timestamp)
+};
+
+static void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
+                             AwsEventType type, void *arg, uint8_t *payload, size_t length){
+  if(type == WS_EVT_CONNECT){
+    client->text(sensorJson());
+  } else if(type == WS_EVT_DATA){
+    AwsFrameInfo *info = (AwsFrameInfo *)arg;
+    if(info->opcode == WS_TEXT && length == 7 && memcmp(payload, "getData", 7) == 0){
+      client->text(sensorJson());
+    } else {
+      //anything else comes back as it was sent, in one message
+      client->text((const char *)payload, length);
+    }
+  }
+}
+
+int main(int argc, char **argv){
+  uint16_t port = (argc > 1) ? atoi(argv[1]) : 8080;
+
+  AsyncWebServer server(port);
+  AsyncWebSocket ws("/ws");
+  AsyncEventSource events("/events");
+
+  ws.wholeMessages(65536);
+  ws.onEvent(onWebSocketEvent);
+  server.addHandler(&ws);
+  server.addHandler(&events);
+
+  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
+    request->send(200, "text/plain", "Hello from AsyncTCP on Linux\n");
+  });
+  //ahead of /sensors, which also answers every URL below it
+  server.on("/sensors/{name}", HTTP_GET, [](AsyncWebServerRequest *request){
+    char value[16];
+    if(request->pathArg(0) == "temperature"){
+      snprintf(value, sizeof(value), "%.1f\n", temperature);
+    } else if(request->pathArg(0) == "humidity"){
+      snprintf(value, sizeof(value), "%.1f\n", humidity);
+    } else {
+      return request->send(404, "text/plain", "No such sensor\n");
+    }
+    request->send(200, "text/plain", value);
+  });
+  server.on("/sensors", HTTP_GET, [](AsyncWebServerRequest *request){
+    SensorSnapshot snapshot = { temperature, humidity, millis() };
+    request->sendJson(200, snapshot, SENSOR_SNAPSHOT_JSON);
+  });
+  server.on("/stats", HTTP_GET, [](AsyncWebServerRequest *request){
+    async_tcp_stats_t tcp;
+    async_pool_stats_t requests;
+    async_tx_stats_t tx;
+    async_tcp_get_stats(&tcp);
+    AsyncWebServer::requestPoolStats(&requests);
+    AsyncWebServer::transmitStats(&tx);
+    char json[384];
+    snprintf(json, sizeof(json),
+        "{\"clients\":{\"used\":%u,\"high_water\":%u,\"misses\":%u},"
+        "\"requests\":{\"used\":%u,\"high_water\":%u,\"misses\":%u},"
+        "\"tx\":{\"used\":%u,\"high_water\":%u,\"misses\":%u,\"responses\":%u,\"bytes\":%llu}}",
+        tcp.client_pool.used, tcp.client_pool.high_water, tcp.client_pool.misses,
+        requests.used, requests.high_water, requests.misses,
+        tx.pool.used, tx.pool.high_water, tx.pool.misses, tx.responses, (unsigned long long)tx.bytes);
+    request->send(200, "application/json", json);
+  });
+  server.onNotFound([](AsyncWebServerRequest *request){
+    request->send(404, "text/plain", "Not found\n");
+  });
+  server.onArenaStats([](AsyncWebServerRequest *request, AsyncWebHandler *handler, size_t highWater){
+    (void)handler;
+    printf("arena high water %u bytes, %s %s\n", (unsigned)highWater, request->methodToString(), request->url().c_str());
+  });
+
+  server.begin();
+  printf("listening on port %u\n", port);
+
+  //the Arduino loop()
+  for(;;){
+    delay(1000);
+    temperature += (random(-5, 6)) / 10.0;
+    humidity += (random(-5, 6)) / 10.0;
+    String json = sensorJson();
+    ws.textLatestAll(SENSORS_TOPIC, json);
+    events.send(json.c_str(), "sensors", millis());
+    ws.cleanupClients();
+  }
+  return 0;
+}
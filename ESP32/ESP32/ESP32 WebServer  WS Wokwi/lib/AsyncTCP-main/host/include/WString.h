@@ -0,0 +1,160 @@
+/*
+  Host shim: Arduino String, kept on a std::string.
+  Covers the API the ESP32 core offers and ESPAsyncWebServer uses, with the
+  same rules for out of range indexes (ignored) and failed conversions (0).
+*/
+
+#ifndef WSTRING_H_HOST
+#define WSTRING_H_HOST
+
+#include <stddef.h>
+#include <string>
+
+class __FlashStringHelper;
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+#define F(string_literal) (FPSTR(string_literal))
+
+class StringSumHelper;
+
+class String {
+  public:
+    String(const char *cstr = "");
+    String(const char *cstr, unsigned int length);
+    String(const String &str) : _buffer(str._buffer) {}
+    String(String &&rval) : _buffer(std::move(rval._buffer)) {}
+    String(const __FlashStringHelper *str) : String(reinterpret_cast<const char *>(str)) {}
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+    ~String() {}
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return _buffer.length(); }
+    bool isEmpty() const { return _buffer.empty(); }
+
+    String & operator =(const String &rhs);
+    String & operator =(String &&rval);
+    String & operator =(const char *cstr);
+    String & operator =(const __FlashStringHelper *str);
+
+    bool concat(const String &str);
+    bool concat(const char *cstr);
+    bool concat(const char *cstr, unsigned int length);
+    bool concat(const __FlashStringHelper *str);
+    bool concat(char c);
+    bool concat(unsigned char num);
+    bool concat(int num);
+    bool concat(unsigned int num);
+    bool concat(long num);
+    bool concat(unsigned long num);
+    bool concat(long long num);
+    bool concat(unsigned long long num);
+    bool concat(float num);
+    bool concat(double num);
+
+    template<typename T> String & operator +=(const T &rhs) {
+      concat(rhs);
+      return *this;
+    }
+
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, const String &rhs);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, const char *cstr);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, const __FlashStringHelper *rhs);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, char c);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, unsigned char num);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, int num);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, unsigned int num);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, long num);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, unsigned long num);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, long long num);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, unsigned long long num);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, float num);
+    friend StringSumHelper & operator +(const StringSumHelper &lhs, double num);
+
+    explicit operator bool() const { return true; }
+
+    int compareTo(const String &s) const;
+    bool equals(const String &s) const;
+    bool equals(const char *cstr) const;
+    bool equalsIgnoreCase(const String &s) const;
+    bool equalsConstantTime(const String &s) const;
+    bool operator ==(const String &rhs) const { return equals(rhs); }
+    bool operator ==(const char *cstr) const { return equals(cstr); }
+    bool operator !=(const String &rhs) const { return !equals(rhs); }
+    bool operator !=(const char *cstr) const { return !equals(cstr); }
+    bool operator <(const String &rhs) const { return compareTo(rhs) < 0; }
+    bool operator >(const String &rhs) const { return compareTo(rhs) > 0; }
+    bool operator <=(const String &rhs) const { return compareTo(rhs) <= 0; }
+    bool operator >=(const String &rhs) const { return compareTo(rhs) >= 0; }
+    bool startsWith(const String &prefix) const;
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator [](unsigned int index) const;
+    char & operator [](unsigned int index);
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const {
+      getBytes((unsigned char *)buf, bufsize, index);
+    }
+    const char * c_str() const { return _buffer.c_str(); }
+    char * begin() { return &_buffer[0]; }
+    char * end() { return &_buffer[0] + _buffer.length(); }
+    const char * begin() const { return c_str(); }
+    const char * end() const { return c_str() + _buffer.length(); }
+
+    int indexOf(char ch) const;
+    int indexOf(char ch, unsigned int fromIndex) const;
+    int indexOf(const String &str) const;
+    int indexOf(const String &str, unsigned int fromIndex) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(char ch, unsigned int fromIndex) const;
+    int lastIndexOf(const String &str) const;
+    int lastIndexOf(const String &str, unsigned int fromIndex) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+  protected:
+    std::string _buffer;
+};
+
+class StringSumHelper: public String {
+  public:
+    StringSumHelper(const String &s) : String(s) {}
+    StringSumHelper(const char *p) : String(p) {}
+    StringSumHelper(char c) : String(c) {}
+    StringSumHelper(unsigned char num) : String(num) {}
+    StringSumHelper(int num) : String(num) {}
+    StringSumHelper(unsigned int num) : String(num) {}
+    StringSumHelper(long num) : String(num) {}
+    StringSumHelper(unsigned long num) : String(num) {}
+    StringSumHelper(long long num) : String(num) {}
+    StringSumHelper(unsigned long long num) : String(num) {}
+    StringSumHelper(float num) : String(num) {}
+    StringSumHelper(double num) : String(num) {}
+};
+
+inline bool operator ==(const char *lhs, const String &rhs) { return rhs.equals(lhs); }
+inline bool operator !=(const char *lhs, const String &rhs) { return !rhs.equals(lhs); }
+
+#endif /* WSTRING_H_HOST */
@@ -0,0 +1,18 @@
+/*
+  Host shim: the station is the host itself, its address is the loopback one.
+*/
+
+#ifndef WIFI_H_HOST
+#define WIFI_H_HOST
+
+#include "Arduino.h"
+
+class WiFiClass {
+  public:
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    IPAddress softAPIP() { return IPAddress(); }
+};
+
+extern WiFiClass WiFi;
+
+#endif /* WIFI_H_HOST */
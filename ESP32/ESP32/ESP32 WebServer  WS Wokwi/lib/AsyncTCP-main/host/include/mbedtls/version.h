@@ -0,0 +1,10 @@
+/*
+  Host shim: reports the mbedTLS 2.x API that ESP-IDF 4 ships.
+*/
+
+#ifndef MBEDTLS_VERSION_H
+#define MBEDTLS_VERSION_H
+
+#define MBEDTLS_VERSION_NUMBER 0x02100000
+
+#endif /* MBEDTLS_VERSION_H */
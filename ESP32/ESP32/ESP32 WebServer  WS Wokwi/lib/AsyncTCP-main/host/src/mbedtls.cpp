@@ -0,0 +1,246 @@
+/*
+  Host shim: MD5 (RFC 1321) and SHA-1 (RFC 3174) behind the mbedTLS 2.x API,
+  see include/mbedtls/md5.h and include/mbedtls/sha1.h
+*/
+
+#include "mbedtls/md5.h"
+#include "mbedtls/sha1.h"
+
+#include <string.h>
+
+static inline uint32_t _rol(uint32_t x, int n){
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t _get_le(const unsigned char *b){
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static inline uint32_t _get_be(const unsigned char *b){
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3];
+}
+
+static inline void _put_le(uint32_t v, unsigned char *b){
+    b[0] = v; b[1] = v >> 8; b[2] = v >> 16; b[3] = v >> 24;
+}
+
+static inline void _put_be(uint32_t v, unsigned char *b){
+    b[0] = v >> 24; b[1] = v >> 16; b[2] = v >> 8; b[3] = v;
+}
+
+//feeds input through process() one 64 byte block at a time, both digests buffer the same way
+template<typename Ctx, typename Process>
+static void _update(Ctx *ctx, const unsigned char *input, size_t ilen, Process process){
+    size_t left = ctx->total[0] & 0x3F;
+    size_t fill = 64 - left;
+    ctx->total[0] += (uint32_t)ilen;
+    if(ctx->total[0] < (uint32_t)ilen){
+        ctx->total[1]++;
+    }
+    if(left && ilen >= fill){
+        memcpy(ctx->buffer + left, input, fill);
+        process(ctx, ctx->buffer);
+        input += fill;
+        ilen -= fill;
+        left = 0;
+    }
+    while(ilen >= 64){
+        process(ctx, input);
+        input += 64;
+        ilen -= 64;
+    }
+    if(ilen){
+        memcpy(ctx->buffer + left, input, ilen);
+    }
+}
+
+//appends the padding and the bit length, in the byte order of the digest
+template<typename Ctx, typename Process>
+static void _finish(Ctx *ctx, bool big_endian, Process process){
+    unsigned char msglen[8];
+    uint32_t high = (ctx->total[0] >> 29) | (ctx->total[1] << 3);
+    uint32_t low = ctx->total[0] << 3;
+    if(big_endian){
+        _put_be(high, msglen);
+        _put_be(low, msglen + 4);
+    } else {
+        _put_le(low, msglen);
+        _put_le(high, msglen + 4);
+    }
+    static const unsigned char padding[64] = { 0x80 };
+    uint32_t last = ctx->total[0] & 0x3F;
+    uint32_t padn = (last < 56) ? (56 - last) : (120 - last);
+    _update(ctx, padding, padn, process);
+    _update(ctx, msglen, 8, process);
+}
+
+/*
+ * MD5
+ * */
+
+static void _md5_process(mbedtls_md5_context *ctx, const unsigned char data[64]){
+    static const uint32_t K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+    static const int S[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+    uint32_t X[16];
+    for(int i = 0; i < 16; i++){
+        X[i] = _get_le(data + i * 4);
+    }
+    uint32_t A = ctx->state[0], B = ctx->state[1], C = ctx->state[2], D = ctx->state[3];
+    for(int i = 0; i < 64; i++){
+        uint32_t F;
+        int g;
+        if(i < 16){
+            F = (B & C) | (~B & D);
+            g = i;
+        } else if(i < 32){
+            F = (D & B) | (~D & C);
+            g = (5 * i + 1) & 15;
+        } else if(i < 48){
+            F = B ^ C ^ D;
+            g = (3 * i + 5) & 15;
+        } else {
+            F = C ^ (B | ~D);
+            g = (7 * i) & 15;
+        }
+        F += A + K[i] + X[g];
+        A = D;
+        D = C;
+        C = B;
+        B += _rol(F, S[i]);
+    }
+    ctx->state[0] += A;
+    ctx->state[1] += B;
+    ctx->state[2] += C;
+    ctx->state[3] += D;
+}
+
+void mbedtls_md5_init(mbedtls_md5_context *ctx){
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md5_free(mbedtls_md5_context *ctx){
+    if(ctx){
+        memset(ctx, 0, sizeof(*ctx));
+    }
+}
+
+int mbedtls_md5_starts_ret(mbedtls_md5_context *ctx){
+    ctx->total[0] = 0;
+    ctx->total[1] = 0;
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    return 0;
+}
+
+int mbedtls_md5_update_ret(mbedtls_md5_context *ctx, const unsigned char *input, size_t ilen){
+    _update(ctx, input, ilen, _md5_process);
+    return 0;
+}
+
+int mbedtls_md5_finish_ret(mbedtls_md5_context *ctx, unsigned char output[16]){
+    _finish(ctx, false, _md5_process);
+    for(int i = 0; i < 4; i++){
+        _put_le(ctx->state[i], output + i * 4);
+    }
+    return 0;
+}
+
+void mbedtls_md5_starts(mbedtls_md5_context *ctx){ mbedtls_md5_starts_ret(ctx); }
+void mbedtls_md5_update(mbedtls_md5_context *ctx, const unsigned char *input, size_t ilen){ mbedtls_md5_update_ret(ctx, input, ilen); }
+void mbedtls_md5_finish(mbedtls_md5_context *ctx, unsigned char output[16]){ mbedtls_md5_finish_ret(ctx, output); }
+
+/*
+ * SHA-1
+ * */
+
+static void _sha1_process(mbedtls_sha1_context *ctx, const unsigned char data[64]){
+    uint32_t W[80];
+    for(int i = 0; i < 16; i++){
+        W[i] = _get_be(data + i * 4);
+    }
+    for(int i = 16; i < 80; i++){
+        W[i] = _rol(W[i - 3] ^ W[i - 8] ^ W[i - 14] ^ W[i - 16], 1);
+    }
+    uint32_t A = ctx->state[0], B = ctx->state[1], C = ctx->state[2], D = ctx->state[3], E = ctx->state[4];
+    for(int i = 0; i < 80; i++){
+        uint32_t F, K;
+        if(i < 20){
+            F = (B & C) | (~B & D);
+            K = 0x5A827999;
+        } else if(i < 40){
+            F = B ^ C ^ D;
+            K = 0x6ED9EBA1;
+        } else if(i < 60){
+            F = (B & C) | (B & D) | (C & D);
+            K = 0x8F1BBCDC;
+        } else {
+            F = B ^ C ^ D;
+            K = 0xCA62C1D6;
+        }
+        uint32_t temp = _rol(A, 5) + F + E + K + W[i];
+        E = D;
+        D = C;
+        C = _rol(B, 30);
+        B = A;
+        A = temp;
+    }
+    ctx->state[0] += A;
+    ctx->state[1] += B;
+    ctx->state[2] += C;
+    ctx->state[3] += D;
+    ctx->state[4] += E;
+}
+
+void mbedtls_sha1_init(mbedtls_sha1_context *ctx){
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha1_free(mbedtls_sha1_context *ctx){
+    if(ctx){
+        memset(ctx, 0, sizeof(*ctx));
+    }
+}
+
+int mbedtls_sha1_starts_ret(mbedtls_sha1_context *ctx){
+    ctx->total[0] = 0;
+    ctx->total[1] = 0;
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    return 0;
+}
+
+int mbedtls_sha1_update_ret(mbedtls_sha1_context *ctx, const unsigned char *input, size_t ilen){
+    _update(ctx, input, ilen, _sha1_process);
+    return 0;
+}
+
+int mbedtls_sha1_finish_ret(mbedtls_sha1_context *ctx, unsigned char output[20]){
+    _finish(ctx, true, _sha1_process);
+    for(int i = 0; i < 5; i++){
+        _put_be(ctx->state[i], output + i * 4);
+    }
+    return 0;
+}
+
+void mbedtls_sha1_starts(mbedtls_sha1_context *ctx){ mbedtls_sha1_starts_ret(ctx); }
+void mbedtls_sha1_update(mbedtls_sha1_context *ctx, const unsigned char *input, size_t ilen){ mbedtls_sha1_update_ret(ctx, input, ilen); }
+void mbedtls_sha1_finish(mbedtls_sha1_context *ctx, unsigned char output[20]){ mbedtls_sha1_finish_ret(ctx, output); }
@@ -0,0 +1,989 @@
+/*
+  Asynchronous TCP library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * AsyncClient and AsyncServer, the same on every backend.
+ * What differs, getting a pcb and moving data and events between it and
+ * the client, is in the backend, see AsyncTCPBackend.h.
+ * */
+
+#include "Arduino.h"
+
+#include "AsyncTCPBackend.h"
+
+/*
+  Async TCP Client
+ */
+
+AsyncClient::AsyncClient(tcp_pcb* pcb)
+: _poll_queued(false)
+, _sent_deferred(0)
+, _events(NULL)
+, _connect_cb(0)
+, _connect_cb_arg(0)
+, _discard_cb(0)
+, _discard_cb_arg(0)
+, _sent_cb(0)
+, _sent_cb_arg(0)
+, _error_cb(0)
+, _error_cb_arg(0)
+, _recv_cb(0)
+, _recv_cb_arg(0)
+, _pb_cb(0)
+, _pb_cb_arg(0)
+, _timeout_cb(0)
+, _timeout_cb_arg(0)
+, _ack_pcb(true)
+, _tx_last_packet(0)
+, _rx_ack_len(0)
+, _rx_timeout(0)
+, _rx_last_ack(0)
+, _ack_timeout(ASYNC_MAX_ACK_TIME)
+, _poll_interval(ASYNC_POLL_INTERVAL)
+, _last_poll(0)
+, _connect_port(0)
+, _tx_queued(0)
+, _tx_acked(0)
+, _tx_refs_pending(0)
+, _tx_refs(NULL)
+, _tx_refs_tail(NULL)
+, prev(NULL)
+, next(NULL)
+{
+    _pcb = pcb;
+    _closed_slot = -1;
+    if(_pcb){
+        _allocate_closed_slot();
+        _attach_event_owner();
+        _rx_last_packet = millis();
+        _last_poll = _rx_last_packet;
+        _tcp_attach(_pcb, this);
+    }
+}
+
+AsyncClient::~AsyncClient(){
+    if(_pcb) {
+        _close();
+    }
+    _release_refs(true);
+    _free_closed_slot();
+    if(_events){
+        //nothing still pending or armed may reach this object anymore
+        _kill_event_owner(_events);
+        _release_event_owner(_events);
+        _events = NULL;
+    }
+}
+
+/*
+ * Operators
+ * */
+
+void* AsyncClient::operator new(size_t size) noexcept {
+    //subclasses are bigger than a pool slot
+    if(size != sizeof(AsyncClient)){
+        return malloc(size);
+    }
+    return _client_pool.alloc();
+}
+
+void AsyncClient::operator delete(void* ptr){
+    _client_pool.release(reinterpret_cast<AsyncClient*>(ptr));
+}
+
+AsyncClient& AsyncClient::operator=(const AsyncClient& other){
+    if (_pcb) {
+        _close();
+    }
+
+    _pcb = other._pcb;
+    _closed_slot = other._closed_slot.load();
+    if (_pcb) {
+        _attach_event_owner();
+        _rx_last_packet = millis();
+        _last_poll = _rx_last_packet;
+        _tcp_attach(_pcb, this);
+    }
+    return *this;
+}
+
+bool AsyncClient::operator==(const AsyncClient &other) {
+    return _pcb == other._pcb;
+}
+
+AsyncClient & AsyncClient::operator+=(const AsyncClient &other) {
+    if(next == NULL){
+        next = (AsyncClient*)(&other);
+        next->prev = this;
+    } else {
+        AsyncClient *c = next;
+        while(c->next != NULL) {
+            c = c->next;
+        }
+        c->next =(AsyncClient*)(&other);
+        c->next->prev = c;
+    }
+    return *this;
+}
+
+/*
+ * Callback Setters
+ * */
+
+void AsyncClient::onConnect(AcConnectHandler cb, void* arg){
+    _connect_cb = cb;
+    _connect_cb_arg = arg;
+}
+
+void AsyncClient::onDisconnect(AcConnectHandler cb, void* arg){
+    _discard_cb = cb;
+    _discard_cb_arg = arg;
+}
+
+void AsyncClient::onAck(AcAckHandler cb, void* arg){
+    _sent_cb = cb;
+    _sent_cb_arg = arg;
+}
+
+void AsyncClient::onError(AcErrorHandler cb, void* arg){
+    _error_cb = cb;
+    _error_cb_arg = arg;
+}
+
+void AsyncClient::onData(AcDataHandler cb, void* arg){
+    _recv_cb = cb;
+    _recv_cb_arg = arg;
+}
+
+void AsyncClient::onPacket(AcPacketHandler cb, void* arg){
+  _pb_cb = cb;
+  _pb_cb_arg = arg;
+}
+
+void AsyncClient::onTimeout(AcTimeoutHandler cb, void* arg){
+    _timeout_cb = cb;
+    _timeout_cb_arg = arg;
+}
+
+void AsyncClient::onPoll(AcConnectHandler cb, void* arg){
+    _poll_cb = cb;
+    _poll_cb_arg = arg;
+    _rearm_timer();
+}
+
+/*
+ * Main Public Methods
+ * */
+
+bool AsyncClient::connect(IPAddress ip, uint16_t port){
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32(&addr, ip);
+
+    return _connect(addr, port);
+}
+
+#if LWIP_IPV6
+bool AsyncClient::connect(IPv6Address ip, uint16_t port){
+    auto ipaddr = static_cast<const uint32_t*>(ip);
+    ip_addr_t addr = IPADDR6_INIT(ipaddr[0], ipaddr[1], ipaddr[2], ipaddr[3]);
+
+    return _connect(addr, port);
+}
+#endif
+
+void AsyncClient::close(bool now){
+    if(_pcb){
+        _tcp_recved(_pcb, _closed_slot, _rx_ack_len);
+    }
+    _close();
+}
+
+int8_t AsyncClient::abort(){
+    if(_pcb) {
+        _tcp_abort(_pcb, _closed_slot );
+        _pcb = NULL;
+        _release_refs(true);
+    }
+    return ERR_ABRT;
+}
+
+size_t AsyncClient::space(){
+    if((_pcb != NULL) && (_pcb->state == 4)){
+        return tcp_sndbuf(_pcb);
+    }
+    return 0;
+}
+
+size_t AsyncClient::add(const char* data, size_t size, uint8_t apiflags) {
+    if(!_pcb || size == 0 || data == NULL) {
+        return 0;
+    }
+    size_t room = space();
+    if(!room) {
+        return 0;
+    }
+    size_t will_send = (room < size) ? room : size;
+    async_tcp_segment_t segment = { data, will_send, apiflags };
+    size_t written = 0;
+    if(_tcp_writev(_pcb, _closed_slot, &segment, 1, false, &written) != ERR_OK) {
+        return 0;
+    }
+    _tx_queued += written;
+    return written;
+}
+
+size_t AsyncClient::addv(const async_tcp_segment_t * segments, size_t count) {
+    if(!_pcb || !segments || !count) {
+        return 0;
+    }
+    size_t written = 0;
+    _tcp_writev(_pcb, _closed_slot, segments, count, false, &written);
+    _tx_queued += written;
+    return written;
+}
+
+bool AsyncClient::send(){
+    auto backup = _tx_last_packet;
+    _tx_last_packet = millis();
+    if (_tcp_output(_pcb, _closed_slot) == ERR_OK) {
+        _arm_ack_timeout();
+        return true;
+    }
+    _tx_last_packet = backup;
+    return false;
+}
+
+size_t AsyncClient::ack(size_t len){
+    if(len > _rx_ack_len)
+        len = _rx_ack_len;
+    if(len){
+        _tcp_recved(_pcb, _closed_slot, len);
+    }
+    _rx_ack_len -= len;
+    return len;
+}
+
+void AsyncClient::ackPacket(struct pbuf * pb){
+  if(!pb){
+    return;
+  }
+  _tcp_recved(_pcb, _closed_slot, pb->len);
+  pbuf_free(pb);
+}
+
+/*
+ * Main Private Methods
+ * */
+
+int8_t AsyncClient::_close(){
+    //ets_printf("X: 0x%08x\n", (uint32_t)this);
+    int8_t err = ERR_OK;
+    if(_pcb) {
+        _tcp_detach(_pcb);
+        _tcp_clear_events(this);
+        //once closed the stack could still be sending from zero-copy buffers nobody tracks anymore
+        err = _tx_refs_pending ? (int8_t)ERR_ABRT : _tcp_close(_pcb, _closed_slot);
+        if(err != ERR_OK) {
+            err = abort();
+        }
+        _pcb = NULL;
+        _release_refs(true);
+        if(_discard_cb) {
+            _discard_cb(_discard_cb_arg, this);
+        }
+    }
+    return err;
+}
+
+//a closed connection leaves a dead tombstone behind, a new one needs a fresh one
+void AsyncClient::_attach_event_owner(){
+    if(_events && !_events->dead){
+        return;
+    }
+    _release_event_owner(_events);
+    _events = _new_event_owner(this);
+    _poll_queued = false;
+    _sent_deferred = 0;
+    _tx_queued = 0;
+    _tx_acked = 0;
+}
+
+bool AsyncClient::_ack_pending(){
+    const uint32_t one_day = 86400000;
+    return (_rx_last_ack - _tx_last_packet + one_day) < one_day;
+}
+
+//after sending: the ACK deadline only needs arming when it is earlier than the armed one
+void AsyncClient::_arm_ack_timeout(){
+    uint32_t due = _events ? (uint32_t)_events->due : 0;
+    if(_ack_timeout && (!due || (int32_t)(due - (_tx_last_packet + _ack_timeout)) > 0)){
+        _rearm_timer();
+    }
+}
+
+//In Async Thread of this client: arms its earliest deadline, or nothing when it has none
+void AsyncClient::_schedule_timer(){
+    if(!_events || _events->dead){
+        return;
+    }
+    bool armed = false;
+    uint32_t due = 0;
+    uint32_t now = millis();
+    uint32_t deadlines[3];
+    size_t count = 0;
+    if(_pcb){
+        if(_ack_timeout && _ack_pending()){
+            //an ACK timeout that was already reported is reported again after a poll interval
+            uint32_t at = _tx_last_packet + _ack_timeout;
+            deadlines[count++] = ((int32_t)(at - now) > 0) ? at : now + ASYNC_POLL_INTERVAL;
+        }
+        if(_rx_timeout){
+            deadlines[count++] = _rx_last_packet + _rx_timeout * 1000;
+        }
+        if(_poll_cb && _poll_interval){
+            deadlines[count++] = _last_poll + _poll_interval;
+        }
+    }
+    for(size_t i = 0; i < count; ++i){
+        if(!armed || (int32_t)(deadlines[i] - due) < 0){
+            due = deadlines[i];
+            armed = true;
+        }
+    }
+    if(armed){
+        _arm_event_timer(_events, due);
+    } else {
+        _disarm_event_timer(_events);
+    }
+}
+
+//zero-copy write, the release is queued only once the stack has accepted some of the data
+size_t AsyncClient::_add_ref(const char* data, size_t size, AcReleaseHandler release, void* arg, uint8_t apiflags, bool output){
+    if(!_pcb || !data || !size || !_tx_refs_lock) {
+        return 0;
+    }
+    void * slot = _tx_ref_pool.alloc();
+    if(!slot) {
+        return 0;
+    }
+    async_tx_ref * ref = new (slot) async_tx_ref();
+    //counted before the write, so a FIN handled meanwhile by the stack aborts instead of closing
+    _tx_refs_pending++;
+    async_tcp_segment_t segment = { data, size, (uint8_t)(apiflags & ~ASYNC_WRITE_FLAG_COPY) };
+    auto backup = _tx_last_packet;
+    if(output) {
+        _tx_last_packet = millis();
+    }
+    size_t written = 0;
+    int8_t err = _tcp_writev(_pcb, _closed_slot, &segment, 1, output, &written);
+    if(!written) {
+        _tx_last_packet = backup;
+        _tx_refs_pending--;
+        ref->~async_tx_ref();
+        _tx_ref_pool.release(ref);
+        return 0;
+    }
+    _tx_queued += written;
+    ref->next = NULL;
+    ref->end = _tx_queued;
+    ref->data = data;
+    ref->cb = release;
+    ref->arg = arg;
+    xSemaphoreTake(_tx_refs_lock, portMAX_DELAY);
+    if(_tx_refs_tail) {
+        _tx_refs_tail->next = ref;
+    } else {
+        _tx_refs = ref;
+    }
+    _tx_refs_tail = ref;
+    xSemaphoreGive(_tx_refs_lock);
+    if(output && err == ERR_OK) {
+        _arm_ack_timeout();
+    }
+    //the ack may have come in before the release was queued
+    _release_refs(false);
+    return written;
+}
+
+//releases what has been acked, or everything once the stack has let go of the connection
+void AsyncClient::_release_refs(bool all){
+    if(!_tx_refs_pending || !_tx_refs_lock) {
+        return;
+    }
+    async_tx_ref * done = NULL;
+    xSemaphoreTake(_tx_refs_lock, portMAX_DELAY);
+    if(all) {
+        done = _tx_refs;
+        _tx_refs = NULL;
+    } else if(_tx_refs && (int32_t)(_tx_acked - _tx_refs->end) >= 0) {
+        done = _tx_refs;
+        async_tx_ref * last = done;
+        while(last->next && (int32_t)(_tx_acked - last->next->end) >= 0) {
+            last = last->next;
+        }
+        _tx_refs = last->next;
+        last->next = NULL;
+    }
+    if(!_tx_refs) {
+        _tx_refs_tail = NULL;
+    }
+    xSemaphoreGive(_tx_refs_lock);
+    while(done) {
+        async_tx_ref * next = done->next;
+        _tx_refs_pending--;
+        if(done->cb) {
+            done->cb(done->arg, this, done->data);
+        }
+        done->~async_tx_ref();
+        _tx_ref_pool.release(done);
+        done = next;
+    }
+}
+
+/*
+ * Private Callbacks
+ * */
+
+int8_t AsyncClient::_connected(void* pcb, int8_t err){
+    _pcb = reinterpret_cast<tcp_pcb*>(pcb);
+    if(_pcb){
+        _rx_last_packet = millis();
+        _last_poll = _rx_last_packet;
+        _schedule_timer();
+//        tcp_recv(_pcb, &_tcp_recv);
+//        tcp_sent(_pcb, &_tcp_sent);
+//        tcp_poll(_pcb, &_tcp_poll, 1);
+    }
+    if(_connect_cb) {
+        _connect_cb(_connect_cb_arg, this);
+    }
+    return ERR_OK;
+}
+
+void AsyncClient::_error(int8_t err) {
+    //the stack has freed the PCB and everything it still held, it must not be touched anymore
+    _pcb = NULL;
+    _release_refs(true);
+    if(_error_cb) {
+        _error_cb(_error_cb_arg, this, err);
+    }
+    if(_discard_cb) {
+        _discard_cb(_discard_cb_arg, this);
+    }
+}
+
+//In Async Thread
+int8_t AsyncClient::_fin(tcp_pcb* pcb, int8_t err) {
+    _tcp_clear_events(this);
+    _release_refs(true);
+    if(_discard_cb) {
+        _discard_cb(_discard_cb_arg, this);
+    }
+    return ERR_OK;
+}
+
+int8_t AsyncClient::_sent(tcp_pcb* pcb, uint16_t len) {
+    _rx_last_packet = millis();
+    _rx_last_ack = millis();
+    _tx_acked += len;
+    _release_refs(false);
+    //log_i("%u", len);
+    if(_sent_cb) {
+        _sent_cb(_sent_cb_arg, this, len, (millis() - _tx_last_packet));
+    }
+    return ERR_OK;
+}
+
+int8_t AsyncClient::_recv(tcp_pcb* pcb, pbuf* pb, int8_t err) {
+    while(pb != NULL) {
+        _rx_last_packet = millis();
+        //we should not ack before we assimilate the data
+        _ack_pcb = true;
+        pbuf *b = pb;
+        pb = b->next;
+        b->next = NULL;
+        if(_pb_cb){
+            _pb_cb(_pb_cb_arg, this, b);
+        } else {
+            if(_recv_cb) {
+                _recv_cb(_recv_cb_arg, this, b->payload, b->len);
+            }
+            if(!_ack_pcb) {
+                _rx_ack_len += b->len;
+            } else if(_pcb) {
+                _tcp_recved(_pcb, _closed_slot, b->len);
+            }
+            pbuf_free(b);
+        }
+    }
+    return ERR_OK;
+}
+
+//In Async Thread, when the timer fires or another thread asked for a re-check.
+//The next deadline is armed before any callback, as those may delete the client.
+int8_t AsyncClient::_poll(tcp_pcb* pcb){
+    if(!_pcb){
+        //closed while the timer was armed
+        return ERR_OK;
+    }
+    if(pcb != _pcb){
+        log_e("%p != %p", pcb, _pcb);
+        return ERR_OK;
+    }
+
+    uint32_t now = millis();
+
+    // ACK Timeout
+    if(_ack_timeout && _ack_pending() && (now - _tx_last_packet) >= _ack_timeout) {
+        log_w("ack timeout %d", state());
+        _schedule_timer();
+        if(_timeout_cb)
+            _timeout_cb(_timeout_cb_arg, this, (now - _tx_last_packet));
+        return ERR_OK;
+    }
+    // RX Timeout
+    if(_rx_timeout && (now - _rx_last_packet) >= (_rx_timeout * 1000)) {
+        log_w("rx timeout %d", state());
+        _close();
+        return ERR_OK;
+    }
+    // Everything is fine
+    bool poll = _poll_cb && _poll_interval && (now - _last_poll) >= _poll_interval;
+    if(poll){
+        _last_poll = now;
+    }
+    _schedule_timer();
+    if(poll) {
+        _poll_cb(_poll_cb_arg, this);
+    }
+    return ERR_OK;
+}
+
+void AsyncClient::_dns_found(struct ip_addr *ipaddr){
+    if(ipaddr && IP_IS_V4(ipaddr)){
+        connect(IPAddress(ip_addr_get_ip4_u32(ipaddr)), _connect_port);
+#if LWIP_IPV6
+    } else if(ipaddr && IP_IS_V6(ipaddr)){
+        connect(IPv6Address(ipaddr->u_addr.ip6.addr), _connect_port);
+#endif
+    } else {
+        if(_error_cb) {
+            _error_cb(_error_cb_arg, this, -55);
+        }
+        if(_discard_cb) {
+            _discard_cb(_discard_cb_arg, this);
+        }
+    }
+}
+
+/*
+ * Public Helper Methods
+ * */
+
+void AsyncClient::stop() {
+    close(false);
+}
+
+bool AsyncClient::free(){
+    if(!_pcb) {
+        return true;
+    }
+    if(_pcb->state == 0 || _pcb->state > 4) {
+        return true;
+    }
+    return false;
+}
+
+size_t AsyncClient::write(const char* data) {
+    if(data == NULL) {
+        return 0;
+    }
+    return write(data, strlen(data));
+}
+
+size_t AsyncClient::write(const char* data, size_t size, uint8_t apiflags) {
+    async_tcp_segment_t segment = { data, size, apiflags };
+    return writev(&segment, 1);
+}
+
+size_t AsyncClient::writev(const async_tcp_segment_t * segments, size_t count) {
+    if(!_pcb || !segments || !count) {
+        return 0;
+    }
+    auto backup = _tx_last_packet;
+    _tx_last_packet = millis();
+    size_t written = 0;
+    int8_t err = _tcp_writev(_pcb, _closed_slot, segments, count, true, &written);
+    _tx_queued += written;
+    if(err != ERR_OK || !written) {
+        _tx_last_packet = backup;
+        return 0;
+    }
+    _arm_ack_timeout();
+    return written;
+}
+
+size_t AsyncClient::addRef(const char* data, size_t size, AcReleaseHandler release, void* arg, uint8_t apiflags) {
+    return _add_ref(data, size, release, arg, apiflags, false);
+}
+
+size_t AsyncClient::writeRef(const char* data, size_t size, AcReleaseHandler release, void* arg, uint8_t apiflags) {
+    return _add_ref(data, size, release, arg, apiflags, true);
+}
+
+void AsyncClient::setRxTimeout(uint32_t timeout){
+    if(_rx_timeout == timeout){
+        return;
+    }
+    _rx_timeout = timeout;
+    _rearm_timer();
+}
+
+uint32_t AsyncClient::getRxTimeout(){
+    return _rx_timeout;
+}
+
+uint32_t AsyncClient::getAckTimeout(){
+    return _ack_timeout;
+}
+
+void AsyncClient::setAckTimeout(uint32_t timeout){
+    if(_ack_timeout == timeout){
+        return;
+    }
+    _ack_timeout = timeout;
+    _rearm_timer();
+}
+
+uint32_t AsyncClient::getPollInterval(){
+    return _poll_interval;
+}
+
+void AsyncClient::setPollInterval(uint32_t interval){
+    if(_poll_interval == interval){
+        return;
+    }
+    _poll_interval = interval;
+    _rearm_timer();
+}
+
+void AsyncClient::setNoDelay(bool nodelay){
+    if(!_pcb) {
+        return;
+    }
+    if(nodelay) {
+        tcp_nagle_disable(_pcb);
+    } else {
+        tcp_nagle_enable(_pcb);
+    }
+}
+
+bool AsyncClient::getNoDelay(){
+    if(!_pcb) {
+        return false;
+    }
+    return tcp_nagle_disabled(_pcb);
+}
+
+uint16_t AsyncClient::getMss(){
+    if(!_pcb) {
+        return 0;
+    }
+    return tcp_mss(_pcb);
+}
+
+uint32_t AsyncClient::getRemoteAddress() {
+    if(!_pcb) {
+        return 0;
+    }
+#if LWIP_IPV4 && LWIP_IPV6
+    return _pcb->remote_ip.u_addr.ip4.addr;
+#else
+    return _pcb->remote_ip.addr;
+#endif
+}
+
+#if LWIP_IPV6
+ip6_addr_t AsyncClient::getRemoteAddress6() {
+    if(!_pcb) {
+        ip6_addr_t nulladdr;
+        ip6_addr_set_zero(&nulladdr);
+        return nulladdr;
+    }
+    return _pcb->remote_ip.u_addr.ip6;
+}
+
+ip6_addr_t AsyncClient::getLocalAddress6() {
+    if(!_pcb) {
+        ip6_addr_t nulladdr;
+        ip6_addr_set_zero(&nulladdr);
+        return nulladdr;
+    }
+    return _pcb->local_ip.u_addr.ip6;
+}
+
+IPv6Address AsyncClient::remoteIP6() {
+    return IPv6Address(getRemoteAddress6().addr);
+}
+
+IPv6Address AsyncClient::localIP6() {
+    return IPv6Address(getLocalAddress6().addr);
+}
+#endif
+
+uint16_t AsyncClient::getRemotePort() {
+    if(!_pcb) {
+        return 0;
+    }
+    return _pcb->remote_port;
+}
+
+uint32_t AsyncClient::getLocalAddress() {
+    if(!_pcb) {
+        return 0;
+    }
+#if LWIP_IPV4 && LWIP_IPV6
+    return _pcb->local_ip.u_addr.ip4.addr;
+#else
+    return _pcb->local_ip.addr;
+#endif
+}
+
+uint16_t AsyncClient::getLocalPort() {
+    if(!_pcb) {
+        return 0;
+    }
+    return _pcb->local_port;
+}
+
+IPAddress AsyncClient::remoteIP() {
+    return IPAddress(getRemoteAddress());
+}
+
+uint16_t AsyncClient::remotePort() {
+    return getRemotePort();
+}
+
+IPAddress AsyncClient::localIP() {
+    return IPAddress(getLocalAddress());
+}
+
+
+uint16_t AsyncClient::localPort() {
+    return getLocalPort();
+}
+
+uint8_t AsyncClient::state() {
+    if(!_pcb) {
+        return 0;
+    }
+    return _pcb->state;
+}
+
+bool AsyncClient::connected(){
+    if (!_pcb) {
+        return false;
+    }
+    return _pcb->state == 4;
+}
+
+bool AsyncClient::connecting(){
+    if (!_pcb) {
+        return false;
+    }
+    return _pcb->state > 0 && _pcb->state < 4;
+}
+
+bool AsyncClient::disconnecting(){
+    if (!_pcb) {
+        return false;
+    }
+    return _pcb->state > 4 && _pcb->state < 10;
+}
+
+bool AsyncClient::disconnected(){
+    if (!_pcb) {
+        return true;
+    }
+    return _pcb->state == 0 || _pcb->state == 10;
+}
+
+bool AsyncClient::freeable(){
+    if (!_pcb) {
+        return true;
+    }
+    return _pcb->state == 0 || _pcb->state > 4;
+}
+
+bool AsyncClient::canSend(){
+    return space() > 0;
+}
+
+const char * AsyncClient::errorToString(int8_t error){
+    switch(error){
+        case ERR_OK: return "OK";
+        case ERR_MEM: return "Out of memory error";
+        case ERR_BUF: return "Buffer error";
+        case ERR_TIMEOUT: return "Timeout";
+        case ERR_RTE: return "Routing problem";
+        case ERR_INPROGRESS: return "Operation in progress";
+        case ERR_VAL: return "Illegal value";
+        case ERR_WOULDBLOCK: return "Operation would block";
+        case ERR_USE: return "Address in use";
+        case ERR_ALREADY: return "Already connected";
+        case ERR_CONN: return "Not connected";
+        case ERR_IF: return "Low-level netif error";
+        case ERR_ABRT: return "Connection aborted";
+        case ERR_RST: return "Connection reset";
+        case ERR_CLSD: return "Connection closed";
+        case ERR_ARG: return "Illegal argument";
+        case -55: return "DNS failed";
+        default: return "UNKNOWN";
+    }
+}
+
+const char * AsyncClient::stateToString(){
+    switch(state()){
+        case 0: return "Closed";
+        case 1: return "Listen";
+        case 2: return "SYN Sent";
+        case 3: return "SYN Received";
+        case 4: return "Established";
+        case 5: return "FIN Wait 1";
+        case 6: return "FIN Wait 2";
+        case 7: return "Close Wait";
+        case 8: return "Closing";
+        case 9: return "Last ACK";
+        case 10: return "Time Wait";
+        default: return "UNKNOWN";
+    }
+}
+
+/*
+ * Static Callbacks (LwIP C2C++ interconnect)
+ * */
+
+void AsyncClient::_s_dns_found(const char * name, struct ip_addr * ipaddr, void * arg){
+    reinterpret_cast<AsyncClient*>(arg)->_dns_found(ipaddr);
+}
+
+int8_t AsyncClient::_s_poll(void * arg, struct tcp_pcb * pcb) {
+    return reinterpret_cast<AsyncClient*>(arg)->_poll(pcb);
+}
+
+int8_t AsyncClient::_s_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_t err) {
+    return reinterpret_cast<AsyncClient*>(arg)->_recv(pcb, pb, err);
+}
+
+int8_t AsyncClient::_s_fin(void * arg, struct tcp_pcb * pcb, int8_t err) {
+    return reinterpret_cast<AsyncClient*>(arg)->_fin(pcb, err);
+}
+
+int8_t AsyncClient::_s_lwip_fin(void * arg, struct tcp_pcb * pcb, int8_t err) {
+    return reinterpret_cast<AsyncClient*>(arg)->_lwip_fin(pcb, err);
+}
+
+int8_t AsyncClient::_s_sent(void * arg, struct tcp_pcb * pcb, uint16_t len) {
+    return reinterpret_cast<AsyncClient*>(arg)->_sent(pcb, len);
+}
+
+void AsyncClient::_s_error(void * arg, int8_t err) {
+    reinterpret_cast<AsyncClient*>(arg)->_error(err);
+}
+
+int8_t AsyncClient::_s_connected(void * arg, void * pcb, int8_t err){
+    return reinterpret_cast<AsyncClient*>(arg)->_connected(pcb, err);
+}
+
+/*
+  Async TCP Server
+ */
+
+AsyncServer::AsyncServer(IPAddress addr, uint16_t port)
+: _port(port)
+, _bind4(true)
+, _addr(addr)
+, _noDelay(false)
+, _pcb(0)
+, _connect_cb(0)
+, _connect_cb_arg(0)
+{}
+
+AsyncServer::AsyncServer(IPv6Address addr, uint16_t port)
+: _port(port)
+, _bind6(true)
+, _addr6(addr)
+, _noDelay(false)
+, _pcb(0)
+, _connect_cb(0)
+, _connect_cb_arg(0)
+{}
+
+AsyncServer::AsyncServer(uint16_t port)
+: _port(port)
+, _bind4(true)
+, _bind6(true)
+, _addr((uint32_t) IPADDR_ANY)
+, _addr6()
+, _noDelay(false)
+, _pcb(0)
+, _connect_cb(0)
+, _connect_cb_arg(0)
+{}
+
+AsyncServer::~AsyncServer(){
+    end();
+}
+
+void AsyncServer::onClient(AcConnectHandler cb, void* arg){
+    _connect_cb = cb;
+    _connect_cb_arg = arg;
+}
+
+int8_t AsyncServer::_accepted(AsyncClient* client){
+    if(_connect_cb){
+        _connect_cb(_connect_cb_arg, client);
+    }
+    return ERR_OK;
+}
+
+void AsyncServer::setNoDelay(bool nodelay){
+    _noDelay = nodelay;
+}
+
+bool AsyncServer::getNoDelay(){
+    return _noDelay;
+}
+
+uint8_t AsyncServer::status(){
+    if (!_pcb) {
+        return 0;
+    }
+    return _pcb->state;
+}
+
+int8_t AsyncServer::_s_accept(void * arg, tcp_pcb * pcb, int8_t err){
+    return reinterpret_cast<AsyncServer*>(arg)->_accept(pcb, err);
+}
+
+int8_t AsyncServer::_s_accepted(void *arg, AsyncClient* client){
+    return reinterpret_cast<AsyncServer*>(arg)->_accepted(client);
+}
@@ -0,0 +1,216 @@
+/*
+  Asynchronous TCP library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ASYNCTCPTIMER_H_
+#define ASYNCTCPTIMER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Hierarchical timer wheel.
+ * Three levels of 64 slots: a level 0 slot is one tick wide and every slot
+ * of the level above spans a whole turn of the level below. Far deadlines
+ * wait in the upper levels and are moved down as their turn comes, so
+ * scheduling and cancelling are O(1) and nothing is looked at before it is
+ * nearly due. Deadlines beyond the last level are clamped to it, callers
+ * re-check when they fire. Not thread safe, a wheel belongs to one task.
+ * */
+
+typedef struct async_timer_node {
+    struct async_timer_node * prev;
+    struct async_timer_node * next;     //NULL while not scheduled
+    uint32_t expires;                   //tick at which it fires
+} async_timer_node_t;
+
+class AsyncTimerWheel {
+  public:
+    static const uint32_t NEVER = 0xFFFFFFFF;
+    static const uint32_t SLOT_BITS = 6;
+    static const uint32_t SLOTS = 1 << SLOT_BITS;
+    static const uint32_t LEVELS = 3;
+
+    typedef void (*expired_fn)(async_timer_node_t * node, void * arg);
+
+    AsyncTimerWheel(uint32_t tick_ms = 32) : _tick_ms(tick_ms), _now(0), _last_ms(0), _count(0) {
+        for(uint32_t l = 0; l < LEVELS; ++l){
+            for(uint32_t s = 0; s < SLOTS; ++s){
+                _slots[l][s].prev = _slots[l][s].next = &_slots[l][s];
+            }
+        }
+    }
+
+    void begin(uint32_t now_ms){
+        _last_ms = now_ms;
+    }
+
+    uint32_t armed() const { return _count; }
+
+    static bool scheduled(const async_timer_node_t * node){ return node->next != NULL; }
+
+    //(re)schedules the node to fire at due_ms (millis() time), never earlier
+    void schedule(async_timer_node_t * node, uint32_t due_ms){
+        if(scheduled(node)){
+            cancel(node);
+        }
+        int32_t delta_ms = (int32_t)(due_ms - _last_ms);
+        uint32_t ticks = (delta_ms > 0) ? (((uint32_t)delta_ms + _tick_ms - 1) / _tick_ms) : 0;
+        //the current tick has already fired
+        node->expires = _now + (ticks ? ticks : 1);
+        _place(node);
+        _count++;
+    }
+
+    void cancel(async_timer_node_t * node){
+        if(!scheduled(node)){
+            return;
+        }
+        _unlink(node);
+        _count--;
+    }
+
+    //milliseconds until advance() has something to do, NEVER when nothing is armed
+    uint32_t next(uint32_t now_ms) const {
+        if(!_count){
+            return NEVER;
+        }
+        uint32_t t = _now + 1;
+        //level 0 holds everything due within one turn
+        while(t - _now <= SLOTS && !_cascades(t) && _empty(_slots[0][t & (SLOTS - 1)])){
+            t++;
+        }
+        if(t - _now > SLOTS){
+            //past that only the turns that bring something down matter
+            t = ((_now + SLOTS) | (SLOTS - 1)) + 1;
+            while((t - _now) < (1UL << (SLOT_BITS * LEVELS)) && !_cascades(t)){
+                t += SLOTS;
+            }
+        }
+        uint32_t wait = (t - _now) * _tick_ms;
+        uint32_t elapsed = now_ms - _last_ms;
+        return (wait > elapsed) ? (wait - elapsed) : 0;
+    }
+
+    //fires everything that is due by now_ms, returns how many fired
+    uint32_t advance(uint32_t now_ms, expired_fn fn, void * arg){
+        uint32_t ticks = (now_ms - _last_ms) / _tick_ms;
+        _last_ms += ticks * _tick_ms;
+        uint32_t fired = 0;
+        while(ticks--){
+            if(!_count){
+                _now += ticks + 1;
+                break;
+            }
+            _now++;
+            if((_now & (SLOTS - 1)) == 0){
+                if((_now & ((SLOTS * SLOTS) - 1)) == 0){
+                    _cascade(_slots[2][(_now >> (SLOT_BITS * 2)) & (SLOTS - 1)]);
+                }
+                _cascade(_slots[1][(_now >> SLOT_BITS) & (SLOTS - 1)]);
+            }
+            //take the slot out first, callbacks may schedule again
+            async_timer_node_t due;
+            _take(_slots[0][_now & (SLOTS - 1)], due);
+            while(!_empty(due)){
+                async_timer_node_t * node = due.next;
+                _unlink(node);
+                _count--;
+                fired++;
+                fn(node, arg);
+            }
+        }
+        return fired;
+    }
+
+  private:
+    static bool _empty(const async_timer_node_t & head){
+        return head.next == &head;
+    }
+
+    static void _unlink(async_timer_node_t * node){
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node->next = NULL;
+    }
+
+    static void _append(async_timer_node_t & head, async_timer_node_t * node){
+        node->prev = head.prev;
+        node->next = &head;
+        head.prev->next = node;
+        head.prev = node;
+    }
+
+    //moves the whole list of head into the empty list out
+    static void _take(async_timer_node_t & head, async_timer_node_t & out){
+        if(_empty(head)){
+            out.prev = out.next = &out;
+            return;
+        }
+        out.next = head.next;
+        out.prev = head.prev;
+        out.next->prev = &out;
+        out.prev->next = &out;
+        head.prev = head.next = &head;
+    }
+
+    bool _cascades(uint32_t t) const {
+        if((t & (SLOTS - 1)) != 0){
+            return false;
+        }
+        if((t & ((SLOTS * SLOTS) - 1)) == 0 && !_empty(_slots[2][(t >> (SLOT_BITS * 2)) & (SLOTS - 1)])){
+            return true;
+        }
+        return !_empty(_slots[1][(t >> SLOT_BITS) & (SLOTS - 1)]);
+    }
+
+    void _place(async_timer_node_t * node){
+        uint32_t delta = node->expires - _now;
+        if(delta < SLOTS){
+            _append(_slots[0][node->expires & (SLOTS - 1)], node);
+        } else if(delta < SLOTS * SLOTS){
+            _append(_slots[1][(node->expires >> SLOT_BITS) & (SLOTS - 1)], node);
+        } else {
+            if(delta >= (1UL << (SLOT_BITS * LEVELS))){
+                node->expires = _now + (1UL << (SLOT_BITS * LEVELS)) - 1;
+            }
+            _append(_slots[2][(node->expires >> (SLOT_BITS * 2)) & (SLOTS - 1)], node);
+        }
+    }
+
+    //re-files the entries of an upper slot whose turn has come
+    void _cascade(async_timer_node_t & head){
+        async_timer_node_t moving;
+        _take(head, moving);
+        while(!_empty(moving)){
+            async_timer_node_t * node = moving.next;
+            _unlink(node);
+            _place(node);
+        }
+    }
+
+    uint32_t _tick_ms;
+    uint32_t _now;          //current tick
+    uint32_t _last_ms;      //millis() at the start of the current tick
+    uint32_t _count;
+    async_timer_node_t _slots[LEVELS][SLOTS];
+};
+
+#endif /* ASYNCTCPTIMER_H_ */
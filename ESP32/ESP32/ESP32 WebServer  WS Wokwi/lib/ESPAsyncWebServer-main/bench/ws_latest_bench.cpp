@@ -0,0 +1,146 @@
+/*
+  Host benchmark: a WebSocket client that falls behind, textAll() vs textLatestAll()
+
+  A client connects over the loopback with a 4 KB receive buffer and stops
+  reading, like a browser tab in the background. Readings of 1 KB for two
+  sensors, each with its sequence number, are broadcast in turn until the
+  TCP buffers and the client queue are full and beyond. Then the client
+  reads everything it was sent.
+
+  "textAll" queues every reading and drops the newest once the queue is
+  full, so what the client sees last is as old as the moment it stopped
+  reading. "latest" gives each sensor a topic: a reading waiting in the
+  queue is replaced by the next one of its sensor, and the client ends on
+  the last reading of both. The queue stats of the client are printed.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -I../../AsyncTCP-main/host/include -I../../AsyncTCP-main/src -I../src ws_latest_bench.cpp ../src/*.cpp ../../AsyncTCP-main/src/AsyncTCPClient.cpp ../../AsyncTCP-main/host/src/*.cpp -o ws_latest_bench -lpthread
+//  ./ws_latest_bench [readings] [port]
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <string>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static AsyncWebSocketClient *target = NULL;
+
+static int connectTo(uint16_t port){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int rcvbuf = 4096;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//reads frames until the server has been quiet for a while, keeps the last sequence of each sensor
+static uint32_t readAll(int fd, long last[2]){
+    std::string got;
+    char buf[16384];
+    struct timeval timeout = { 0, 300000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    for(;;){
+        ssize_t r = recv(fd, buf, sizeof(buf), 0);
+        if(r <= 0){
+            break;
+        }
+        got.append(buf, r);
+    }
+    uint32_t frames = 0;
+    size_t at = 0;
+    while(got.size() - at >= 4){
+        size_t len = (uint8_t)got[at + 1] & 0x7F;
+        size_t head = 2;
+        if(len == 126){
+            len = ((uint8_t)got[at + 2] << 8) | (uint8_t)got[at + 3];
+            head = 4;
+        }
+        if(got.size() - at < head + len){
+            break;
+        }
+        int sensor = 0;
+        long seq = 0;
+        if(sscanf(got.c_str() + at + head, "{\"sensor\":%d,\"seq\":%ld", &sensor, &seq) == 2 && sensor >= 0 && sensor < 2){
+            last[sensor] = seq;
+        }
+        at += head + len;
+        frames++;
+    }
+    return frames;
+}
+
+static void run(AsyncWebSocket &ws, uint16_t port, bool latest, uint32_t readings){
+    target = NULL;
+    int fd = connectTo(port);
+    const char *upgrade = "GET /ws HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    send(fd, upgrade, strlen(upgrade), 0);
+    std::string head;
+    char c;
+    while(head.find("\r\n\r\n") == std::string::npos && recv(fd, &c, 1, 0) == 1){
+        head.push_back(c);
+    }
+    while(target == NULL){
+        delay(1);
+    }
+
+    char reading[1024];
+    for(uint32_t i = 0; i < readings; i++){
+        int sensor = i & 1;
+        int n = snprintf(reading, sizeof(reading), "{\"sensor\":%d,\"seq\":%u,\"samples\":\"", sensor, i);
+        memset(reading + n, 'x', sizeof(reading) - n - 2);
+        memcpy(reading + sizeof(reading) - 2, "\"}", 2);
+        if(latest){
+            ws.textLatestAll(1 + sensor, reading, sizeof(reading));
+        } else {
+            ws.textAll(reading, sizeof(reading));
+        }
+        //the loop() of a sketch does not broadcast faster than TCP gets a turn
+        if(!(i % 16)){
+            delay(1);
+        }
+    }
+    async_ws_queue_stats_t stats;
+    target->queueStats(&stats);
+
+    long last[2] = { -1, -1 };
+    uint32_t frames = readAll(fd, last);
+    printf("%-7s | %4u received | last %5ld %5ld | queue high water %2u | %5u conflated | %5u dropped\n",
+        latest ? "latest" : "textAll", frames, last[0], last[1], stats.high_water, stats.conflated, stats.dropped);
+    close(fd);
+    while(ws.count()){
+        delay(1);
+    }
+}
+
+int main(int argc, char **argv){
+    uint32_t readings = (argc > 1) ? atoi(argv[1]) : 4000;
+    uint16_t port = (argc > 2) ? atoi(argv[2]) : 18096;
+
+    AsyncWebServer server(port);
+    AsyncWebSocket ws("/ws");
+    ws.onEvent([](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len){
+        (void)server; (void)arg; (void)data; (void)len;
+        if(type == WS_EVT_CONNECT){
+            target = client;
+        }
+    });
+    server.addHandler(&ws);
+    server.begin();
+
+    printf("%u readings of 1 KB, the last ones %u and %u\n", readings, readings - 2, readings - 1);
+    run(ws, port, false, readings);
+    run(ws, port, true, readings);
+    return 0;
+}
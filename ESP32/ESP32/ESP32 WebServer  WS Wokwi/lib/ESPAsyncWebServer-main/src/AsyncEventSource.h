@@ -75,6 +75,12 @@ class AsyncEventSourceMessage {
     size_t send(AsyncClient *client);
     bool finished(){ return _acked == _len; }
     bool sent() { return _sent == _len; }
+#if defined(ESP32)
+    //the part not handed to the client yet, as one segment of a vectored write
+    async_tcp_segment_t pending() const;
+    //marks up to len bytes of it as handed over, returns how many it took
+    size_t written(size_t len);
+#endif
 };
 
 class AsyncEventSourceClient {
@@ -91,6 +97,7 @@ class AsyncEventSourceClient {
     void _queueMessage(AsyncEventSourceMessage *dataMessage);
     bool _tryQueueMessage(AsyncEventSourceMessage *dataMessage);
     void _runQueue();
+    void _schedulePoll();
 
   public:
 
@@ -138,6 +145,8 @@ class AsyncEventSource: public AsyncWebHandler {
     void _addClient(AsyncEventSourceClient * client);
     void _handleDisconnect(AsyncEventSourceClient * client);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual WebRouteMode route(const char *&pattern, size_t &length) override final;
+    virtual bool canHandleRoute(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
 };
 
@@ -196,13 +196,27 @@ public:
   void onRequest(ArJsonRequestHandlerFunction fn){ _onRequest = fn; }
 
   virtual bool canHandle(AsyncWebServerRequest *request) override final{
-    if(!_onRequest)
+    const char *pattern;
+    size_t length;
+    WebRouteMode mode = route(pattern, length);
+    if(!AsyncWebRouter::match(request, mode, pattern, length) || !canHandleRoute(request))
       return false;
 
-    if(!(_method & request->method()))
+    AsyncWebRouter::capture(request, pattern, length);
+    return true;
+  }
+
+  virtual WebRouteMode route(const char *&pattern, size_t &length) override final{
+    pattern = _uri.c_str();
+    length = _uri.length();
+    return length ? ROUTE_PATH : ROUTE_PREFIX;
+  }
+
+  virtual bool canHandleRoute(AsyncWebServerRequest *request) override final{
+    if(!_onRequest)
       return false;
 
-    if(_uri.length() && (_uri != request->url() && !request->url().startsWith(_uri+"/")))
+    if(!(_method & request->method()))
       return false;
 
     if ( !request->contentType().equalsIgnoreCase(JSON_MIMETYPE) )
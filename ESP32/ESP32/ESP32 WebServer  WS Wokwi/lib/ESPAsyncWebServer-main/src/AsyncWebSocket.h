@@ -22,6 +22,7 @@
 #define ASYNCWEBSOCKET_H_
 
 #include <Arduino.h>
+#include <atomic>
 #if defined(ESP32) || defined(LIBRETINY)
 #include <AsyncTCP.h>
 #ifndef WS_MAX_QUEUED_MESSAGES
@@ -84,6 +85,17 @@ typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PIN
 typedef enum { WS_MSG_SENDING, WS_MSG_SENT, WS_MSG_ERROR } AwsMessageStatus;
 typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
 
+typedef struct {
+  uint16_t queued;            //messages waiting to be sent now
+  uint16_t high_water;        //most that ever waited
+  uint32_t conflated;         //replaced while waiting by a newer message of the same topic
+  uint32_t dropped;           //not sent because the queue was full
+} async_ws_queue_stats_t;
+
+//XORs len bytes with the 4 byte mask key, the first with byte phase (0-3) of the key.
+//Returns the phase of the byte that follows, to continue a frame split across calls.
+uint8_t webSocketMask(uint8_t *data, size_t len, const uint8_t *mask, uint8_t phase);
+
 class AsyncWebSocketMessageBuffer {
   private:
     uint8_t * _data;
@@ -158,25 +170,82 @@ public:
     virtual size_t send(AsyncClient *client) override ;
 };
 
+//one complete unmasked frame, header and payload in a single allocation, shared by every
+//client a broadcast goes to. It is immutable once filled and freed with its last reference.
+class AsyncWebSocketSharedFrame {
+  private:
+    std::atomic<uint32_t> _refs;
+    size_t _len;
+    uint8_t _headLen;
+
+    AsyncWebSocketSharedFrame(uint8_t opcode, size_t len);
+    uint8_t * _frame(){ return (uint8_t *)(this + 1); }
+
+  public:
+    //one reference, held by the caller; the payload is left to fill
+    static AsyncWebSocketSharedFrame * create(uint8_t opcode, size_t len);
+    static AsyncWebSocketSharedFrame * create(uint8_t opcode, const uint8_t * data, size_t len);
+
+    uint8_t * payload(){ return _frame() + _headLen; }
+    const uint8_t * data(){ return _frame(); }
+    size_t length() const { return _headLen + _len; }
+    void ref(){ _refs.fetch_add(1, std::memory_order_relaxed); }
+    void unref();
+};
+
 class AsyncWebSocketClient {
   private:
+    //an entry of the send queue holds either a message or a reference to a shared frame
+    typedef struct {
+      AsyncWebSocketMessage * message;
+      AsyncWebSocketSharedFrame * frame;
+      uint16_t topic; //a frame that a newer one of the topic replaces while it waits, 0 for none
+    } AsyncWebSocketQueued;
+
     AsyncClient *_client;
     AsyncWebSocket *_server;
     uint32_t _clientId;
     AwsClientStatus _status;
 
     LinkedList<AsyncWebSocketControl *> _controlQueue;
-    LinkedList<AsyncWebSocketMessage *> _messageQueue;
+    AsyncWebSocketQueued _messageQueue[WS_MAX_QUEUED_MESSAGES];
+    uint16_t _queueHead;
+    uint16_t _queueLength;
+    size_t _frameSent;  //bytes of the shared frame in front handed to TCP
+    size_t _frameAcked; //and acked
+    uint16_t _queueHighWater;
+    uint32_t _conflated;
+    uint32_t _dropped;
+    //the queues are filled from the loop and drained on the async task
+    AsyncWebLock _lock;
 
     uint8_t _pstate;
     AwsFrameInfo _pinfo;
+    uint8_t _phead[14]; //a frame header split across reads
+    uint8_t _pheadLen;
+    uint8_t *_pcontrol; //a control frame split across reads
+    uint8_t *_pmessage; //the fragments of a message so far, when whole messages are delivered
+    size_t _pmessageLen;
+    bool _pdrop;        //a message was too long and the connection is closing
 
     uint32_t _lastMessageTime;
     uint32_t _keepAlivePeriod;
 
     void _queueMessage(AsyncWebSocketMessage *dataMessage);
+    void _queueFrame(AsyncWebSocketSharedFrame *frame, uint16_t topic);
+    void _queuePush(AsyncWebSocketMessage *dataMessage, AsyncWebSocketSharedFrame *frame, uint16_t topic);
+    void _queuePop();
+    bool _queueWaiting(uint16_t i);
+    void _queueRemove(uint16_t i);
+    bool _frontFinished();
+    bool _frontBetweenFrames();
+    void _sendFrame();
+    const uint8_t * _gatherHeader(uint8_t *&data, size_t &plen);
+    bool _handleFrame(uint8_t *data, size_t datalen);
+    void _handleData(uint8_t *data, size_t datalen);
     void _queueControl(AsyncWebSocketControl *controlMessage);
     void _runQueue();
+    void _schedulePoll();
 
   public:
     void *_tempObject;
@@ -201,6 +270,7 @@ class AsyncWebSocketClient {
     //set auto-ping period in seconds. disabled if zero (default)
     void keepAlivePeriod(uint16_t seconds){
       _keepAlivePeriod = seconds * 1000;
+      _schedulePoll();
     }
     uint16_t keepAlivePeriod(){
       return (uint16_t)(_keepAlivePeriod / 1000);
@@ -208,7 +278,10 @@ class AsyncWebSocketClient {
 
     //data packets
     void message(AsyncWebSocketMessage *message){ _queueMessage(message); }
+    //with a topic, the frame takes the place of the one of that topic still waiting, if there is one
+    void message(AsyncWebSocketSharedFrame *frame, uint16_t topic=0){ _queueFrame(frame, topic); }
     bool queueIsFull();
+    void queueStats(async_ws_queue_stats_t *stats);
 
     size_t printf(const char *format, ...)  __attribute__ ((format (printf, 2, 3)));
 #ifndef ESP32
@@ -230,7 +303,11 @@ class AsyncWebSocketClient {
     void binary(const __FlashStringHelper *data, size_t len);
     void binary(AsyncWebSocketMessageBuffer *buffer); 
 
-    bool canSend() { return _messageQueue.length() < WS_MAX_QUEUED_MESSAGES; }
+    //only the latest message of a topic waits to be sent, an older one still queued is replaced
+    void textLatest(uint16_t topic, const char * message, size_t len);
+    void textLatest(uint16_t topic, const String &message);
+
+    bool canSend() { return _queueLength < WS_MAX_QUEUED_MESSAGES; }
 
     //system callbacks (do not call)
     void _onAck(size_t len, uint32_t time);
@@ -253,14 +330,20 @@ class AsyncWebSocket: public AsyncWebHandler {
     uint32_t _cNextId;
     AwsEventHandler _eventHandler;
     bool _enabled;
+    size_t _maxMessageLen;
     AsyncWebLock _lock;
 
+    void _broadcast(uint8_t opcode, const uint8_t * data, size_t len, uint16_t topic=0);
+
   public:
     AsyncWebSocket(const String& url);
     ~AsyncWebSocket();
     const char * url() const { return _url.c_str(); }
     void enable(bool e){ _enabled = e; }
     bool enabled() const { return _enabled; }
+    //WS_EVT_DATA once per message, put together in up to maxLen bytes per client; 0 for every piece as it arrives
+    void wholeMessages(size_t maxLen){ _maxMessageLen = maxLen; }
+    size_t wholeMessages() const { return _maxMessageLen; }
     bool availableForWriteAll();
     bool availableForWrite(uint32_t id);
 
@@ -307,6 +390,13 @@ class AsyncWebSocket: public AsyncWebHandler {
 
     void message(uint32_t id, AsyncWebSocketMessage *message);
     void messageAll(AsyncWebSocketMultiMessage *message);
+    //queues the frame on every connected client, the caller keeps its own reference
+    void messageAll(AsyncWebSocketSharedFrame *frame, uint16_t topic=0);
+
+    //only the latest message of a topic waits in each client queue, see AsyncWebSocketClient::textLatest()
+    void textLatestAll(uint16_t topic, const char * message, size_t len);
+    void textLatestAll(uint16_t topic, const String &message);
+    void binaryLatestAll(uint16_t topic, const uint8_t * message, size_t len);
 
     size_t printf(uint32_t id, const char *format, ...)  __attribute__ ((format (printf, 3, 4)));
     size_t printfAll(const char *format, ...)  __attribute__ ((format (printf, 2, 3)));
@@ -326,6 +416,8 @@ class AsyncWebSocket: public AsyncWebHandler {
     void _handleDisconnect(AsyncWebSocketClient * client);
     void _handleEvent(AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual WebRouteMode route(const char *&pattern, size_t &length) override final;
+    virtual bool canHandleRoute(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
 
 
@@ -26,10 +26,11 @@ public:
   }
 
   bool lock() const {
-    extern void *pxCurrentTCB;
-    if (_lockedBy != pxCurrentTCB) {
+    //pxCurrentTCB is per core on the ESP32, ask FreeRTOS for the calling task
+    void *task = xTaskGetCurrentTaskHandle();
+    if (_lockedBy != task) {
       xSemaphoreTake(_lock, portMAX_DELAY);
-      _lockedBy = pxCurrentTCB;
+      _lockedBy = task;
       return true;
     }
     return false;
@@ -82,6 +83,14 @@ public:
       _lock->unlock();
     }
   }
+
+  //lets go before the end of the scope, e.g. ahead of a call that may delete the lock
+  void unlock() {
+    if (_lock) {
+      _lock->unlock();
+      _lock = NULL;
+    }
+  }
 };
 
 #endif // ASYNCWEBSYNCHRONIZATION_H_
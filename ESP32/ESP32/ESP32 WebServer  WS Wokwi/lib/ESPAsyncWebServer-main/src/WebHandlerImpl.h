@@ -50,6 +50,8 @@ class AsyncStaticWebHandler: public AsyncWebHandler {
   public:
     AsyncStaticWebHandler(const char* uri, FS& fs, const char* path, const char* cache_control);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual WebRouteMode route(const char *&pattern, size_t &length) override final;
+    virtual bool canHandleRoute(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
     AsyncStaticWebHandler& setIsDir(bool isDir);
     AsyncStaticWebHandler& setDefaultFile(const char* filename);
@@ -63,6 +65,26 @@ class AsyncStaticWebHandler: public AsyncWebHandler {
     AsyncStaticWebHandler& setTemplateProcessor(AwsTemplateProcessor newCallback) {_callback = newCallback; return *this;}
 };
 
+//Serves one gzipped asset from flash, answers a matching If-None-Match with 304
+class AsyncAssetWebHandler: public AsyncWebHandler {
+  private:
+    bool _notModified(AsyncWebServerRequest *request) const;
+  protected:
+    String _uri;
+    String _contentType;
+    const uint8_t * _content;
+    size_t _length;
+    String _etag;
+    String _cache_control;
+  public:
+    AsyncAssetWebHandler(const char* uri, const char* contentType, const uint8_t * content, size_t len, const char* etag, const char* cache_control);
+    virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual WebRouteMode route(const char *&pattern, size_t &length) override final;
+    virtual bool canHandleRoute(AsyncWebServerRequest *request) override final;
+    virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    AsyncAssetWebHandler& setCacheControl(const char* cache_control);
+};
+
 class AsyncCallbackWebHandler: public AsyncWebHandler {
   private:
   protected:
@@ -72,11 +94,46 @@ class AsyncCallbackWebHandler: public AsyncWebHandler {
     ArUploadHandlerFunction _onUpload;
     ArBodyHandlerFunction _onBody;
     bool _isRegex;
+#ifdef ASYNCWEBSERVER_REGEX
+    std::regex _regex;      //compiled once, in setUri()
+    String _regexPrefix;
+
+    //Literal start of an anchored regex: "^\/sensor\/([0-9]+)$" starts with "/sensor/".
+    //The router passes only URLs that start with it on to the regex.
+    static String _literalPrefix(const String& uri){
+      String prefix;
+      if(uri.indexOf('|') >= 0)
+        return prefix;
+      for(size_t i = 1; i < uri.length(); i++){ // after the ^
+        char c = uri[i];
+        if(c == '\\'){
+          if(i + 1 == uri.length() || isalnum(uri[i + 1])) // a class like \d
+            break;
+          c = uri[++i];
+        } else if(strchr(".[]()*+?{}|$^", c)){
+          break;
+        }
+        if(c == '{' || c == '}') // would read as a {name} segment
+          break;
+        if(i + 1 < uri.length() && strchr("*?{", uri[i + 1])) // may not be there at all
+          break;
+        prefix += c;
+      }
+      return prefix;
+    }
+#endif
   public:
     AsyncCallbackWebHandler() : _uri(), _method(HTTP_ANY), _onRequest(NULL), _onUpload(NULL), _onBody(NULL), _isRegex(false) {}
     void setUri(const String& uri){ 
       _uri = uri; 
+      AsyncWebRouter::changed();
       _isRegex = uri.startsWith("^") && uri.endsWith("$");
+#ifdef ASYNCWEBSERVER_REGEX
+      if (_isRegex) {
+        _regex = std::regex(uri.c_str());
+        _regexPrefix = _literalPrefix(uri);
+      }
+#endif
     }
     void setMethod(WebRequestMethodComposite method){ _method = method; }
     void onRequest(ArRequestHandlerFunction fn){ _onRequest = fn; }
@@ -84,7 +141,43 @@ class AsyncCallbackWebHandler: public AsyncWebHandler {
     void onBody(ArBodyHandlerFunction fn){ _onBody = fn; }
 
     virtual bool canHandle(AsyncWebServerRequest *request) override final{
+      const char *pattern;
+      size_t length;
+      WebRouteMode mode = route(pattern, length);
+      if(!AsyncWebRouter::match(request, mode, pattern, length) || !canHandleRoute(request))
+        return false;
 
+      AsyncWebRouter::capture(request, pattern, length);
+      return true;
+    }
+
+    //"/*.ext" ends with .ext, "/uri*" starts with /uri, "/uri" is /uri and below, "" is everything
+    virtual WebRouteMode route(const char *&pattern, size_t &length) override final{
+#ifdef ASYNCWEBSERVER_REGEX
+      if (_isRegex) {
+        pattern = _regexPrefix.c_str();
+        length = _regexPrefix.length();
+        return ROUTE_PREFIX;
+      }
+#endif
+      pattern = _uri.c_str();
+      length = _uri.length();
+      if (!length)
+        return ROUTE_PREFIX;
+      if (_uri.startsWith("/*.")) {
+        int dot = _uri.lastIndexOf('.');
+        pattern += dot;
+        length -= dot;
+        return ROUTE_EXTENSION;
+      }
+      if (_uri.endsWith("*")) {
+        length--;
+        return ROUTE_PREFIX;
+      }
+      return ROUTE_PATH;
+    }
+
+    virtual bool canHandleRoute(AsyncWebServerRequest *request) override final{
       if(!_onRequest)
         return false;
 
@@ -93,34 +186,20 @@ class AsyncCallbackWebHandler: public AsyncWebHandler {
 
 #ifdef ASYNCWEBSERVER_REGEX
       if (_isRegex) {
-        std::regex pattern(_uri.c_str());
-        std::smatch matches;
-        std::string s(request->url().c_str());
-        if(std::regex_search(s, matches, pattern)) {
-          for (size_t i = 1; i < matches.size(); ++i) { // start from 1
-            request->_addPathParam(matches[i].str().c_str());
-          }
-        } else {
+        const char *url = request->url().c_str();
+        const char *end = url + request->url().length();
+        //per call: requests of different connections can be routed at the same time
+        std::cmatch matches;
+        if(!std::regex_search(url, end, matches, _regex))
           return false;
+        for (size_t i = 1; i < matches.size(); ++i) { // start from 1
+          if(matches[i].matched)
+            request->_addPathParam(matches[i].first, matches[i].length());
+          else
+            request->_addPathParam(end, 0);
         }
-      } else 
-#endif
-      if (_uri.length() && _uri.startsWith("/*.")) {
-         String uriTemplate = String (_uri);
-         uriTemplate = uriTemplate.substring(uriTemplate.lastIndexOf("."));
-         if (!request->url().endsWith(uriTemplate))
-           return false;
       }
-      else
-      if (_uri.length() && _uri.endsWith("*")) {
-        String uriTemplate = String(_uri);
-	uriTemplate = uriTemplate.substring(0, uriTemplate.length() - 1);
-        if (!request->url().startsWith(uriTemplate))
-          return false;
-      }
-      else if(_uri.length() && (_uri != request->url() && !request->url().startsWith(_uri+"/")))
-        return false;
-
+#endif
       request->addInterestingHeader("ANY");
       return true;
     }
@@ -28,15 +28,96 @@
 
 static const String SharedEmptyString = String();
 
+#if defined(ESP32)
+static AsyncObjectPool<AsyncWebServerRequest> _requestPool;
+
+//called from AsyncWebServer::begin() before any request can exist
+bool AsyncWebServerRequest::_beginPool(){
+  return !ASYNCWEBSERVER_REQUEST_POOL_SIZE || _requestPool.begin(ASYNCWEBSERVER_REQUEST_POOL_SIZE);
+}
+
+void AsyncWebServer::requestPoolStats(async_pool_stats_t * stats){
+  _requestPool.stats(stats);
+}
+
+void* AsyncWebServerRequest::operator new(size_t size) noexcept {
+  if(size != sizeof(AsyncWebServerRequest)){
+    return malloc(size);
+  }
+  return _requestPool.alloc();
+}
+
+void AsyncWebServerRequest::operator delete(void* ptr){
+  _requestPool.release(reinterpret_cast<AsyncWebServerRequest*>(ptr));
+}
+#endif
+
 #define __is_param_char(c) ((c) && ((c) != '{') && ((c) != '[') && ((c) != '&') && ((c) != '='))
 
+//the head is parsed in place, these compare a slice of it without making a String
+static inline bool _sliceEquals(const char *s, size_t len, const char *what){
+  return strlen(what) == len && !memcmp(s, what, len);
+}
+
+static inline bool _sliceEqualsIgnoreCase(const char *s, size_t len, const char *what){
+  return strlen(what) == len && !strncasecmp(s, what, len);
+}
+
+static bool _sliceContainsIgnoreCase(const char *s, size_t len, const char *what){
+  const size_t whatLength = strlen(what);
+  for(size_t pos = 0; pos + whatLength <= len; pos++){
+    if(!strncasecmp(s + pos, what, whatLength)){
+      return true;
+    }
+  }
+  return false;
+}
+
+static String _sliceToString(const char *s, size_t len){
+  String str;
+  str.concat(s, len);
+  return str;
+}
+
+static String _urlDecode(const char *text, size_t len){
+  char temp[] = "0x00";
+  size_t i = 0;
+  String decoded = String();
+  decoded.reserve(len); // Allocate the string internal buffer - never longer from source text
+  while (i < len){
+    char decodedChar;
+    char encodedChar = text[i++];
+    if ((encodedChar == '%') && (i + 1 < len)){
+      temp[2] = text[i++];
+      temp[3] = text[i++];
+      decodedChar = strtol(temp, NULL, 16);
+    } else if (encodedChar == '+') {
+      decodedChar = ' ';
+    } else {
+      decodedChar = encodedChar;  // normal ascii char
+    }
+    decoded.concat(decodedChar);
+  }
+  return decoded;
+}
+
 enum { PARSE_REQ_START, PARSE_REQ_HEADERS, PARSE_REQ_BODY, PARSE_REQ_END, PARSE_REQ_FAIL };
 
-AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
+AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c, AsyncWebServerRequest* previous)
   : _client(c)
+  , _next(NULL)
+  , _pipelined(NULL)
+  , _pipelinedLength(0)
+  , _ackDebt(0)
+  , _requestCount(previous ? previous->_requestCount + 1 : 1)
+  , _active(previous == NULL)
+  , _keepAlive(false)
   , _server(s)
   , _handler(NULL)
   , _response(NULL)
+  , _line(NULL)
+  , _lineLength(0)
+  , _headLength(0)
   , _temp()
   , _parseState(0)
   , _version(0)
@@ -53,9 +134,11 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _expectingContinue(false)
   , _contentLength(0)
   , _parsedLength(0)
-  , _headers(LinkedList<AsyncWebHeader *>([](AsyncWebHeader *h){ delete h; }))
-  , _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p){ delete p; }))
-  , _pathParams(LinkedList<String *>([](String *p){ delete p; }))
+  , _headers(NULL)
+  , _lastHeader(NULL)
+  , _headerCount(0)
+  , _params()
+  , _pathParams()
   , _multiParseState(0)
   , _boundaryPosition(0)
   , _itemStartIndex(0)
@@ -69,6 +152,14 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _itemIsFile(false)
   , _tempObject(NULL)
 {
+  //a request following another one on the connection waits for it in _activate()
+  if(_active){
+    _attach();
+  }
+}
+
+void AsyncWebServerRequest::_attach(){
+  AsyncClient* c = _client;
   c->onError([](void *r, AsyncClient* c, int8_t error){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onError(error); }, this);
   c->onAck([](void *r, AsyncClient* c, size_t len, uint32_t time){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onAck(len, time); }, this);
   c->onDisconnect([](void *r, AsyncClient* c){ AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onDisconnect(); delete c; }, this);
@@ -78,12 +169,14 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
 }
 
 AsyncWebServerRequest::~AsyncWebServerRequest(){
-  _headers.free();
-
-  _params.free();
-  _pathParams.free();
+  if(_handler != NULL && _arena.used() > _handler->_arenaHighWater){
+    _handler->_arenaHighWater = _arena.used();
+    if(_server->_onArenaStats){
+      _server->_onArenaStats(this, _handler, _arena.used());
+    }
+  }
 
-  _interestingHeaders.free();
+  //headers, parameters and path parameters go with _arena, in one step
 
   if(_response != NULL){
     delete _response;
@@ -96,32 +189,39 @@ AsyncWebServerRequest::~AsyncWebServerRequest(){
   if(_tempFile){
     _tempFile.close();
   }
+
+  //a pipelined request never got its turn
+  if(_next != NULL){
+    delete _next;
+  }
+  free(_pipelined);
 }
 
 void AsyncWebServerRequest::_onData(void *buf, size_t len){
   size_t i = 0;
   while (true) {
 
-  if(_parseState < PARSE_REQ_BODY){
-    // Find new line in buf
-    char *str = (char*)buf;
-    for (i = 0; i < len; i++) {
-      if (str[i] == '\n') {
-        break;
+  if(_parseState == PARSE_REQ_END){
+    //anything after a complete request belongs to the next one
+    if(len){
+      _onPipelined((uint8_t*)buf, len);
+      if(_active){
+        _handOver();
       }
     }
-    if (i == len) { // No new line, just add the buffer in _temp
-      char ch = str[len-1];
-      str[len-1] = 0;
-      _temp.reserve(_temp.length()+len);
-      _temp.concat(str);
-      _temp.concat(ch);
-    } else { // Found new line - extract it and parse
-      str[i] = 0; // Terminate the string at the end of the line.
-      _temp.concat(str);
-      _temp.trim();
+    return;
+  } else if(_parseState < PARSE_REQ_BODY){
+    // Find new line in buf, the line up to it goes to the arena in one copy
+    char *str = (char*)buf;
+    char *newLine = (char*)memchr(str, '\n', len);
+    i = (newLine != NULL) ? (newLine - str) + 1 : len;
+    if(!_appendLine(str, i)){
+      _parseFailed();
+      return;
+    }
+    if(newLine != NULL){
       _parseLine();
-      if (++i < len) {
+      if (i < len) {
         // Still have more buffer to process
         buf = str+i;
         len-= i;
@@ -132,6 +232,11 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
     // A handler should be already attached at this point in _parseLine function.
     // If handler does nothing (_onRequest is NULL), we don't need to really parse the body.
     const bool needParse = _handler && !_handler->isRequestHandlerTrivial();
+    // The body ends at Content-Length, a pipelined request may follow in the same buffer
+    const size_t total = len;
+    if(len > _contentLength - _parsedLength){
+      len = _contentLength - _parsedLength;
+    }
     if(_isMultipart){
       if(needParse){
         size_t i;
@@ -169,36 +274,175 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
     }
     if(_parsedLength == _contentLength){
       _parseState = PARSE_REQ_END;
-      //check if authenticated before calling handleRequest and request auth instead
-      if(_handler) _handler->handleRequest(this);
-      else send(501);
+      _runHandler();
+      if(total > len){
+        _onPipelined((uint8_t*)buf + len, total - len);
+        if(_active){
+          _handOver();
+        }
+      }
+      return;
     }
   }
   break;
   }
 }
 
+//Bytes that arrive after this request is complete. They are parsed right away
+//into _next, so a pipelined request is ready by the time this response is out.
+void AsyncWebServerRequest::_onPipelined(uint8_t *buf, size_t len){
+  if(!_keepAlive){
+    return;
+  }
+  if(_next != NULL){
+    _next->_onData(buf, len);
+    return;
+  }
+  if(_active){
+    _next = new AsyncWebServerRequest(_server, _client, this);
+    if(_next != NULL){
+      _next->_onData(buf, len);
+      return;
+    }
+  } else if(_pipelinedLength + len <= ASYNCWEBSERVER_PIPELINE_BUFFER){
+    //this request is parsed ahead itself, the bytes wait until it is answered
+    uint8_t *pipelined = (uint8_t*)realloc(_pipelined, _pipelinedLength + len);
+    if(pipelined != NULL){
+      memcpy(pipelined + _pipelinedLength, buf, len);
+      _pipelined = pipelined;
+      _pipelinedLength += len;
+      return;
+    }
+  }
+  //No room for more. The bytes are dropped and this response says Connection: close,
+  //so the client sends them again on a new connection. Closing right here would
+  //delete the requests further up the stack, _onAck() closes once it is out.
+  _keepAlive = false;
+}
+
+void AsyncWebServerRequest::_runHandler(){
+  if(!_active){
+    //answered from _activate() once the request before it is out
+    return;
+  }
+  //check if authenticated before calling handleRequest and request auth instead
+  if(_handler) _handler->handleRequest(this);
+  else send(501);
+}
+
+//Called on the request that owns the connection. Once its response is written
+//the next request takes over the client and this one is deleted. Pipelined
+//requests that are answered right away are handed over in turn, in a loop so
+//a burst of them does not nest on the stack.
+void AsyncWebServerRequest::_handOver(){
+  AsyncWebServerRequest *request = this;
+  while(request->_keepAlive && request->_response != NULL && request->_response->_sent() && !request->_response->_failed()){
+    AsyncWebServerRequest *next = request->_next;
+    request->_next = NULL;
+    if(next == NULL){
+      next = new AsyncWebServerRequest(request->_server, request->_client, request);
+      if(next == NULL){
+        //no room for another request, the client closes once it has the response
+        request->_keepAlive = false;
+        return;
+      }
+    }
+    next->_ackDebt = request->_ackDebt + request->_response->_unacked();
+    delete request;
+    request = next;
+    request->_activate();
+  }
+}
+
+void AsyncWebServerRequest::_activate(){
+  _active = true;
+  _attach();
+  if(_parseState == PARSE_REQ_FAIL){
+    send(400);
+    return;
+  }
+  if(_parseState == PARSE_REQ_END){
+    //parsed while the previous response went out
+    _runHandler();
+    if(_pipelined != NULL){
+      uint8_t *pipelined = _pipelined;
+      size_t pipelinedLength = _pipelinedLength;
+      _pipelined = NULL;
+      _pipelinedLength = 0;
+      _onPipelined(pipelined, pipelinedLength);
+      free(pipelined);
+    }
+    return;
+  }
+  if(_expectingContinue && _parseState == PARSE_REQ_BODY){
+    const char * response = "HTTP/1.1 100 Continue\r\n\r\n";
+    _client->write(response, os_strlen(response));
+  }
+  //idle until the next request shows up
+  _client->setRxTimeout(_server->_keepAliveTimeout);
+}
+
 void AsyncWebServerRequest::_removeNotInterestingHeaders(){
-  if (_interestingHeaders.containsIgnoreCase("ANY")) return; // nothing to do
-  for(const auto& header: _headers){
-      if(!_interestingHeaders.containsIgnoreCase(header->name().c_str())){
-        _headers.remove(header);
+  for(const auto& name: _interestingHeaders){
+    if(!strcasecmp(name, "ANY")) return; // nothing to do
+  }
+  HeaderSlice *previous = NULL;
+  HeaderSlice *slice = _headers;
+  while(slice != NULL){
+    HeaderSlice *next = slice->next;
+    bool interesting = false;
+    for(const auto& name: _interestingHeaders){
+      if(_sliceEqualsIgnoreCase(slice->name, slice->nameLength, name)){
+        interesting = true;
+        break;
+      }
+    }
+    if(interesting){
+      previous = slice;
+    } else {
+      //unlinked, the slice itself goes with the arena
+      if(previous != NULL){
+        previous->next = next;
+      } else {
+        _headers = next;
       }
+      _headerCount--;
+    }
+    slice = next;
   }
+  _lastHeader = previous;
 }
 
 void AsyncWebServerRequest::_onPoll(){
   //os_printf("p\n");
   if(_response != NULL && _client != NULL && _client->canSend() && !_response->_finished()){
+    const bool keepAlive = _keepAlive;
     _response->_ack(this, 0, 0);
+    if(keepAlive){
+      _handOver();
+    }
   }
 }
 
 void AsyncWebServerRequest::_onAck(size_t len, uint32_t time){
   //os_printf("a:%u:%u\n", len, time);
+  //acks for the tail of the previous response on this connection come first
+  const size_t owed = (len < _ackDebt) ? len : _ackDebt;
+  _ackDebt -= owed;
+  len -= owed;
   if(_response != NULL){
     if(!_response->_finished()){
+      //WebSocket and event source responses can delete the request in _ack(),
+      //they are neither kept alive nor delimited so nothing is touched after it for them
+      const bool keepAlive = _keepAlive;
+      const bool closing = !keepAlive && _response->_delimited(_version);
       _response->_ack(this, len, time);
+      if(keepAlive){
+        _handOver();
+      } else if(closing && _response->_finished()){
+        //the response said Connection: close and the client has all of it
+        _client->close();
+      }
     } else {
       AsyncWebServerResponse* r = _response;
       _response = NULL;
@@ -229,126 +473,171 @@ void AsyncWebServerRequest::_onDisconnect(){
   _server->_handleDisconnect(this);
 }
 
-void AsyncWebServerRequest::_addParam(AsyncWebParameter *p){
-  _params.add(p);
+void AsyncWebServerRequest::_addParam(String name, String value, bool form, bool file, size_t size){
+  AsyncWebParameter *p = _arena.make<AsyncWebParameter>(std::move(name), std::move(value), form, file, size);
+  if(p != NULL){
+    _params.add(_arena, p);
+  }
+}
+
+void AsyncWebServerRequest::_addPathParam(const char *p, size_t len){
+  PathSlice *slice = (PathSlice*)_arena.alloc(sizeof(PathSlice));
+  if(slice != NULL){
+    slice->offset = p - _url.c_str();
+    slice->length = len;
+    slice->value = NULL;
+    _pathParams.add(_arena, slice);
+  }
 }
 
-void AsyncWebServerRequest::_addPathParam(const char *p){
-  _pathParams.add(new String(p));
+void AsyncWebServerRequest::_addGetParams(const char *params, size_t len){
+  const char *end = params + len;
+  while (params < end){
+    const char *next = (const char*)memchr(params, '&', end - params);
+    if (next == NULL) next = end;
+    const char *equal = (const char*)memchr(params, '=', next - params);
+    if (equal == NULL) equal = next;
+    String name = _urlDecode(params, equal - params);
+    String value = equal + 1 < next ? _urlDecode(equal + 1, next - equal - 1) : String();
+    _addParam(std::move(name), std::move(value));
+    if (next == end) break;
+    params = next + 1;
+  }
 }
 
-void AsyncWebServerRequest::_addGetParams(const String& params){
-  size_t start = 0;
-  while (start < params.length()){
-    int end = params.indexOf('&', start);
-    if (end < 0) end = params.length();
-    int equal = params.indexOf('=', start);
-    if (equal < 0 || equal > end) equal = end;
-    String name = params.substring(start, equal);
-    String value = equal + 1 < end ? params.substring(equal + 1, end) : String();
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value)));
-    start = end + 1;
+//Adds to the head line being received. The line stays where it is in _arena
+//once parsed, so the header slices taken from it remain valid.
+bool AsyncWebServerRequest::_appendLine(const char *data, size_t len){
+  if(_headLength + len > ASYNCWEBSERVER_MAX_HEAD_LENGTH){
+    return false;
+  }
+  //one byte more for the terminator
+  char *line = (char*)_arena.grow(_line, _line ? _lineLength + 1 : 0, _line ? len : len + 1);
+  if(line == NULL){
+    return false;
   }
+  memcpy(line + _lineLength, data, len);
+  _line = line;
+  _lineLength += len;
+  _line[_lineLength] = 0;
+  _headLength += len;
+  return true;
 }
 
-bool AsyncWebServerRequest::_parseReqHead(){
+bool AsyncWebServerRequest::_parseReqHead(const char *line, size_t len){
   // Split the head into method, url and version
-  int index = _temp.indexOf(' ');
-  String m = _temp.substring(0, index);
-  index = _temp.indexOf(' ', index+1);
-  String u = _temp.substring(m.length()+1, index);
-  _temp = _temp.substring(index+1);
+  const char *end = line + len;
+  const char *url = (const char*)memchr(line, ' ', len);
+  if(url == NULL){
+    return false;
+  }
+  const size_t methodLength = url++ - line;
+  const char *version = (const char*)memchr(url, ' ', end - url);
+  if(version == NULL){
+    return false;
+  }
+  size_t urlLength = version++ - url;
 
-  if(m == "GET"){
+  if(_sliceEquals(line, methodLength, "GET")){
     _method = HTTP_GET;
-  } else if(m == "POST"){
+  } else if(_sliceEquals(line, methodLength, "POST")){
     _method = HTTP_POST;
-  } else if(m == "DELETE"){
+  } else if(_sliceEquals(line, methodLength, "DELETE")){
     _method = HTTP_DELETE;
-  } else if(m == "PUT"){
+  } else if(_sliceEquals(line, methodLength, "PUT")){
     _method = HTTP_PUT;
-  } else if(m == "PATCH"){
+  } else if(_sliceEquals(line, methodLength, "PATCH")){
     _method = HTTP_PATCH;
-  } else if(m == "HEAD"){
+  } else if(_sliceEquals(line, methodLength, "HEAD")){
     _method = HTTP_HEAD;
-  } else if(m == "OPTIONS"){
+  } else if(_sliceEquals(line, methodLength, "OPTIONS")){
     _method = HTTP_OPTIONS;
   }
 
-  String g = String();
-  index = u.indexOf('?');
-  if(index > 0){
-    g = u.substring(index +1);
-    u = u.substring(0, index);
+  const char *query = (const char*)memchr(url, '?', urlLength);
+  if(query != NULL && query > url){
+    _addGetParams(query + 1, url + urlLength - query - 1);
+    urlLength = query - url;
   }
-  _url = urlDecode(u);
-  _addGetParams(g);
+  _url = _urlDecode(url, urlLength);
 
-  if(!_temp.startsWith("HTTP/1.0"))
+  if(end - version < 8 || memcmp(version, "HTTP/1.0", 8))
     _version = 1;
-
-  _temp = String();
+  _keepAlive = _version;
   return true;
 }
 
-bool strContains(String src, String find, bool mindcase = true) {
-  int pos=0, i=0;
-  const int slen = src.length();
-  const int flen = find.length();
-
-  if (slen < flen) return false;
-  while (pos <= (slen - flen)) {
-    for (i=0; i < flen; i++) {
-      if (mindcase) {
-        if (src[pos+i] != find[i]) i = flen + 1; // no match
-      } else if (tolower(src[pos+i]) != tolower(find[i])) i = flen + 1; // no match
-    }
-    if (i == flen) return true;
-    pos++;
+void AsyncWebServerRequest::_parseReqHeader(char *line, size_t len){
+  char *colon = (char*)memchr(line, ':', len);
+  if(colon == NULL || colon == line){
+    return;
   }
-  return false;
-}
-
-bool AsyncWebServerRequest::_parseReqHeader(){
-  int index = _temp.indexOf(':');
-  if(index){
-    String name = _temp.substring(0, index);
-    String value = _temp.substring(index + 2);
-    if(name.equalsIgnoreCase("Host")){
-      _host = value;
-    } else if(name.equalsIgnoreCase("Content-Type")){
-	  _contentType = value.substring(0, value.indexOf(';'));
-      if (value.startsWith("multipart/")){
-        _boundary = value.substring(value.indexOf('=')+1);
-        _boundary.replace("\"","");
-        _isMultipart = true;
-      }
-    } else if(name.equalsIgnoreCase("Content-Length")){
-      _contentLength = atoi(value.c_str());
-    } else if(name.equalsIgnoreCase("Expect") && value == "100-continue"){
-      _expectingContinue = true;
-    } else if(name.equalsIgnoreCase("Authorization")){
-      if(value.length() > 5 && value.substring(0,5).equalsIgnoreCase("Basic")){
-        _authorization = value.substring(6);
-      } else if(value.length() > 6 && value.substring(0,6).equalsIgnoreCase("Digest")){
-        _isDigest = true;
-        _authorization = value.substring(7);
-      }
+  const char *name = line;
+  const size_t nameLength = colon - line;
+  const char *value = colon + 1;
+  while(*value == ' ' || *value == '\t'){
+    value++;
+  }
+  const size_t valueLength = line + len - value;
+
+  if(_sliceEqualsIgnoreCase(name, nameLength, "Host")){
+    _host = _sliceToString(value, valueLength);
+  } else if(_sliceEqualsIgnoreCase(name, nameLength, "Content-Type")){
+    const char *parameters = (const char*)memchr(value, ';', valueLength);
+    _contentType = _sliceToString(value, parameters ? parameters - value : valueLength);
+    if (valueLength > 10 && !memcmp(value, "multipart/", 10)){
+      const char *boundary = (const char*)memchr(value, '=', valueLength);
+      boundary = boundary ? boundary + 1 : value;
+      _boundary = _sliceToString(boundary, value + valueLength - boundary);
+      _boundary.replace("\"","");
+      _isMultipart = true;
+    }
+  } else if(_sliceEqualsIgnoreCase(name, nameLength, "Content-Length")){
+    _contentLength = atoi(value);
+  } else if(_sliceEqualsIgnoreCase(name, nameLength, "Connection")){
+    if(_sliceContainsIgnoreCase(value, valueLength, "close")){
+      _keepAlive = false;
+    } else if(_sliceContainsIgnoreCase(value, valueLength, "keep-alive")){
+      _keepAlive = true;
+    }
+  } else if(_sliceEqualsIgnoreCase(name, nameLength, "Expect") && _sliceEquals(value, valueLength, "100-continue")){
+    _expectingContinue = true;
+  } else if(_sliceEqualsIgnoreCase(name, nameLength, "Authorization")){
+    if(valueLength > 5 && !strncasecmp(value, "Basic", 5)){
+      _authorization = _sliceToString(value + 6, valueLength - 6);
+    } else if(valueLength > 6 && !strncasecmp(value, "Digest", 6)){
+      _isDigest = true;
+      _authorization = _sliceToString(value + 7, valueLength - 7);
+    }
+  } else {
+    if(_sliceEqualsIgnoreCase(name, nameLength, "Upgrade") && _sliceEqualsIgnoreCase(value, valueLength, "websocket")){
+      // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
+      _reqconntype = RCT_WS;
     } else {
-      if(name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket")){
-        // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
-        _reqconntype = RCT_WS;
-      } else {
-        if(name.equalsIgnoreCase("Accept") && strContains(value, "text/event-stream", false)){
-          // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
-          _reqconntype = RCT_EVENT;
-        }
+      if(_sliceEqualsIgnoreCase(name, nameLength, "Accept") && _sliceContainsIgnoreCase(value, valueLength, "text/event-stream")){
+        // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
+        _reqconntype = RCT_EVENT;
       }
     }
-    _headers.add(new AsyncWebHeader(name, value));
   }
-  _temp = String();
-  return true;
+
+  HeaderSlice *slice = (HeaderSlice*)_arena.alloc(sizeof(HeaderSlice));
+  if(slice == NULL){
+    return;
+  }
+  slice->name = name;
+  slice->nameLength = nameLength;
+  slice->value = value;
+  slice->valueLength = valueLength;
+  slice->header = NULL;
+  slice->next = NULL;
+  if(_lastHeader != NULL){
+    _lastHeader->next = slice;
+  } else {
+    _headers = slice;
+  }
+  _lastHeader = slice;
+  _headerCount++;
 }
 
 void AsyncWebServerRequest::_parsePlainPostChar(uint8_t data){
@@ -361,7 +650,7 @@ void AsyncWebServerRequest::_parsePlainPostChar(uint8_t data){
       name = _temp.substring(0, _temp.indexOf('='));
       value = _temp.substring(_temp.indexOf('=') + 1);
     }
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value), true));
+    _addParam(urlDecode(name), urlDecode(value), true);
     _temp = String();
   }
 }
@@ -508,13 +797,13 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last){
     } else if(_boundaryPosition == _boundary.length() - 1){
       _multiParseState = DASH3_OR_RETURN2;
       if(!_itemIsFile){
-        _addParam(new AsyncWebParameter(_itemName, _itemValue, true));
+        _addParam(_itemName, _itemValue, true);
       } else {
         if(_itemSize){
           //check if authenticated before calling the upload
           if(_handler) _handler->handleUpload(this, _itemFilename, _itemSize - _itemBufferIndex, _itemBuffer, _itemBufferIndex, true);
           _itemBufferIndex = 0;
-          _addParam(new AsyncWebParameter(_itemName, _itemFilename, true, true, _itemSize));
+          _addParam(_itemName, _itemFilename, true, true, _itemSize);
         }
         free(_itemBuffer);
         _itemBuffer = NULL;
@@ -552,24 +841,45 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last){
 }
 
 void AsyncWebServerRequest::_parseLine(){
+  //the next line starts after this one in the arena
+  char *line = _line;
+  size_t len = _lineLength;
+  _line = NULL;
+  _lineLength = 0;
+  while(len && isspace(line[len - 1])){
+    len--;
+  }
+  while(len && isspace(*line)){
+    line++;
+    len--;
+  }
+  line[len] = 0;
+
   if(_parseState == PARSE_REQ_START){
-    if(!_temp.length()){
-      _parseState = PARSE_REQ_FAIL;
-      _client->close();
-    } else {
-      _parseReqHead();
+    if(!len){
+      //empty lines before the request line are skipped, such as the CRLF
+      //some clients send after the body of the previous request
+      return;
+    }
+    if(_parseReqHead(line, len)){
       _parseState = PARSE_REQ_HEADERS;
+    } else {
+      _parseFailed();
     }
     return;
   }
 
   if(_parseState == PARSE_REQ_HEADERS){
-    if(!_temp.length()){
+    if(!len){
       //end of headers
       _server->_rewriteRequest(this);
       _server->_attachHandler(this);
       _removeNotInterestingHeaders();
-      if(_expectingContinue){
+      //HTTP/1.1 keeps the connection unless asked not to, HTTP/1.0 only when asked to
+      _keepAlive = _keepAlive && _reqconntype == RCT_HTTP && _server->_keepAliveTimeout
+        && (!_server->_keepAliveMax || _requestCount < _server->_keepAliveMax);
+      //a pipelined request sends 100-continue once it is its turn, see _activate()
+      if(_expectingContinue && _active){
         const char * response = "HTTP/1.1 100 Continue\r\n\r\n";
         _client->write(response, os_strlen(response));
       }
@@ -578,24 +888,44 @@ void AsyncWebServerRequest::_parseLine(){
         _parseState = PARSE_REQ_BODY;
       } else {
         _parseState = PARSE_REQ_END;
-        if(_handler) _handler->handleRequest(this);
-        else send(501);
+        _runHandler();
       }
-    } else _parseReqHeader();
+    } else _parseReqHeader(line, len);
   }
 }
 
-size_t AsyncWebServerRequest::headers() const{
-  return _headers.length();
+//A head that does not parse or does not fit. Nothing more is read from the
+//connection, it gets 400 and is closed once that is out.
+void AsyncWebServerRequest::_parseFailed(){
+  _parseState = PARSE_REQ_FAIL;
+  _keepAlive = false;
+  if(_active){
+    send(400);
+  }
 }
 
-bool AsyncWebServerRequest::hasHeader(const String& name) const {
-  for(const auto& h: _headers){
-    if(h->name().equalsIgnoreCase(name)){
-      return true;
+AsyncWebServerRequest::HeaderSlice* AsyncWebServerRequest::_findHeader(const char *name, size_t len) const {
+  for(HeaderSlice *slice = _headers; slice != NULL; slice = slice->next){
+    if(slice->nameLength == len && !strncasecmp(slice->name, name, len)){
+      return slice;
     }
   }
-  return false;
+  return NULL;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::_headerAt(HeaderSlice *slice) const {
+  if(slice->header == NULL){
+    slice->header = _arena.make<AsyncWebHeader>(_sliceToString(slice->name, slice->nameLength), _sliceToString(slice->value, slice->valueLength));
+  }
+  return slice->header;
+}
+
+size_t AsyncWebServerRequest::headers() const{
+  return _headerCount;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String& name) const {
+  return _findHeader(name.c_str(), name.length()) != NULL;
 }
 
 bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper * data) const {
@@ -619,12 +949,8 @@ bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper * data) const {
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const {
-  for(const auto& h: _headers){
-    if(h->name().equalsIgnoreCase(name)){
-      return h;
-    }
-  }
-  return nullptr;
+  HeaderSlice *slice = _findHeader(name.c_str(), name.length());
+  return slice ? _headerAt(slice) : nullptr;
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(const __FlashStringHelper * data) const {
@@ -642,8 +968,11 @@ AsyncWebHeader* AsyncWebServerRequest::getHeader(const __FlashStringHelper * dat
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const {
-  auto header = _headers.nth(num);
-  return header ? *header : nullptr;
+  HeaderSlice *slice = _headers;
+  while(slice != NULL && num--){
+    slice = slice->next;
+  }
+  return slice ? _headerAt(slice) : nullptr;
 }
 
 size_t AsyncWebServerRequest::params() const {
@@ -704,8 +1033,15 @@ AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const {
 }
 
 void AsyncWebServerRequest::addInterestingHeader(const String& name){
-  if(!_interestingHeaders.containsIgnoreCase(name))
-    _interestingHeaders.add(name);
+  for(const auto& interesting: _interestingHeaders){
+    if(!strcasecmp(name.c_str(), interesting)){
+      return;
+    }
+  }
+  const char *copy = _arena.copy(name.c_str(), name.length());
+  if(copy != NULL){
+    _interestingHeaders.add(_arena, copy);
+  }
 }
 
 void AsyncWebServerRequest::send(AsyncWebServerResponse *response){
@@ -721,6 +1057,10 @@ void AsyncWebServerRequest::send(AsyncWebServerResponse *response){
     send(500);
   }
   else {
+    //a body that only ends with the stream ends the connection too
+    if(_keepAlive && !_response->_delimited(_version)){
+      _keepAlive = false;
+    }
     _client->setRxTimeout(0);
     _response->_respond(this);
   }
@@ -768,6 +1108,23 @@ AsyncWebServerResponse * AsyncWebServerRequest::beginResponse_P(int code, const
   return beginResponse_P(code, contentType, (const uint8_t *)content, strlen_P(content), callback);
 }
 
+AsyncWebServerResponse * AsyncWebServerRequest::beginFlashResponse(int code, const String& contentType, const uint8_t * content, size_t len){
+#if defined(ESP32)
+  return new AsyncFlashResponse(code, contentType, content, len);
+#else
+  //LwIP cannot read flash directly there, it is copied out as before
+  return new AsyncProgmemResponse(code, contentType, content, len);
+#endif
+}
+
+AsyncWebServerResponse * AsyncWebServerRequest::beginFlashResponse(int code, const String& contentType, PGM_P content){
+  return beginFlashResponse(code, contentType, (const uint8_t *)content, strlen_P(content));
+}
+
+AsyncWebServerResponse * AsyncWebServerRequest::beginTemplateResponse(int code, const String& contentType, const AsyncWebTemplate& content, AwsTemplateWriter writer){
+  return new AsyncTemplateResponse(code, contentType, content, writer);
+}
+
 void AsyncWebServerRequest::send(int code, const String& contentType, const String& content){
   send(beginResponse(code, contentType, content));
 }
@@ -804,6 +1161,18 @@ void AsyncWebServerRequest::send_P(int code, const String& contentType, PGM_P co
   send(beginResponse_P(code, contentType, content, callback));
 }
 
+void AsyncWebServerRequest::sendFlash(int code, const String& contentType, const uint8_t * content, size_t len){
+  send(beginFlashResponse(code, contentType, content, len));
+}
+
+void AsyncWebServerRequest::sendFlash(int code, const String& contentType, PGM_P content){
+  send(beginFlashResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::sendTemplate(int code, const String& contentType, const AsyncWebTemplate& content, AwsTemplateWriter writer){
+  send(beginTemplateResponse(code, contentType, content, writer));
+}
+
 void AsyncWebServerRequest::redirect(const String& url){
   AsyncWebServerResponse * response = beginResponse(302);
   response->addHeader("Location",url);
@@ -917,14 +1286,35 @@ const String& AsyncWebServerRequest::argName(size_t i) const {
   return getParam(i)->name();
 }
 
+size_t AsyncWebServerRequest::pathArgs() const {
+  return _pathParams.length();
+}
+
 const String& AsyncWebServerRequest::pathArg(size_t i) const {
   auto param = _pathParams.nth(i);
-  return param ? **param : SharedEmptyString;
+  if(param == nullptr){
+    return SharedEmptyString;
+  }
+  PathSlice *slice = *param;
+  if(slice->value == NULL){
+    slice->value = _arena.make<String>(_sliceToString(_url.c_str() + slice->offset, slice->length));
+  }
+  return slice->value ? *slice->value : SharedEmptyString;
+}
+
+const char* AsyncWebServerRequest::pathArg(size_t i, size_t *len) const {
+  auto param = _pathParams.nth(i);
+  if(param == nullptr){
+    *len = 0;
+    return NULL;
+  }
+  *len = (*param)->length;
+  return _url.c_str() + (*param)->offset;
 }
 
 const String& AsyncWebServerRequest::header(const char* name) const {
-  AsyncWebHeader* h = getHeader(String(name));
-  return h ? h->value() : SharedEmptyString;
+  HeaderSlice *slice = _findHeader(name, strlen(name));
+  return slice ? _headerAt(slice)->value() : SharedEmptyString;
 }
 
 const String& AsyncWebServerRequest::header(const __FlashStringHelper * data) const {
@@ -953,26 +1343,7 @@ const String& AsyncWebServerRequest::headerName(size_t i) const {
 }
 
 String AsyncWebServerRequest::urlDecode(const String& text) const {
-  char temp[] = "0x00";
-  unsigned int len = text.length();
-  unsigned int i = 0;
-  String decoded = String();
-  decoded.reserve(len); // Allocate the string internal buffer - never longer from source text
-  while (i < len){
-    char decodedChar;
-    char encodedChar = text.charAt(i++);
-    if ((encodedChar == '%') && (i + 1 < len)){
-      temp[2] = text.charAt(i++);
-      temp[3] = text.charAt(i++);
-      decodedChar = strtol(temp, NULL, 16);
-    } else if (encodedChar == '+') {
-      decodedChar = ' ';
-    } else {
-      decodedChar = encodedChar;  // normal ascii char
-    }
-    decoded.concat(decodedChar);
-  }
-  return decoded;
+  return _urlDecode(text.c_str(), text.length());
 }
 
 
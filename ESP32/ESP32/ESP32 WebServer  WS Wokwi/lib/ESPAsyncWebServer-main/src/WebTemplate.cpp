@@ -0,0 +1,122 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "ESPAsyncWebServer.h"
+#include "WebTemplate.h"
+
+static bool _isNameChar(uint8_t c){
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+AsyncWebTemplate::AsyncWebTemplate(const uint8_t* content, size_t len)
+  : _content(content)
+  , _length(len)
+  , _segments(NULL)
+  , _count(0)
+  , _names(NULL)
+{
+  //counts first, then fills what it counted
+  size_t namesLength = 0;
+  size_t count = _scan(NULL, NULL, &namesLength);
+  Segment* segments = new Segment[count ? count : 1];
+  char* names = namesLength ? new char[namesLength] : NULL;
+  if(segments == NULL || (namesLength && names == NULL)){
+    delete[] segments;
+    delete[] names;
+    return;
+  }
+  _count = _scan(segments, names, &namesLength);
+  _segments = segments;
+  _names = names;
+}
+
+AsyncWebTemplate::AsyncWebTemplate(PGM_P content)
+  : AsyncWebTemplate((const uint8_t*)content, strlen_P(content))
+{}
+
+AsyncWebTemplate::~AsyncWebTemplate(){
+  delete[] _segments;
+  delete[] _names;
+}
+
+size_t AsyncWebTemplate::placeholders() const {
+  size_t n = 0;
+  for(size_t i = 0; i < _count; i++){
+    if(_segments[i].name != NULL){
+      n++;
+    }
+  }
+  return n;
+}
+
+//Splits the content into text and placeholders, into segments and names when
+//they are given, and returns how many segments there are
+size_t AsyncWebTemplate::_scan(Segment* segments, char* names, size_t* namesLength) const {
+  size_t count = 0;
+  size_t nameBytes = 0;
+  size_t text = 0;
+  size_t pos = 0;
+  auto addText = [&](size_t end){
+    if(end > text){
+      if(segments != NULL){
+        segments[count].offset = text;
+        segments[count].length = end - text;
+        segments[count].name = NULL;
+      }
+      count++;
+    }
+  };
+  while(pos < _length){
+    if(pgm_read_byte(_content + pos) != TEMPLATE_PLACEHOLDER){
+      pos++;
+      continue;
+    }
+    size_t start = pos++;
+    if(pos < _length && pgm_read_byte(_content + pos) == TEMPLATE_PLACEHOLDER){
+      //%% is text up to the first one
+      addText(start + 1);
+      text = ++pos;
+      continue;
+    }
+    while(pos < _length && pos - start - 1 < TEMPLATE_PARAM_NAME_LENGTH && _isNameChar(pgm_read_byte(_content + pos))){
+      pos++;
+    }
+    size_t nameLength = pos - start - 1;
+    if(!nameLength || pos == _length || pgm_read_byte(_content + pos) != TEMPLATE_PLACEHOLDER){
+      //a lone '%', the text goes on from the character after it
+      pos = start + 1;
+      continue;
+    }
+    addText(start);
+    if(segments != NULL){
+      memcpy_P(names + nameBytes, _content + start + 1, nameLength);
+      names[nameBytes + nameLength] = 0;
+      segments[count].offset = start;
+      segments[count].length = 0;
+      segments[count].name = names + nameBytes;
+    }
+    nameBytes += nameLength + 1;
+    count++;
+    text = ++pos;
+  }
+  addText(_length);
+  *namesLength = nameBytes;
+  return count;
+}
@@ -24,9 +24,22 @@ LiquidCrystal_I2C lcd(0x27, 16, 4);
 AsyncWebServer server(80);  // Changed to match test.cpp approach
 AsyncWebSocket ws("/ws"); // WebSocket server instance
 Servo myservo;
+float temperature = 0;
+float humidity = 0;
 
 SemaphoreHandle_t xMutex = NULL;
 
+// What /sensors answers, written as JSON straight into the response
+struct SensorSnapshot {
+    float temperature;
+    float humidity;
+};
+
+const AsyncJsonField SENSOR_SNAPSHOT_JSON[] = {
+    ASYNC_JSON_FLOAT(SensorSnapshot, temperature, 1),
+    ASYNC_JSON_FLOAT(SensorSnapshot, humidity, 1)
+};
+
 
 
 
@@ -104,7 +117,7 @@ void TaskWebSocket(void *pvParameters) {
                 // Only send if data changed
                 String currentJson = String(json);
                 if (lastJson != currentJson) {
-                 //   webSocket.broadcastTXT(currentJson);
+                    ws.textLatestAll(WS_TOPIC_SENSORS, currentJson);
                     lastJson = currentJson;
                     Serial.println("WS Sent: " + currentJson); // Debug output
                 }
@@ -137,8 +150,9 @@ void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
         case WS_EVT_DATA:
             {
                 Serial.printf("Received data from client #%u\n", client->id());
-                String message = String((char*)payload);
-                if(message == "getData") {
+                // A whole message, see ws.wholeMessages() below; the payload is not terminated
+                AwsFrameInfo *info = (AwsFrameInfo *)arg;
+                if(info->opcode == WS_TEXT && length == 7 && memcmp(payload, "getData", 7) == 0) {
                     char json[128];
                     snprintf(json, sizeof(json), 
                         "{\"temperature\":%.1f,\"humidity\":%.1f,\"timestamp\":%lu}",
@@ -206,10 +220,8 @@ void setup() {
     Serial.println("WebSocket server started (ws://localhost:8181)");  // WebSocket localhost link
 
     // Update server setup
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        request->send(200, "text/html", createHtml());
-        Serial.println("Web page requested");
-    });
+    // Gzipped page from flash, browsers that have it get a 304 instead
+    server.serveAsset("/", INDEX_HTML_TYPE, index_html_gz, sizeof(index_html_gz), INDEX_HTML_ETAG);
     
     // Initialize servo
     myservo.attach(SERVO_PIN);
@@ -233,12 +245,12 @@ void setup() {
 
     // Add DHT sensors endpoint for AJAX updates      ==========================================
     server.on("/sensors", HTTP_GET, [](AsyncWebServerRequest *request){
-        String json = "{\"temperature\":" + String(temperature, 1) + 
-                     ",\"humidity\":" + String(humidity, 1) + "}";
-        request->send(200, "application/json", json);
+        SensorSnapshot snapshot = { temperature, humidity };
+        request->sendJson(200, snapshot, SENSOR_SNAPSHOT_JSON);
     });
 
     // WebSocket setup
+    ws.wholeMessages(1024);
     ws.onEvent(onWebSocketEvent);
     server.addHandler(&ws);
 
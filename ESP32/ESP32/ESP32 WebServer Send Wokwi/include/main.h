@@ -9,7 +9,7 @@
 #include <DHT.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "web.h"
+#include "web_assets.h"  // generated from web/ by scripts/web_assets.py
 
 // Constants
 #define WIFI_SSID "Wokwi-GUEST"
@@ -27,4 +27,3 @@ extern AsyncEventSource events;
 void WiFiTask(void *parameter);
 void ServerTask(void *parameter);
 void SensorTask(void *parameter);
-String getHTML();
@@ -0,0 +1,177 @@
+/*
+  Host benchmark: connection churn against long-lived connections
+
+  An AsyncServer on the loopback answers 1000 short-lived connections
+  (browsers polling /sensors with "Connection: close") while a number of
+  long-lived WebSocket/SSE-like connections keep echoing. Every cycle each
+  long-lived connection gets a byte in flight, then one short connection
+  sends its request and the server closes it once the answer is acked, the
+  way AsyncWebServerRequest does, before the echoes have been handled.
+
+  The close is AsyncClient::close(true): _close() -> _tcp_clear_events(),
+  which marks the event owner of the connection dead, and _tcp_close().
+  Its time is taken around the call, on the thread that runs the callbacks.
+  Whatever was still due for a closed connection (a poll, an error) is
+  dropped when it comes up and counted in stale_discarded.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -I../host/include -I../src churn_bench.cpp ../src/AsyncTCPClient.cpp ../host/src/*.cpp -o churn_bench -lpthread
+//  ./churn_bench [cycles] [background_connections] [port]
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+static const char SHORT_REQUEST = 'S';
+static const char BACKGROUND_PING = 'B';
+static const char RESPONSE[] = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\n{}";
+
+static double close_us = 0;        //total time spent in close
+static double worst_close_us = 0;  //longest single close
+static uint32_t closed = 0;
+static std::atomic<uint32_t> disconnected(0);
+
+static double now_us(){
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//the client may not be deleted from inside its data callback, it is closed once acked
+static void onAck(void * arg, AsyncClient * c, size_t len, uint32_t time){
+    (void)arg;
+    (void)time;
+    if(!len){
+        return;
+    }
+    double start = now_us();
+    c->close(true);
+    double took = now_us() - start;
+    close_us += took;
+    if(took > worst_close_us){
+        worst_close_us = took;
+    }
+    closed++;
+}
+
+static void onData(void * arg, AsyncClient * c, void * data, size_t len){
+    (void)arg;
+    const char * in = (const char *)data;
+    if(in[0] == BACKGROUND_PING){
+        c->write(in, len);
+        return;
+    }
+    c->onAck(onAck, NULL);
+    c->write(RESPONSE, sizeof(RESPONSE) - 1);
+}
+
+static void onClient(void * arg, AsyncClient * c){
+    (void)arg;
+    c->setNoDelay(true);
+    c->onData(onData, NULL);
+    c->onDisconnect([](void * arg, AsyncClient * c){
+        (void)arg;
+        disconnected++;
+        delete c;
+    }, NULL);
+}
+
+static int connectTo(uint16_t port){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0){
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+//reads until the server closes, returns the bytes read
+static size_t drain(int fd){
+    char buf[256];
+    size_t total = 0;
+    ssize_t n;
+    while((n = read(fd, buf, sizeof(buf))) > 0){
+        total += n;
+    }
+    return total;
+}
+
+int main(int argc, char ** argv){
+    uint32_t cycles = (argc > 1) ? atoi(argv[1]) : 1000;
+    uint32_t background = (argc > 2) ? atoi(argv[2]) : 32;
+    uint16_t port = (argc > 3) ? atoi(argv[3]) : 18090;
+
+    AsyncServer server(port);
+    server.onClient(onClient, NULL);
+    server.setNoDelay(true);
+    server.begin();
+
+    std::vector<int> longLived;
+    for(uint32_t i = 0; i < background; ++i){
+        longLived.push_back(connectTo(port));
+    }
+
+    uint32_t answered = 0;
+    double start = now_us();
+    for(uint32_t c = 0; c < cycles; ++c){
+        for(int fd : longLived){
+            if(write(fd, &BACKGROUND_PING, 1) != 1){
+                perror("write");
+                return 1;
+            }
+        }
+        int fd = connectTo(port);
+        if(write(fd, &SHORT_REQUEST, 1) != 1){
+            perror("write");
+            return 1;
+        }
+        if(drain(fd) == sizeof(RESPONSE) - 1){
+            answered++;
+        }
+        ::close(fd);
+        for(int fd : longLived){
+            char echo;
+            if(read(fd, &echo, 1) != 1){
+                perror("read");
+                return 1;
+            }
+        }
+    }
+    double took = now_us() - start;
+
+    //the disconnects of the last closes may still be on their way
+    for(int i = 0; i < 100 && disconnected < cycles; ++i){
+        delay(10);
+    }
+    for(int fd : longLived){
+        ::close(fd);
+    }
+    for(int i = 0; i < 100 && disconnected < cycles + background; ++i){
+        delay(10);
+    }
+
+    async_tcp_stats_t stats;
+    async_tcp_get_stats(&stats);
+    printf("%u open/close cycles, %u long-lived connections\n", cycles, background);
+    printf("cycles   : %8.0f /s | answered %u | disconnected %u\n",
+        cycles / (took / 1e6), answered, disconnected.load());
+    printf("close    : %8.3f us avg %8.3f us worst\n", closed ? close_us / closed : 0, worst_close_us);
+    printf("stale    : %8u discarded | clients %u from the pool, %u from the heap, %u in use\n",
+        stats.stale_discarded, stats.client_pool.hits, stats.client_pool.misses, stats.client_pool.used);
+    //the epoll thread is still running, leave before the statics it uses are destroyed
+    fflush(stdout);
+    _exit(answered == cycles ? 0 : 1);
+}
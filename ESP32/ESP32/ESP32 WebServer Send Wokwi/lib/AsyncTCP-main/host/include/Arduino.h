@@ -0,0 +1,96 @@
+/*
+  Host shim: just enough of the Arduino ESP32 core to build AsyncTCP and
+  ESPAsyncWebServer as a Linux program. The host stands in for an ESP32, so
+  ESPAsyncWebServer takes the same code paths it takes on the board.
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#ifndef ESP32
+#define ESP32 1
+#endif
+#define ASYNC_TCP_HOST 1
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+#include "IPv6Address.h"
+
+#define PROGMEM
+#define PGM_P const char *
+#define PGM_VOID_P const void *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+#define pgm_read_word(addr) (*(const unsigned short *)(addr))
+#define pgm_read_dword(addr) (*(const unsigned long *)(addr))
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define strstr_P strstr
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+//ESP32 log levels, CORE_DEBUG_LEVEL picks how much is printed to stderr
+#define ARDUHAL_LOG_LEVEL_NONE    (0)
+#define ARDUHAL_LOG_LEVEL_ERROR   (1)
+#define ARDUHAL_LOG_LEVEL_WARN    (2)
+#define ARDUHAL_LOG_LEVEL_INFO    (3)
+#define ARDUHAL_LOG_LEVEL_DEBUG   (4)
+#define ARDUHAL_LOG_LEVEL_VERBOSE (5)
+
+#ifndef CORE_DEBUG_LEVEL
+#define CORE_DEBUG_LEVEL ARDUHAL_LOG_LEVEL_WARN
+#endif
+
+#define ARDUHAL_LOG(level, letter, format, ...) do { \
+    if(CORE_DEBUG_LEVEL >= (level)) { \
+        fprintf(stderr, "[%6lu][" letter "][%s:%u] %s(): " format "\n", millis(), __FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__); \
+    } \
+} while(0)
+
+#define log_e(format, ...) ARDUHAL_LOG(ARDUHAL_LOG_LEVEL_ERROR, "E", format, ##__VA_ARGS__)
+#define log_w(format, ...) ARDUHAL_LOG(ARDUHAL_LOG_LEVEL_WARN, "W", format, ##__VA_ARGS__)
+#define log_i(format, ...) ARDUHAL_LOG(ARDUHAL_LOG_LEVEL_INFO, "I", format, ##__VA_ARGS__)
+#define log_d(format, ...) ARDUHAL_LOG(ARDUHAL_LOG_LEVEL_DEBUG, "D", format, ##__VA_ARGS__)
+#define log_v(format, ...) ARDUHAL_LOG(ARDUHAL_LOG_LEVEL_VERBOSE, "V", format, ##__VA_ARGS__)
+
+using std::min;
+using std::max;
+
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+uint32_t esp_random();
+
+extern "C" int ets_printf(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
+
+#endif /* Arduino_h */
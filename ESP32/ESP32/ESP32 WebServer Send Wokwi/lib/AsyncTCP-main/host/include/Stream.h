@@ -0,0 +1,30 @@
+/*
+  Host shim: Arduino Stream. Nothing blocks on the host, readBytes() stops
+  at the first read() that has nothing to give.
+*/
+
+#ifndef STREAM_H_HOST
+#define STREAM_H_HOST
+
+#include "Print.h"
+
+class Stream: public Print {
+  protected:
+    unsigned long _timeout = 1000;
+
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout(void) { return _timeout; }
+
+    virtual size_t readBytes(char *buffer, size_t length);
+    virtual size_t readBytes(uint8_t *buffer, size_t length) {
+      return readBytes((char *) buffer, length);
+    }
+    String readString();
+};
+
+#endif /* STREAM_H_HOST */
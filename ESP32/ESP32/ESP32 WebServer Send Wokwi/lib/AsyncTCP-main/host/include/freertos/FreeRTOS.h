@@ -0,0 +1,23 @@
+/*
+  Host shim: the FreeRTOS types ESPAsyncWebServer uses, ticks are milliseconds.
+*/
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif /* INC_FREERTOS_H */
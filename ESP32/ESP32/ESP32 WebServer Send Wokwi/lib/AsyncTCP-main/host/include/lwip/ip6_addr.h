@@ -0,0 +1,19 @@
+/*
+  Host shim: LwIP IPv6 address, same layout as the real one.
+*/
+
+#ifndef LWIP_HDR_IP6_ADDR_H
+#define LWIP_HDR_IP6_ADDR_H
+
+#include <stdint.h>
+#include <string.h>
+#include "lwip/opt.h"
+
+typedef struct ip6_addr {
+  uint32_t addr[4];
+  uint8_t zone;
+} ip6_addr_t;
+
+#define ip6_addr_set_zero(ip6addr) memset((ip6addr), 0, sizeof(ip6_addr_t))
+
+#endif /* LWIP_HDR_IP6_ADDR_H */
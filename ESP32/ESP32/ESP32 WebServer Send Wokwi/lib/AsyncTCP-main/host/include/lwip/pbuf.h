@@ -0,0 +1,28 @@
+/*
+  Host shim: received data is handed to onPacket()/onData() in pbufs, one
+  per MSS like LwIP does. They are plain heap blocks, pbuf_free() frees a chain.
+*/
+
+#ifndef LWIP_HDR_PBUF_H
+#define LWIP_HDR_PBUF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  uint16_t tot_len;
+  uint16_t len;
+};
+
+uint8_t pbuf_free(struct pbuf *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_HDR_PBUF_H */
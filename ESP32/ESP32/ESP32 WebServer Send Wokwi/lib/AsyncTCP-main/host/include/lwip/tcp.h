@@ -0,0 +1,71 @@
+/*
+  Host shim: the pcb of the Linux backend, a non-blocking socket and what is
+  queued on it. AsyncClient reads state, addresses and ports from it like
+  from a LwIP pcb, everything else belongs to host/src/AsyncTCPHost.cpp.
+  C++ only, it is included from within extern "C" blocks like the real one.
+*/
+
+#ifndef LWIP_HDR_TCP_H
+#define LWIP_HDR_TCP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lwip/ip_addr.h"
+
+extern "C++" {
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+class AsyncServer;
+struct async_event_owner;
+
+//LwIP tcp_state values, state() reports the same numbers
+enum tcp_state { CLOSED = 0, LISTEN = 1, SYN_SENT = 2, ESTABLISHED = 4, FIN_WAIT_1 = 5, CLOSE_WAIT = 7 };
+
+typedef struct {
+    const char * data;
+    size_t len;
+    char * buffer;      //our copy of the data, NULL while it points into the caller's buffer
+} host_segment_t;
+
+//Only the loop closes the socket and frees the pcb, everything below lock is shared
+struct tcp_pcb {
+    int fd = -1;
+    std::atomic<uint8_t> state{CLOSED};
+    std::mutex lock;
+    async_event_owner * owner = NULL;   //client of the connection, NULL once it let go
+    AsyncServer * server = NULL;        //server of a listening pcb
+    std::deque<host_segment_t> tx;
+    size_t tx_len = 0;                  //queued, not taken by the kernel yet
+    uint32_t tx_done = 0;               //taken by the kernel, not reported as acked yet
+    size_t rx_held = 0;                 //handed to the client, not acked yet
+    uint32_t closed_at = 0;
+    uint32_t events = 0;                //epoll interest
+    bool closing = false;               //send what is left, then close
+    bool rst = false;                   //close with a reset
+    bool aborted = false;               //abort(), the client gets ERR_ABRT
+    bool eof = false;                   //the peer has closed its side
+    bool hup = false;                   //hung up while reading was stopped
+    bool nodelay = false;
+    bool registered = false;            //in the epoll set
+    ip_addr_t local_ip = {};
+    ip_addr_t remote_ip = {};
+    uint16_t local_port = 0;
+    uint16_t remote_port = 0;
+    //loop only
+    bool kicked = false;                //in _host_kicked, guarded by _host_lock
+    bool dead = false;                  //socket closed, freed at the end of the iteration
+};
+
+//macros in LwIP, from any thread here
+size_t tcp_sndbuf(tcp_pcb * pcb);
+uint16_t tcp_mss(tcp_pcb * pcb);
+void tcp_nagle_disable(tcp_pcb * pcb);
+void tcp_nagle_enable(tcp_pcb * pcb);
+bool tcp_nagle_disabled(tcp_pcb * pcb);
+
+}
+
+#endif /* LWIP_HDR_TCP_H */
@@ -0,0 +1,34 @@
+/*
+  Host shim: MD5 for digest authentication, mbedTLS 2.x API.
+*/
+
+#ifndef MBEDTLS_MD5_H
+#define MBEDTLS_MD5_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mbedtls_md5_context {
+  uint32_t total[2];
+  uint32_t state[4];
+  unsigned char buffer[64];
+} mbedtls_md5_context;
+
+void mbedtls_md5_init(mbedtls_md5_context *ctx);
+void mbedtls_md5_free(mbedtls_md5_context *ctx);
+int mbedtls_md5_starts_ret(mbedtls_md5_context *ctx);
+int mbedtls_md5_update_ret(mbedtls_md5_context *ctx, const unsigned char *input, size_t ilen);
+int mbedtls_md5_finish_ret(mbedtls_md5_context *ctx, unsigned char output[16]);
+void mbedtls_md5_starts(mbedtls_md5_context *ctx);
+void mbedtls_md5_update(mbedtls_md5_context *ctx, const unsigned char *input, size_t ilen);
+void mbedtls_md5_finish(mbedtls_md5_context *ctx, unsigned char output[16]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_MD5_H */
@@ -0,0 +1,233 @@
+/*
+  Host shim: timing, Print/Stream and the FreeRTOS primitives, see include/Arduino.h
+*/
+
+#include "Arduino.h"
+#include "WiFi.h"
+
+#include <stdarg.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+
+WiFiClass WiFi;
+
+/*
+ * Timing
+ * */
+
+static const std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+
+unsigned long millis(){
+    //wraps at 32 bits like on the board
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start).count();
+}
+
+unsigned long micros(){
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start).count();
+}
+
+void delay(uint32_t ms){
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield(){
+    std::this_thread::yield();
+}
+
+uint32_t esp_random(){
+    static thread_local std::mt19937 generator(std::random_device{}());
+    return generator();
+}
+
+long random(long howbig){
+    if(howbig <= 0){
+        return 0;
+    }
+    return esp_random() % howbig;
+}
+
+long random(long howsmall, long howbig){
+    if(howsmall >= howbig){
+        return howsmall;
+    }
+    return howsmall + random(howbig - howsmall);
+}
+
+extern "C" int ets_printf(const char *format, ...){
+    va_list arg;
+    va_start(arg, format);
+    int len = vfprintf(stderr, format, arg);
+    va_end(arg);
+    return len;
+}
+
+/*
+ * Print
+ * */
+
+size_t Print::write(const uint8_t *buffer, size_t size){
+    size_t n = 0;
+    while(size--){
+        if(!write(*buffer++)){
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char *format, ...){
+    char loc_buf[64];
+    char * temp = loc_buf;
+    va_list arg;
+    va_list copy;
+    va_start(arg, format);
+    va_copy(copy, arg);
+    int len = vsnprintf(temp, sizeof(loc_buf), format, copy);
+    va_end(copy);
+    if(len < 0){
+        va_end(arg);
+        return 0;
+    }
+    if((size_t)len >= sizeof(loc_buf)){
+        temp = (char*) malloc(len + 1);
+        if(temp == NULL){
+            va_end(arg);
+            return 0;
+        }
+        len = vsnprintf(temp, len + 1, format, arg);
+    }
+    va_end(arg);
+    len = write((uint8_t*)temp, len);
+    if(temp != loc_buf){
+        free(temp);
+    }
+    return len;
+}
+
+size_t Print::print(const __FlashStringHelper *ifsh){ return print(reinterpret_cast<const char *>(ifsh)); }
+size_t Print::print(const String &s){ return write(s.c_str(), s.length()); }
+size_t Print::print(const char str[]){ return write(str); }
+size_t Print::print(char c){ return write((uint8_t)c); }
+size_t Print::print(unsigned char b, int base){ return print(String(b, (unsigned char)base)); }
+size_t Print::print(int n, int base){ return print(String(n, (unsigned char)base)); }
+size_t Print::print(unsigned int n, int base){ return print(String(n, (unsigned char)base)); }
+size_t Print::print(long n, int base){ return print(String(n, (unsigned char)base)); }
+size_t Print::print(unsigned long n, int base){ return print(String(n, (unsigned char)base)); }
+size_t Print::print(long long n, int base){ return print(String(n, (unsigned char)base)); }
+size_t Print::print(unsigned long long n, int base){ return print(String(n, (unsigned char)base)); }
+size_t Print::print(double n, int digits){ return print(String(n, (unsigned int)digits)); }
+size_t Print::print(const Printable& x){ return x.printTo(*this); }
+
+size_t Print::println(void){ return print("\r\n"); }
+size_t Print::println(const __FlashStringHelper *ifsh){ size_t n = print(ifsh); return n + println(); }
+size_t Print::println(const String &s){ size_t n = print(s); return n + println(); }
+size_t Print::println(const char str[]){ size_t n = print(str); return n + println(); }
+size_t Print::println(char c){ size_t n = print(c); return n + println(); }
+size_t Print::println(unsigned char b, int base){ size_t n = print(b, base); return n + println(); }
+size_t Print::println(int num, int base){ size_t n = print(num, base); return n + println(); }
+size_t Print::println(unsigned int num, int base){ size_t n = print(num, base); return n + println(); }
+size_t Print::println(long num, int base){ size_t n = print(num, base); return n + println(); }
+size_t Print::println(unsigned long num, int base){ size_t n = print(num, base); return n + println(); }
+size_t Print::println(long long num, int base){ size_t n = print(num, base); return n + println(); }
+size_t Print::println(unsigned long long num, int base){ size_t n = print(num, base); return n + println(); }
+size_t Print::println(double num, int digits){ size_t n = print(num, digits); return n + println(); }
+size_t Print::println(const Printable& x){ size_t n = print(x); return n + println(); }
+
+/*
+ * Stream
+ * */
+
+size_t Stream::readBytes(char *buffer, size_t length){
+    size_t count = 0;
+    while(count < length){
+        int c = read();
+        if(c < 0){
+            break;
+        }
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString(){
+    String ret;
+    int c;
+    while((c = read()) >= 0){
+        ret += (char)c;
+    }
+    return ret;
+}
+
+/*
+ * FreeRTOS
+ * A semaphore is a counter with a limit, binary ones start empty, mutexes start given.
+ * */
+
+struct host_semaphore {
+    std::mutex lock;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+extern "C" {
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void){
+    static thread_local char tcb;
+    return &tcb;
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay){
+    delay(xTicksToDelay * portTICK_PERIOD_MS);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount){
+    host_semaphore * s = new host_semaphore();
+    s->count = uxInitialCount;
+    s->max = uxMaxCount;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void){
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void){
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime){
+    host_semaphore * s = (host_semaphore *)xSemaphore;
+    std::unique_lock<std::mutex> guard(s->lock);
+    if(xBlockTime == portMAX_DELAY){
+        s->cv.wait(guard, [s]{ return s->count > 0; });
+    } else if(!s->cv.wait_for(guard, std::chrono::milliseconds(xBlockTime * portTICK_PERIOD_MS), [s]{ return s->count > 0; })){
+        return pdFALSE;
+    }
+    s->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore){
+    host_semaphore * s = (host_semaphore *)xSemaphore;
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        if(s->count >= s->max){
+            return pdFALSE;
+        }
+        s->count++;
+    }
+    s->cv.notify_one();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore){
+    delete (host_semaphore *)xSemaphore;
+}
+
+}
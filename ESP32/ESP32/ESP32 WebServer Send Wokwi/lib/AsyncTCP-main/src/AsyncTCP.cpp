@@ -21,13 +21,11 @@
 
 #include "Arduino.h"
 
-#include "AsyncTCP.h"
+#include "AsyncTCPBackend.h"
+#include "AsyncTCPWorker.h"
 extern "C"{
-#include "lwip/opt.h"
-#include "lwip/tcp.h"
 #include "lwip/inet.h"
 #include "lwip/dns.h"
-#include "lwip/err.h"
 }
 #if CONFIG_ASYNC_TCP_USE_WDT
 #include "esp_task_wdt.h"
@@ -41,9 +39,15 @@ typedef enum {
     LWIP_TCP_SENT, LWIP_TCP_RECV, LWIP_TCP_FIN, LWIP_TCP_ERROR, LWIP_TCP_POLL, LWIP_TCP_CLEAR, LWIP_TCP_ACCEPT, LWIP_TCP_CONNECTED, LWIP_TCP_DNS
 } lwip_event_t;
 
+//Queued events point to the tombstone of their connection (see AsyncTCPBackend.h),
+//the async task drops stale ones as it dequeues them, so the queue never has to be rewritten.
+
+SemaphoreHandle_t _tx_refs_lock = NULL;
+
 typedef struct {
         lwip_event_t event;
         void *arg;
+        async_event_owner * owner;
         union {
                 struct {
                         void * pcb;
@@ -78,75 +82,264 @@ typedef struct {
         };
 } lwip_event_packet_t;
 
-static xQueueHandle _async_queue;
-static TaskHandle_t _async_service_task_handle = NULL;
+static xQueueHandle _async_queue[CONFIG_ASYNC_TCP_WORKERS];
+static TaskHandle_t _async_service_task_handle[CONFIG_ASYNC_TCP_WORKERS];
+static AsyncObjectPool<lwip_event_packet_t> _event_pool;
+static AsyncObjectPool<async_event_owner> _owner_pool;
+AsyncObjectPool<AsyncClient> _client_pool;
+AsyncObjectPool<async_tx_ref> _tx_ref_pool;
+static AsyncTimerWheel _async_timers[CONFIG_ASYNC_TCP_WORKERS];
 
 
-SemaphoreHandle_t _slots_lock;
+/*
+ * Closed slots
+ * A client owns a slot from its first pcb until it is closed. API calls carry
+ * a handle to the slot, the slot index in the low byte and the generation of
+ * the slot above it. Freeing a slot bumps its generation, so a handle taken
+ * before the close no longer matches, even once the slot has been reused.
+ * Free slots sit on a lock-free index stack, allocate and free are O(1).
+ * */
+
+static_assert(CONFIG_LWIP_MAX_ACTIVE_TCP > 0 && CONFIG_LWIP_MAX_ACTIVE_TCP <= 256, "closed slot handles keep the index in one byte");
 const int _number_of_closed_slots = CONFIG_LWIP_MAX_ACTIVE_TCP;
-static uint32_t _closed_slots[_number_of_closed_slots];
-static uint32_t _closed_index = []() {
-    _slots_lock = xSemaphoreCreateBinary();
-    xSemaphoreGive(_slots_lock);
-    for (int i = 0; i < _number_of_closed_slots; ++ i) {
-        _closed_slots[i] = 1;
+
+static std::atomic<uint32_t> _closed_slots[_number_of_closed_slots];
+static AsyncIndexStack _free_closed_slots;
+static bool _closed_slots_ready = _free_closed_slots.begin(_number_of_closed_slots);
+
+static inline bool _slot_closed(int32_t closed_slot){
+    if(closed_slot == -1){
+        return false;
     }
-    return 1;
-}();
+    uint32_t generation = _closed_slots[closed_slot & 0xFF].load(std::memory_order_acquire) & 0x7FFFFF;
+    return ((uint32_t)closed_slot >> 8) != generation;
+}
 
 
+async_event_owner * _new_event_owner(AsyncClient * client){
+    async_event_owner * owner = _owner_pool.alloc();
+    if(owner){
+        new (owner) async_event_owner();
+        owner->timer.prev = owner->timer.next = NULL;
+        owner->refs = 1;
+        owner->dead = false;
+        owner->due = 0;
+        owner->client = client;
+    }
+    return owner;
+}
+
+void _release_event_owner(async_event_owner * owner){
+    if(owner && owner->refs.fetch_sub(1) == 1){
+        _owner_pool.release(owner);
+    }
+}
+
+static inline lwip_event_packet_t * _alloc_async_event(){
+    lwip_event_packet_t * e = _event_pool.alloc();
+    if(e){
+        e->owner = NULL;
+    }
+    return e;
+}
+
+static inline void _free_async_event(lwip_event_packet_t * e){
+    if(e){
+        _release_event_owner(e->owner);
+    }
+    _event_pool.release(e);
+}
+
+//drop an event without handling it, received data is ours to free
+static inline void _discard_async_event(lwip_event_packet_t * e){
+    if(e->event == LWIP_TCP_RECV){
+        pbuf_free(e->recv.pb);
+    }
+    _free_async_event(e);
+}
+
+//tie the event to its connection's tombstone before it goes into a queue
+static inline void _stamp_async_event(lwip_event_packet_t * e){
+    if(e->owner || !e->arg || e->event == LWIP_TCP_ACCEPT){
+        return;
+    }
+    async_event_owner * owner = reinterpret_cast<AsyncClient*>(e->arg)->_events;
+    if(owner){
+        owner->refs++;
+        e->owner = owner;
+    }
+}
+
+//Data events (RECV, SENT, POLL) may only fill the queue up to this many free
+//slots. The rest is kept for connect/accept/fin/error, so those rarely wait.
+static const UBaseType_t _async_queue_reserve = (CONFIG_LWIP_MAX_ACTIVE_TCP < CONFIG_ASYNC_TCP_QUEUE_SIZE / 2) ? CONFIG_LWIP_MAX_ACTIVE_TCP : CONFIG_ASYNC_TCP_QUEUE_SIZE / 2;
+
+static uint32_t _queue_high_water = 0;
+static uint32_t _blocked_count = 0;
+static uint32_t _blocked_us = 0;
+static uint32_t _recv_refused = 0;
+static uint32_t _sent_coalesced = 0;
+static uint32_t _poll_coalesced = 0;
+static uint32_t _timers_fired = 0;
+static uint32_t _dropped = 0;
+static uint32_t _stale_discarded = 0;
+
+void async_tcp_get_stats(async_tcp_stats_t * stats){
+    _event_pool.stats(&stats->event_pool);
+    _client_pool.stats(&stats->client_pool);
+    _tx_ref_pool.stats(&stats->tx_ref_pool);
+    stats->queue_size = CONFIG_ASYNC_TCP_QUEUE_SIZE;
+    stats->queue_depth = 0;
+    for(int i = 0; i < CONFIG_ASYNC_TCP_WORKERS; ++i){
+        if(_async_queue[i]){
+            stats->queue_depth += uxQueueMessagesWaiting(_async_queue[i]);
+        }
+    }
+    stats->queue_high_water = _queue_high_water;
+    stats->blocked_count = _blocked_count;
+    stats->blocked_us = _blocked_us;
+    stats->recv_refused = _recv_refused;
+    stats->sent_coalesced = _sent_coalesced;
+    stats->poll_coalesced = _poll_coalesced;
+    stats->timers_armed = 0;
+    for(int i = 0; i < CONFIG_ASYNC_TCP_WORKERS; ++i){
+        stats->timers_armed += _async_timers[i].armed();
+    }
+    stats->timers_fired = _timers_fired;
+    stats->dropped = _dropped;
+    stats->stale_discarded = _stale_discarded;
+}
+
 static inline bool _init_async_event_queue(){
-    if(!_async_queue){
-        _async_queue = xQueueCreate(32, sizeof(lwip_event_packet_t *));
-        if(!_async_queue){
+    if(!_async_queue[0]){
+        if(CONFIG_ASYNC_TCP_EVENT_POOL_SIZE > 0 && !_event_pool.begin(CONFIG_ASYNC_TCP_EVENT_POOL_SIZE)){
+            log_w("event pool disabled, falling back to heap");
+        }
+        _owner_pool.begin(CONFIG_LWIP_MAX_ACTIVE_TCP * 2);
+        if(CONFIG_ASYNC_TCP_CLIENT_POOL_SIZE && !_client_pool.begin(CONFIG_ASYNC_TCP_CLIENT_POOL_SIZE)){
+            log_w("client pool disabled, falling back to heap");
+        }
+        if(CONFIG_ASYNC_TCP_TX_REF_POOL_SIZE > 0 && !_tx_ref_pool.begin(CONFIG_ASYNC_TCP_TX_REF_POOL_SIZE)){
+            log_w("tx ref pool disabled, falling back to heap");
+        }
+        if(!_tx_refs_lock){
+            _tx_refs_lock = xSemaphoreCreateMutex();
+        }
+        for(int i = 0; i < CONFIG_ASYNC_TCP_WORKERS; ++i){
+            _async_queue[i] = xQueueCreate(CONFIG_ASYNC_TCP_QUEUE_SIZE, sizeof(lwip_event_packet_t *));
+            if(!_async_queue[i]){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static inline int _async_worker_for(void * owner){
+    return async_tcp_worker_for(owner, CONFIG_ASYNC_TCP_WORKERS);
+}
+
+static inline xQueueHandle _async_queue_for(void * owner){
+    return _async_queue[_async_worker_for(owner)];
+}
+
+static inline xQueueHandle _async_queue_for(lwip_event_packet_t * e){
+    //an accepted client is routed by itself, not by the server that accepted it,
+    //so its accept event is handled before anything it receives afterwards
+    if(e->event == LWIP_TCP_ACCEPT){
+        return _async_queue_for((void*)e->accept.client);
+    }
+    return _async_queue_for(e->arg);
+}
+
+static inline void _update_queue_high_water(xQueueHandle queue){
+    uint32_t depth = uxQueueMessagesWaiting(queue);
+    if(depth > _queue_high_water){
+        _queue_high_water = depth;
+    }
+}
+
+//Never blocks. Fails while the queue is down to its reserved slots.
+static inline bool _send_async_data_event(lwip_event_packet_t ** e){
+    _stamp_async_event(*e);
+    xQueueHandle queue = _async_queue_for(*e);
+    if(!queue || uxQueueSpacesAvailable(queue) <= _async_queue_reserve){
+        return false;
+    }
+    if(xQueueSend(queue, e, 0) != pdPASS){
+        return false;
+    }
+    _update_queue_high_water(queue);
+    return true;
+}
+
+//Connection state changes must not be lost, so these wait for space as a last
+//resort. The wait is accounted for, as it stalls the caller (usually LwIP).
+static bool _queue_async_event(lwip_event_packet_t ** e, bool front){
+    _stamp_async_event(*e);
+    xQueueHandle queue = _async_queue_for(*e);
+    if(!queue){
+        _dropped++;
+        return false;
+    }
+    //xQueueSendToFront() and xQueueSendToBack() are macros over this
+    BaseType_t position = front ? queueSEND_TO_FRONT : queueSEND_TO_BACK;
+    if(xQueueGenericSend(queue, e, 0, position) != pdPASS){
+        uint32_t started = micros();
+        if(xQueueGenericSend(queue, e, portMAX_DELAY, position) != pdPASS){
+            _dropped++;
             return false;
         }
+        _blocked_count++;
+        _blocked_us += micros() - started;
     }
+    _update_queue_high_water(queue);
     return true;
 }
 
 static inline bool _send_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueSend(_async_queue, e, portMAX_DELAY) == pdPASS;
+    return _queue_async_event(e, false);
 }
 
 static inline bool _prepend_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueSendToFront(_async_queue, e, portMAX_DELAY) == pdPASS;
+    return _queue_async_event(e, true);
 }
 
-static inline bool _get_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueReceive(_async_queue, e, portMAX_DELAY) == pdPASS;
+static inline bool _get_async_event(xQueueHandle queue, lwip_event_packet_t ** e, TickType_t wait){
+    return queue && xQueueReceive(queue, e, wait) == pdPASS;
 }
 
 static bool _remove_events_with_arg(void * arg){
     lwip_event_packet_t * first_packet = NULL;
     lwip_event_packet_t * packet = NULL;
+    xQueueHandle queue = _async_queue_for(arg);
 
-    if(!_async_queue){
+    if(!queue){
         return false;
     }
     //figure out which is the first packet so we can keep the order
     while(!first_packet){
-        if(xQueueReceive(_async_queue, &first_packet, 0) != pdPASS){
+        if(xQueueReceive(queue, &first_packet, 0) != pdPASS){
             return false;
         }
         //discard packet if matching
         if((int)first_packet->arg == (int)arg){
-            free(first_packet);
+            _discard_async_event(first_packet);
             first_packet = NULL;
         //return first packet to the back of the queue
-        } else if(xQueueSend(_async_queue, &first_packet, portMAX_DELAY) != pdPASS){
+        } else if(xQueueSend(queue, &first_packet, portMAX_DELAY) != pdPASS){
             return false;
         }
     }
 
-    while(xQueuePeek(_async_queue, &packet, 0) == pdPASS && packet != first_packet){
-        if(xQueueReceive(_async_queue, &packet, 0) != pdPASS){
+    while(xQueuePeek(queue, &packet, 0) == pdPASS && packet != first_packet){
+        if(xQueueReceive(queue, &packet, 0) != pdPASS){
             return false;
         }
         if((int)packet->arg == (int)arg){
-            free(packet);
+            _discard_async_event(packet);
             packet = NULL;
-        } else if(xQueueSend(_async_queue, &packet, portMAX_DELAY) != pdPASS){
+        } else if(xQueueSend(queue, &packet, portMAX_DELAY) != pdPASS){
             return false;
         }
     }
@@ -154,6 +347,12 @@ static bool _remove_events_with_arg(void * arg){
 }
 
 static void _handle_async_event(lwip_event_packet_t * e){
+    if(e->owner && e->owner->dead){
+        //the connection was closed after this was queued, the client may be gone already
+        _stale_discarded++;
+        _discard_async_event(e);
+        return;
+    }
     if(e->arg == NULL){
         // do nothing when arg is NULL
         //ets_printf("event arg == NULL: 0x%08x\n", e->recv.pcb);
@@ -170,6 +369,7 @@ static void _handle_async_event(lwip_event_packet_t * e){
         AsyncClient::_s_sent(e->arg, e->sent.pcb, e->sent.len);
     } else if(e->event == LWIP_TCP_POLL){
         //ets_printf("-P: 0x%08x\n", e->poll.pcb);
+        reinterpret_cast<AsyncClient*>(e->arg)->_poll_queued = false;
         AsyncClient::_s_poll(e->arg, e->poll.pcb);
     } else if(e->event == LWIP_TCP_ERROR){
         //ets_printf("-E: 0x%08x %d\n", e->arg, e->error.err);
@@ -184,28 +384,89 @@ static void _handle_async_event(lwip_event_packet_t * e){
         //ets_printf("D: 0x%08x %s = %s\n", e->arg, e->dns.name, ipaddr_ntoa(&e->dns.addr));
         AsyncClient::_s_dns_found(e->dns.name, &e->dns.addr, e->arg);
     }
-    free((void*)(e));
+    _free_async_event(e);
+}
+
+/*
+ * Connection Timers
+ * Every async task keeps the RX, ACK and poll deadlines of its connections
+ * in a timer wheel and sleeps on its queue until the earliest one is due.
+ * A connection without any deadline is not looked at until it has traffic.
+ * */
+
+static inline bool _in_async_task_for(void * arg){
+    TaskHandle_t task = _async_service_task_handle[_async_worker_for(arg)];
+    return task && task == xTaskGetCurrentTaskHandle();
+}
+
+void _arm_event_timer(async_event_owner * owner, uint32_t due){
+    if(!AsyncTimerWheel::scheduled(&owner->timer)){
+        //the wheel keeps the tombstone alive until the timer fires or is cancelled
+        owner->refs++;
+    }
+    _async_timers[_async_worker_for(owner->client)].schedule(&owner->timer, due);
+    owner->due = due ? due : 1;
+}
+
+void _disarm_event_timer(async_event_owner * owner){
+    if(!AsyncTimerWheel::scheduled(&owner->timer)){
+        return;
+    }
+    _async_timers[_async_worker_for(owner->client)].cancel(&owner->timer);
+    owner->due = 0;
+    _release_event_owner(owner);
+}
+
+//the timer of a dead connection is dropped when it fires
+void _kill_event_owner(async_event_owner * owner){
+    owner->dead = true;
+    if(_in_async_task_for(owner->client)){
+        _disarm_event_timer(owner);
+    }
+}
+
+static void _event_timer_expired(async_timer_node_t * node, void * arg){
+    async_event_owner * owner = reinterpret_cast<async_event_owner*>(node);
+    owner->due = 0;
+    if(!owner->dead){
+        _timers_fired++;
+        AsyncClient::_s_poll(owner->client, owner->client->pcb());
+    }
+    _release_event_owner(owner);
+}
+
+static inline TickType_t _async_timer_wait(AsyncTimerWheel & timers){
+    uint32_t wait = timers.next(millis());
+    if(wait == AsyncTimerWheel::NEVER){
+        return portMAX_DELAY;
+    }
+    return pdMS_TO_TICKS(wait) + 1;
 }
 
 static void _async_service_task(void *pvParameters){
+    int worker = (int)(intptr_t)pvParameters;
+    xQueueHandle queue = _async_queue[worker];
+    AsyncTimerWheel & timers = _async_timers[worker];
     lwip_event_packet_t * packet = NULL;
+    timers.begin(millis());
     for (;;) {
-        if(_get_async_event(&packet)){
+        bool received = _get_async_event(queue, &packet, _async_timer_wait(timers));
 #if CONFIG_ASYNC_TCP_USE_WDT
-            if(esp_task_wdt_add(NULL) != ESP_OK){
-                log_e("Failed to add async task to WDT");
-            }
+        if(esp_task_wdt_add(NULL) != ESP_OK){
+            log_e("Failed to add async task to WDT");
+        }
 #endif
+        if(received){
             _handle_async_event(packet);
+        }
+        timers.advance(millis(), _event_timer_expired, NULL);
 #if CONFIG_ASYNC_TCP_USE_WDT
-            if(esp_task_wdt_delete(NULL) != ESP_OK){
-                log_e("Failed to remove loop task from WDT");
-            }
-#endif
+        if(esp_task_wdt_delete(NULL) != ESP_OK){
+            log_e("Failed to remove loop task from WDT");
         }
+#endif
     }
     vTaskDelete(NULL);
-    _async_service_task_handle = NULL;
 }
 /*
 static void _stop_async_task(){
@@ -239,9 +500,21 @@ static bool _start_async_task(){
     if(!_init_async_event_queue()){
         return false;
     }
-    if(!_async_service_task_handle){
-        customTaskCreateUniversal(_async_service_task, "async_tcp", CONFIG_ASYNC_TCP_STACK_SIZE, NULL, 3, &_async_service_task_handle, CONFIG_ASYNC_TCP_RUNNING_CORE);
-        if(!_async_service_task_handle){
+    for(int i = 0; i < CONFIG_ASYNC_TCP_WORKERS; ++i){
+        if(_async_service_task_handle[i]){
+            continue;
+        }
+        //extra workers alternate cores starting from the configured one
+        BaseType_t core = CONFIG_ASYNC_TCP_RUNNING_CORE;
+        if(core >= 0){
+            core = (core + i) % 2;
+        }
+        char name[16] = "async_tcp";
+        if(i){
+            snprintf(name, sizeof(name), "async_tcp_%d", i);
+        }
+        customTaskCreateUniversal(_async_service_task, name, CONFIG_ASYNC_TCP_STACK_SIZE, (void*)(intptr_t)i, 3, &_async_service_task_handle[i], core);
+        if(!_async_service_task_handle[i]){
             return false;
         }
     }
@@ -252,43 +525,59 @@ static bool _start_async_task(){
  * LwIP Callbacks
  * */
 
-static int8_t _tcp_clear_events(void * arg) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+int8_t _tcp_clear_events(void * arg) {
+    async_event_owner * owner = reinterpret_cast<AsyncClient*>(arg)->_events;
+    if(owner){
+        _kill_event_owner(owner);
+        return ERR_OK;
+    }
+    //no tombstone (out of memory), take the events out of the queue instead
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        //not even room to ask the async task for it, rotate the queue from here
+        _remove_events_with_arg(arg);
+        return ERR_OK;
+    }
     e->event = LWIP_TCP_CLEAR;
     e->arg = arg;
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_connected(void * arg, tcp_pcb * pcb, int8_t err) {
     //ets_printf("+C: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
     e->event = LWIP_TCP_CONNECTED;
     e->arg = arg;
     e->connected.pcb = pcb;
     e->connected.err = err;
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
+static int8_t _tcp_sent(void * arg, struct tcp_pcb * pcb, uint16_t len);
+
 static int8_t _tcp_poll(void * arg, struct tcp_pcb * pcb) {
     //ets_printf("+P: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
-    e->event = LWIP_TCP_POLL;
-    e->arg = arg;
-    e->poll.pcb = pcb;
-    if (!_send_async_event(&e)) {
-        free((void*)(e));
+    AsyncClient * client = reinterpret_cast<AsyncClient*>(arg);
+    if(!client){
+        return ERR_OK;
+    }
+    //acks that could not be queued before are reported on the next tick,
+    //timeouts and onPoll are driven by the timer wheel of the async task
+    if(client->_sent_deferred){
+        _tcp_sent(arg, pcb, 0);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_t err) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    int8_t result = ERR_OK;
+    lwip_event_packet_t * e = _alloc_async_event();
     e->arg = arg;
     if(pb){
         //ets_printf("+R: 0x%08x\n", pcb);
@@ -296,46 +585,68 @@ static int8_t _tcp_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_
         e->recv.pcb = pcb;
         e->recv.pb = pb;
         e->recv.err = err;
+        //never wait here, if the queue is busy LwIP keeps the data and offers it again later
+        if (!_send_async_data_event(&e)) {
+            _free_async_event(e);
+            _recv_refused++;
+            return ERR_MEM;
+        }
+        return ERR_OK;
     } else {
         //ets_printf("+F: 0x%08x\n", pcb);
         e->event = LWIP_TCP_FIN;
         e->fin.pcb = pcb;
         e->fin.err = err;
-        //close the PCB in LwIP thread
-        AsyncClient::_s_lwip_fin(e->arg, e->fin.pcb, e->fin.err);
+        //close the PCB in LwIP thread, LwIP must be told if it was aborted
+        result = AsyncClient::_s_lwip_fin(e->arg, e->fin.pcb, e->fin.err);
     }
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
-    return ERR_OK;
+    return result;
 }
 
 static int8_t _tcp_sent(void * arg, struct tcp_pcb * pcb, uint16_t len) {
     //ets_printf("+S: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    AsyncClient * client = reinterpret_cast<AsyncClient*>(arg);
+    if(!client){
+        return ERR_OK;
+    }
+    //fold in acks that could not be queued before, anything above 64K waits for the next event
+    uint32_t acked = client->_sent_deferred.exchange(0) + len;
+    uint16_t report = (acked > 0xFFFF) ? 0xFFFF : acked;
+    if(!report){
+        return ERR_OK;
+    }
+    lwip_event_packet_t * e = _alloc_async_event();
     e->event = LWIP_TCP_SENT;
     e->arg = arg;
     e->sent.pcb = pcb;
-    e->sent.len = len;
-    if (!_send_async_event(&e)) {
-        free((void*)(e));
+    e->sent.len = report;
+    if (!_send_async_data_event(&e)) {
+        _free_async_event(e);
+        _sent_coalesced++;
+        report = 0;
+    }
+    if(acked > report){
+        client->_sent_deferred += acked - report;
     }
     return ERR_OK;
 }
 
 static void _tcp_error(void * arg, int8_t err) {
     //ets_printf("+E: 0x%08x\n", arg);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
     e->event = LWIP_TCP_ERROR;
     e->arg = arg;
     e->error.err = err;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
 }
 
 static void _tcp_dns_found(const char * name, struct ip_addr * ipaddr, void * arg) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
     //ets_printf("+DNS: name=%s ipaddr=0x%08x arg=%x\n", name, ipaddr, arg);
     e->event = LWIP_TCP_DNS;
     e->arg = arg;
@@ -346,22 +657,38 @@ static void _tcp_dns_found(const char * name, struct ip_addr * ipaddr, void * ar
         memset(&e->dns.addr, 0, sizeof(e->dns.addr));
     }
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
 }
 
 //Used to switch out from LwIP thread
 static int8_t _tcp_accept(void * arg, AsyncClient * client) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
     e->event = LWIP_TCP_ACCEPT;
     e->arg = arg;
     e->accept.client = client;
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
+void _tcp_attach(tcp_pcb * pcb, AsyncClient * client) {
+    tcp_arg(pcb, client);
+    tcp_recv(pcb, &_tcp_recv);
+    tcp_sent(pcb, &_tcp_sent);
+    tcp_err(pcb, &_tcp_error);
+    tcp_poll(pcb, &_tcp_poll, 1);
+}
+
+void _tcp_detach(tcp_pcb * pcb) {
+    tcp_arg(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_err(pcb, NULL);
+    tcp_poll(pcb, NULL, 0);
+}
+
 /*
  * TCP/IP API Calls
  * */
@@ -371,14 +698,15 @@ static int8_t _tcp_accept(void * arg, AsyncClient * client) {
 typedef struct {
     struct tcpip_api_call_data call;
     tcp_pcb * pcb;
-    int8_t closed_slot;
+    int32_t closed_slot;
     int8_t err;
     union {
             struct {
-                    const char* data;
-                    size_t size;
-                    uint8_t apiflags;
-            } write;
+                    const async_tcp_segment_t * segments;
+                    size_t count;
+                    size_t written;
+                    bool output;
+            } writev;
             size_t received;
             struct {
                     ip_addr_t * addr;
@@ -396,13 +724,13 @@ typedef struct {
 static err_t _tcp_output_api(struct tcpip_api_call_data *api_call_msg){
     tcp_api_call_t * msg = (tcp_api_call_t *)api_call_msg;
     msg->err = ERR_CONN;
-    if(msg->closed_slot == -1 || !_closed_slots[msg->closed_slot]) {
+    if(!_slot_closed(msg->closed_slot)) {
         msg->err = tcp_output(msg->pcb);
     }
     return msg->err;
 }
 
-static esp_err_t _tcp_output(tcp_pcb * pcb, int8_t closed_slot) {
+int8_t _tcp_output(tcp_pcb * pcb, int32_t closed_slot) {
     if(!pcb){
         return ERR_CONN;
     }
@@ -413,40 +741,68 @@ static esp_err_t _tcp_output(tcp_pcb * pcb, int8_t closed_slot) {
     return msg.err;
 }
 
-static err_t _tcp_write_api(struct tcpip_api_call_data *api_call_msg){
+//every tcp_write of the batch and the tcp_output in one trip to the LwIP thread
+static err_t _tcp_writev_api(struct tcpip_api_call_data *api_call_msg){
     tcp_api_call_t * msg = (tcp_api_call_t *)api_call_msg;
     msg->err = ERR_CONN;
-    if(msg->closed_slot == -1 || !_closed_slots[msg->closed_slot]) {
-        msg->err = tcp_write(msg->pcb, msg->write.data, msg->write.size, msg->write.apiflags);
+    msg->writev.written = 0;
+    if(_slot_closed(msg->closed_slot)) {
+        return msg->err;
+    }
+    msg->err = ERR_OK;
+    size_t room = (msg->pcb->state == ESTABLISHED) ? tcp_sndbuf(msg->pcb) : 0;
+    for(size_t i = 0; i < msg->writev.count && room; ++i){
+        const async_tcp_segment_t * segment = &msg->writev.segments[i];
+        if(!segment->data || !segment->len){
+            continue;
+        }
+        size_t will_send = (room < segment->len) ? room : segment->len;
+        uint8_t apiflags = segment->apiflags;
+        if(will_send == segment->len && i + 1 < msg->writev.count){
+            //no PSH in the middle of the batch
+            apiflags |= TCP_WRITE_FLAG_MORE;
+        }
+        err_t err = tcp_write(msg->pcb, segment->data, will_send, apiflags);
+        if(err != ERR_OK){
+            msg->err = err;
+            break;
+        }
+        msg->writev.written += will_send;
+        room -= will_send;
+    }
+    if(msg->writev.written){
+        msg->err = msg->writev.output ? tcp_output(msg->pcb) : ERR_OK;
     }
     return msg->err;
 }
 
-static esp_err_t _tcp_write(tcp_pcb * pcb, int8_t closed_slot, const char* data, size_t size, uint8_t apiflags) {
+int8_t _tcp_writev(tcp_pcb * pcb, int32_t closed_slot, const async_tcp_segment_t * segments, size_t count, bool output, size_t * written) {
+    *written = 0;
     if(!pcb){
         return ERR_CONN;
     }
     tcp_api_call_t msg;
     msg.pcb = pcb;
     msg.closed_slot = closed_slot;
-    msg.write.data = data;
-    msg.write.size = size;
-    msg.write.apiflags = apiflags;
-    tcpip_api_call(_tcp_write_api, (struct tcpip_api_call_data*)&msg);
+    msg.writev.segments = segments;
+    msg.writev.count = count;
+    msg.writev.output = output;
+    tcpip_api_call(_tcp_writev_api, (struct tcpip_api_call_data*)&msg);
+    *written = msg.writev.written;
     return msg.err;
 }
 
 static err_t _tcp_recved_api(struct tcpip_api_call_data *api_call_msg){
     tcp_api_call_t * msg = (tcp_api_call_t *)api_call_msg;
     msg->err = ERR_CONN;
-    if(msg->closed_slot == -1 || !_closed_slots[msg->closed_slot]) {
+    if(!_slot_closed(msg->closed_slot)) {
         msg->err = 0;
         tcp_recved(msg->pcb, msg->received);
     }
     return msg->err;
 }
 
-static esp_err_t _tcp_recved(tcp_pcb * pcb, int8_t closed_slot, size_t len) {
+int8_t _tcp_recved(tcp_pcb * pcb, int32_t closed_slot, size_t len) {
     if(!pcb){
         return ERR_CONN;
     }
@@ -461,13 +817,13 @@ static esp_err_t _tcp_recved(tcp_pcb * pcb, int8_t closed_slot, size_t len) {
 static err_t _tcp_close_api(struct tcpip_api_call_data *api_call_msg){
     tcp_api_call_t * msg = (tcp_api_call_t *)api_call_msg;
     msg->err = ERR_CONN;
-    if(msg->closed_slot == -1 || !_closed_slots[msg->closed_slot]) {
+    if(!_slot_closed(msg->closed_slot)) {
         msg->err = tcp_close(msg->pcb);
     }
     return msg->err;
 }
 
-static esp_err_t _tcp_close(tcp_pcb * pcb, int8_t closed_slot) {
+int8_t _tcp_close(tcp_pcb * pcb, int32_t closed_slot) {
     if(!pcb){
         return ERR_CONN;
     }
@@ -481,13 +837,13 @@ static esp_err_t _tcp_close(tcp_pcb * pcb, int8_t closed_slot) {
 static err_t _tcp_abort_api(struct tcpip_api_call_data *api_call_msg){
     tcp_api_call_t * msg = (tcp_api_call_t *)api_call_msg;
     msg->err = ERR_CONN;
-    if(msg->closed_slot == -1 || !_closed_slots[msg->closed_slot]) {
+    if(!_slot_closed(msg->closed_slot)) {
         tcp_abort(msg->pcb);
     }
     return msg->err;
 }
 
-static esp_err_t _tcp_abort(tcp_pcb * pcb, int8_t closed_slot) {
+int8_t _tcp_abort(tcp_pcb * pcb, int32_t closed_slot) {
     if(!pcb){
         return ERR_CONN;
     }
@@ -504,7 +860,7 @@ static err_t _tcp_connect_api(struct tcpip_api_call_data *api_call_msg){
     return msg->err;
 }
 
-static esp_err_t _tcp_connect(tcp_pcb * pcb, int8_t closed_slot, ip_addr_t * addr, uint16_t port, tcp_connected_fn cb) {
+static esp_err_t _tcp_connect(tcp_pcb * pcb, int32_t closed_slot, ip_addr_t * addr, uint16_t port, tcp_connected_fn cb) {
     if(!pcb){
         return ESP_FAIL;
     }
@@ -556,145 +912,11 @@ static tcp_pcb * _tcp_listen_with_backlog(tcp_pcb * pcb, uint8_t backlog) {
     return msg.pcb;
 }
 
-
-
 /*
-  Async TCP Client
+  Async TCP Client, the parts that talk to LwIP or the event queue directly.
+  Everything else is in AsyncTCPClient.cpp.
  */
 
-AsyncClient::AsyncClient(tcp_pcb* pcb)
-: _connect_cb(0)
-, _connect_cb_arg(0)
-, _discard_cb(0)
-, _discard_cb_arg(0)
-, _sent_cb(0)
-, _sent_cb_arg(0)
-, _error_cb(0)
-, _error_cb_arg(0)
-, _recv_cb(0)
-, _recv_cb_arg(0)
-, _pb_cb(0)
-, _pb_cb_arg(0)
-, _timeout_cb(0)
-, _timeout_cb_arg(0)
-, _ack_pcb(true)
-, _tx_last_packet(0)
-, _rx_timeout(0)
-, _rx_last_ack(0)
-, _ack_timeout(ASYNC_MAX_ACK_TIME)
-, _connect_port(0)
-, prev(NULL)
-, next(NULL)
-{
-    _pcb = pcb;
-    _closed_slot = -1;
-    if(_pcb){
-        _allocate_closed_slot();
-        _rx_last_packet = millis();
-        tcp_arg(_pcb, this);
-        tcp_recv(_pcb, &_tcp_recv);
-        tcp_sent(_pcb, &_tcp_sent);
-        tcp_err(_pcb, &_tcp_error);
-        tcp_poll(_pcb, &_tcp_poll, 1);
-    }
-}
-
-AsyncClient::~AsyncClient(){
-    if(_pcb) {
-        _close();
-    }
-    _free_closed_slot();
-}
-
-/*
- * Operators
- * */
-
-AsyncClient& AsyncClient::operator=(const AsyncClient& other){
-    if (_pcb) {
-        _close();
-    }
-
-    _pcb = other._pcb;
-    _closed_slot = other._closed_slot;
-    if (_pcb) {
-        _rx_last_packet = millis();
-        tcp_arg(_pcb, this);
-        tcp_recv(_pcb, &_tcp_recv);
-        tcp_sent(_pcb, &_tcp_sent);
-        tcp_err(_pcb, &_tcp_error);
-        tcp_poll(_pcb, &_tcp_poll, 1);
-    }
-    return *this;
-}
-
-bool AsyncClient::operator==(const AsyncClient &other) {
-    return _pcb == other._pcb;
-}
-
-AsyncClient & AsyncClient::operator+=(const AsyncClient &other) {
-    if(next == NULL){
-        next = (AsyncClient*)(&other);
-        next->prev = this;
-    } else {
-        AsyncClient *c = next;
-        while(c->next != NULL) {
-            c = c->next;
-        }
-        c->next =(AsyncClient*)(&other);
-        c->next->prev = c;
-    }
-    return *this;
-}
-
-/*
- * Callback Setters
- * */
-
-void AsyncClient::onConnect(AcConnectHandler cb, void* arg){
-    _connect_cb = cb;
-    _connect_cb_arg = arg;
-}
-
-void AsyncClient::onDisconnect(AcConnectHandler cb, void* arg){
-    _discard_cb = cb;
-    _discard_cb_arg = arg;
-}
-
-void AsyncClient::onAck(AcAckHandler cb, void* arg){
-    _sent_cb = cb;
-    _sent_cb_arg = arg;
-}
-
-void AsyncClient::onError(AcErrorHandler cb, void* arg){
-    _error_cb = cb;
-    _error_cb_arg = arg;
-}
-
-void AsyncClient::onData(AcDataHandler cb, void* arg){
-    _recv_cb = cb;
-    _recv_cb_arg = arg;
-}
-
-void AsyncClient::onPacket(AcPacketHandler cb, void* arg){
-  _pb_cb = cb;
-  _pb_cb_arg = arg;
-}
-
-void AsyncClient::onTimeout(AcTimeoutHandler cb, void* arg){
-    _timeout_cb = cb;
-    _timeout_cb_arg = arg;
-}
-
-void AsyncClient::onPoll(AcConnectHandler cb, void* arg){
-    _poll_cb = cb;
-    _poll_cb_arg = arg;
-}
-
-/*
- * Main Public Methods
- * */
-
 bool AsyncClient::_connect(ip_addr_t addr, uint16_t port){
     if (_pcb){
         log_w("already connected, state %d", _pcb->state);
@@ -711,31 +933,12 @@ bool AsyncClient::_connect(ip_addr_t addr, uint16_t port){
         return false;
     }
 
-    tcp_arg(pcb, this);
-    tcp_err(pcb, &_tcp_error);
-    tcp_recv(pcb, &_tcp_recv);
-    tcp_sent(pcb, &_tcp_sent);
-    tcp_poll(pcb, &_tcp_poll, 1);
+    _attach_event_owner();
+    _tcp_attach(pcb, this);
     _tcp_connect(pcb, _closed_slot, &addr, port,(tcp_connected_fn)&_tcp_connected);
     return true;
 }
 
-bool AsyncClient::connect(IPAddress ip, uint16_t port){
-    ip_addr_t addr;
-    ip_addr_set_ip4_u32(&addr, ip);
-
-    return _connect(addr, port);
-}
-
-#if LWIP_IPV6
-bool AsyncClient::connect(IPv6Address ip, uint16_t port){
-    auto ipaddr = static_cast<const uint32_t*>(ip);
-    ip_addr_t addr = IPADDR6_INIT(ipaddr[0], ipaddr[1], ipaddr[2], ipaddr[3]);
-
-    return _connect(addr, port);
-}
-#endif
-
 bool AsyncClient::connect(const char* host, uint16_t port){
     ip_addr_t addr;
 
@@ -744,6 +947,7 @@ bool AsyncClient::connect(const char* host, uint16_t port){
       return false;
     }
 
+    _attach_event_owner();
     err_t err = dns_gethostbyname(host, &addr, (dns_found_callback)&_tcp_dns_found, this);
     if(err == ERR_OK) {
 #if LWIP_IPV6
@@ -762,164 +966,58 @@ bool AsyncClient::connect(const char* host, uint16_t port){
     return false;
 }
 
-void AsyncClient::close(bool now){
-    if(_pcb){
-        _tcp_recved(_pcb, _closed_slot, _rx_ack_len);
-    }
-    _close();
-}
-
-int8_t AsyncClient::abort(){
-    if(_pcb) {
-        _tcp_abort(_pcb, _closed_slot );
-        _pcb = NULL;
-    }
-    return ERR_ABRT;
-}
-
-size_t AsyncClient::space(){
-    if((_pcb != NULL) && (_pcb->state == 4)){
-        return tcp_sndbuf(_pcb);
-    }
-    return 0;
-}
-
-size_t AsyncClient::add(const char* data, size_t size, uint8_t apiflags) {
-    if(!_pcb || size == 0 || data == NULL) {
-        return 0;
-    }
-    size_t room = space();
-    if(!room) {
-        return 0;
-    }
-    size_t will_send = (room < size) ? room : size;
-    int8_t err = ERR_OK;
-    err = _tcp_write(_pcb, _closed_slot, data, will_send, apiflags);
-    if(err != ERR_OK) {
-        return 0;
+//From any thread: the wheel belongs to the async task, so others ask it to re-check
+void AsyncClient::_rearm_timer(){
+    if(!_events || _events->dead){
+        return;
     }
-    return will_send;
-}
-
-bool AsyncClient::send(){
-    auto backup = _tx_last_packet;
-    _tx_last_packet = millis();
-    if (_tcp_output(_pcb, _closed_slot) == ERR_OK) {
-        return true;
+    if(_in_async_task_for(this)){
+        _schedule_timer();
+        return;
     }
-    _tx_last_packet = backup;
-    return false;
-}
-
-size_t AsyncClient::ack(size_t len){
-    if(len > _rx_ack_len)
-        len = _rx_ack_len;
-    if(len){
-        _tcp_recved(_pcb, _closed_slot, len);
+    //a re-check that is still waiting in the queue will do the same job
+    if(_poll_queued.exchange(true)){
+        _poll_coalesced++;
+        return;
     }
-    _rx_ack_len -= len;
-    return len;
-}
-
-void AsyncClient::ackPacket(struct pbuf * pb){
-  if(!pb){
-    return;
-  }
-  _tcp_recved(_pcb, _closed_slot, pb->len);
-  pbuf_free(pb);
-}
-
-/*
- * Main Private Methods
- * */
-
-int8_t AsyncClient::_close(){
-    //ets_printf("X: 0x%08x\n", (uint32_t)this);
-    int8_t err = ERR_OK;
-    if(_pcb) {
-        //log_i("");
-        tcp_arg(_pcb, NULL);
-        tcp_sent(_pcb, NULL);
-        tcp_recv(_pcb, NULL);
-        tcp_err(_pcb, NULL);
-        tcp_poll(_pcb, NULL, 0);
-        _tcp_clear_events(this);
-        err = _tcp_close(_pcb, _closed_slot);
-        if(err != ERR_OK) {
-            err = abort();
-        }
-        _pcb = NULL;
-        if(_discard_cb) {
-            _discard_cb(_discard_cb_arg, this);
-        }
+    lwip_event_packet_t * e = _alloc_async_event();
+    e->event = LWIP_TCP_POLL;
+    e->arg = this;
+    e->poll.pcb = _pcb;
+    if (!_send_async_event(&e)) {
+        _poll_queued = false;
+        _free_async_event(e);
     }
-    return err;
 }
 
 void AsyncClient::_allocate_closed_slot(){
-    xSemaphoreTake(_slots_lock, portMAX_DELAY);
-    uint32_t closed_slot_min_index = 0;
-    for (int i = 0; i < _number_of_closed_slots; ++ i) {
-        if ((_closed_slot == -1 || _closed_slots[i] <= closed_slot_min_index) && _closed_slots[i] != 0) {
-            closed_slot_min_index = _closed_slots[i];
-            _closed_slot = i;
-        }
+    if(!_closed_slots_ready){
+        return;
     }
-    if (_closed_slot != -1) {
-        _closed_slots[_closed_slot] = 0;
+    uint16_t index = _free_closed_slots.pop();
+    if(index == AsyncIndexStack::EMPTY){
+        //every slot is taken, calls on this client go through unchecked as before
+        return;
     }
-    xSemaphoreGive(_slots_lock);
+    uint32_t generation = _closed_slots[index].load(std::memory_order_relaxed) & 0x7FFFFF;
+    _closed_slot = (int32_t)((generation << 8) | index);
 }
 
 void AsyncClient::_free_closed_slot(){
-    if (_closed_slot != -1) {
-        _closed_slots[_closed_slot] = _closed_index;
-        _closed_slot = -1;
-        ++ _closed_index;
-    }
-}
-
-/*
- * Private Callbacks
- * */
-
-int8_t AsyncClient::_connected(void* pcb, int8_t err){
-    _pcb = reinterpret_cast<tcp_pcb*>(pcb);
-    if(_pcb){
-        _rx_last_packet = millis();
-//        tcp_recv(_pcb, &_tcp_recv);
-//        tcp_sent(_pcb, &_tcp_sent);
-//        tcp_poll(_pcb, &_tcp_poll, 1);
-    }
-    if(_connect_cb) {
-        _connect_cb(_connect_cb_arg, this);
-    }
-    return ERR_OK;
-}
-
-void AsyncClient::_error(int8_t err) {
-    if(_pcb){
-        tcp_arg(_pcb, NULL);
-        if(_pcb->state == LISTEN) {
-            tcp_sent(_pcb, NULL);
-            tcp_recv(_pcb, NULL);
-            tcp_err(_pcb, NULL);
-            tcp_poll(_pcb, NULL, 0);
-        }
-        _pcb = NULL;
-    }
-    if(_error_cb) {
-        _error_cb(_error_cb_arg, this, err);
-    }
-    if(_discard_cb) {
-        _discard_cb(_discard_cb_arg, this);
+    //only one caller gets the handle, a slot is never pushed twice
+    int32_t slot = _closed_slot.exchange(-1);
+    if (slot != -1) {
+        uint16_t index = slot & 0xFF;
+        //outstanding handles stop matching before anyone can take the slot again
+        _closed_slots[index].fetch_add(1, std::memory_order_release);
+        _free_closed_slots.push(index);
     }
 }
 
 //In LwIP Thread
 int8_t AsyncClient::_lwip_fin(tcp_pcb* pcb, int8_t err) {
     if(!_pcb || pcb != _pcb){
-        log_e("0x%08x != 0x%08x", (uint32_t)pcb, (uint32_t)_pcb);
+        log_e("%p != %p", pcb, _pcb);
         return ERR_OK;
     }
     tcp_arg(_pcb, NULL);
@@ -929,433 +1027,21 @@ int8_t AsyncClient::_lwip_fin(tcp_pcb* pcb, int8_t err) {
         tcp_err(_pcb, NULL);
         tcp_poll(_pcb, NULL, 0);
     }
-    if(tcp_close(_pcb) != ERR_OK) {
+    int8_t result = ERR_OK;
+    //unacked zero-copy data must not outlive the connection, see _close()
+    if(_tx_refs_pending || tcp_close(_pcb) != ERR_OK) {
         tcp_abort(_pcb);
+        result = ERR_ABRT;
     }
     _free_closed_slot();
     _pcb = NULL;
-    return ERR_OK;
-}
-
-//In Async Thread
-int8_t AsyncClient::_fin(tcp_pcb* pcb, int8_t err) {
-    _tcp_clear_events(this);
-    if(_discard_cb) {
-        _discard_cb(_discard_cb_arg, this);
-    }
-    return ERR_OK;
-}
-
-int8_t AsyncClient::_sent(tcp_pcb* pcb, uint16_t len) {
-    _rx_last_packet = millis();
-    _rx_last_ack = millis();
-    //log_i("%u", len);
-    if(_sent_cb) {
-        _sent_cb(_sent_cb_arg, this, len, (millis() - _tx_last_packet));
-    }
-    return ERR_OK;
-}
-
-int8_t AsyncClient::_recv(tcp_pcb* pcb, pbuf* pb, int8_t err) {
-    while(pb != NULL) {
-        _rx_last_packet = millis();
-        //we should not ack before we assimilate the data
-        _ack_pcb = true;
-        pbuf *b = pb;
-        pb = b->next;
-        b->next = NULL;
-        if(_pb_cb){
-            _pb_cb(_pb_cb_arg, this, b);
-        } else {
-            if(_recv_cb) {
-                _recv_cb(_recv_cb_arg, this, b->payload, b->len);
-            }
-            if(!_ack_pcb) {
-                _rx_ack_len += b->len;
-            } else if(_pcb) {
-                _tcp_recved(_pcb, _closed_slot, b->len);
-            }
-            pbuf_free(b);
-        }
-    }
-    return ERR_OK;
-}
-
-int8_t AsyncClient::_poll(tcp_pcb* pcb){
-    if(!_pcb){
-        log_w("pcb is NULL");
-        return ERR_OK;
-    }
-    if(pcb != _pcb){
-        log_e("0x%08x != 0x%08x", (uint32_t)pcb, (uint32_t)_pcb);
-        return ERR_OK;
-    }
-
-    uint32_t now = millis();
-
-    // ACK Timeout
-    if(_ack_timeout){
-        const uint32_t one_day = 86400000;
-        bool last_tx_is_after_last_ack = (_rx_last_ack - _tx_last_packet + one_day) < one_day;
-        if(last_tx_is_after_last_ack && (now - _tx_last_packet) >= _ack_timeout) {
-            log_w("ack timeout %d", pcb->state);
-            if(_timeout_cb)
-                _timeout_cb(_timeout_cb_arg, this, (now - _tx_last_packet));
-            return ERR_OK;
-        }
-    }
-    // RX Timeout
-    if(_rx_timeout && (now - _rx_last_packet) >= (_rx_timeout * 1000)) {
-        log_w("rx timeout %d", pcb->state);
-        _close();
-        return ERR_OK;
-    }
-    // Everything is fine
-    if(_poll_cb) {
-        _poll_cb(_poll_cb_arg, this);
-    }
-    return ERR_OK;
-}
-
-void AsyncClient::_dns_found(struct ip_addr *ipaddr){
-    if(ipaddr && IP_IS_V4(ipaddr)){
-        connect(IPAddress(ip_addr_get_ip4_u32(ipaddr)), _connect_port);
-#if LWIP_IPV6
-    } else if(ipaddr && ipaddr->u_addr.ip6.addr){
-        connect(IPv6Address(ipaddr->u_addr.ip6.addr), _connect_port);
-#endif
-    } else {
-        if(_error_cb) {
-            _error_cb(_error_cb_arg, this, -55);
-        }
-        if(_discard_cb) {
-            _discard_cb(_discard_cb_arg, this);
-        }
-    }
-}
-
-/*
- * Public Helper Methods
- * */
-
-void AsyncClient::stop() {
-    close(false);
-}
-
-bool AsyncClient::free(){
-    if(!_pcb) {
-        return true;
-    }
-    if(_pcb->state == 0 || _pcb->state > 4) {
-        return true;
-    }
-    return false;
-}
-
-size_t AsyncClient::write(const char* data) {
-    if(data == NULL) {
-        return 0;
-    }
-    return write(data, strlen(data));
-}
-
-size_t AsyncClient::write(const char* data, size_t size, uint8_t apiflags) {
-    size_t will_send = add(data, size, apiflags);
-    if(!will_send || !send()) {
-        return 0;
-    }
-    return will_send;
-}
-
-void AsyncClient::setRxTimeout(uint32_t timeout){
-    _rx_timeout = timeout;
-}
-
-uint32_t AsyncClient::getRxTimeout(){
-    return _rx_timeout;
-}
-
-uint32_t AsyncClient::getAckTimeout(){
-    return _ack_timeout;
-}
-
-void AsyncClient::setAckTimeout(uint32_t timeout){
-    _ack_timeout = timeout;
-}
-
-void AsyncClient::setNoDelay(bool nodelay){
-    if(!_pcb) {
-        return;
-    }
-    if(nodelay) {
-        tcp_nagle_disable(_pcb);
-    } else {
-        tcp_nagle_enable(_pcb);
-    }
-}
-
-bool AsyncClient::getNoDelay(){
-    if(!_pcb) {
-        return false;
-    }
-    return tcp_nagle_disabled(_pcb);
-}
-
-uint16_t AsyncClient::getMss(){
-    if(!_pcb) {
-        return 0;
-    }
-    return tcp_mss(_pcb);
-}
-
-uint32_t AsyncClient::getRemoteAddress() {
-    if(!_pcb) {
-        return 0;
-    }
-#if LWIP_IPV4 && LWIP_IPV6
-    return _pcb->remote_ip.u_addr.ip4.addr;
-#else
-    return _pcb->remote_ip.addr;
-#endif
-}
-
-#if LWIP_IPV6
-ip6_addr_t AsyncClient::getRemoteAddress6() {
-    if(!_pcb) {
-        ip6_addr_t nulladdr;
-        ip6_addr_set_zero(&nulladdr);
-        return nulladdr;
-    }
-    return _pcb->remote_ip.u_addr.ip6;
-}
-
-ip6_addr_t AsyncClient::getLocalAddress6() {
-    if(!_pcb) {
-        ip6_addr_t nulladdr;
-        ip6_addr_set_zero(&nulladdr);
-        return nulladdr;
-    }
-    return _pcb->local_ip.u_addr.ip6;
-}
-
-IPv6Address AsyncClient::remoteIP6() {
-    return IPv6Address(getRemoteAddress6().addr);
-}
-
-IPv6Address AsyncClient::localIP6() {
-    return IPv6Address(getLocalAddress6().addr);
-}
-#endif
-
-uint16_t AsyncClient::getRemotePort() {
-    if(!_pcb) {
-        return 0;
-    }
-    return _pcb->remote_port;
-}
-
-uint32_t AsyncClient::getLocalAddress() {
-    if(!_pcb) {
-        return 0;
-    }
-#if LWIP_IPV4 && LWIP_IPV6
-    return _pcb->local_ip.u_addr.ip4.addr;
-#else
-    return _pcb->local_ip.addr;
-#endif
-}
-
-uint16_t AsyncClient::getLocalPort() {
-    if(!_pcb) {
-        return 0;
-    }
-    return _pcb->local_port;
-}
-
-IPAddress AsyncClient::remoteIP() {
-    return IPAddress(getRemoteAddress());
-}
-
-uint16_t AsyncClient::remotePort() {
-    return getRemotePort();
-}
-
-IPAddress AsyncClient::localIP() {
-    return IPAddress(getLocalAddress());
-}
-
-
-uint16_t AsyncClient::localPort() {
-    return getLocalPort();
-}
-
-uint8_t AsyncClient::state() {
-    if(!_pcb) {
-        return 0;
-    }
-    return _pcb->state;
-}
-
-bool AsyncClient::connected(){
-    if (!_pcb) {
-        return false;
-    }
-    return _pcb->state == 4;
-}
-
-bool AsyncClient::connecting(){
-    if (!_pcb) {
-        return false;
-    }
-    return _pcb->state > 0 && _pcb->state < 4;
-}
-
-bool AsyncClient::disconnecting(){
-    if (!_pcb) {
-        return false;
-    }
-    return _pcb->state > 4 && _pcb->state < 10;
-}
-
-bool AsyncClient::disconnected(){
-    if (!_pcb) {
-        return true;
-    }
-    return _pcb->state == 0 || _pcb->state == 10;
-}
-
-bool AsyncClient::freeable(){
-    if (!_pcb) {
-        return true;
-    }
-    return _pcb->state == 0 || _pcb->state > 4;
-}
-
-bool AsyncClient::canSend(){
-    return space() > 0;
-}
-
-const char * AsyncClient::errorToString(int8_t error){
-    switch(error){
-        case ERR_OK: return "OK";
-        case ERR_MEM: return "Out of memory error";
-        case ERR_BUF: return "Buffer error";
-        case ERR_TIMEOUT: return "Timeout";
-        case ERR_RTE: return "Routing problem";
-        case ERR_INPROGRESS: return "Operation in progress";
-        case ERR_VAL: return "Illegal value";
-        case ERR_WOULDBLOCK: return "Operation would block";
-        case ERR_USE: return "Address in use";
-        case ERR_ALREADY: return "Already connected";
-        case ERR_CONN: return "Not connected";
-        case ERR_IF: return "Low-level netif error";
-        case ERR_ABRT: return "Connection aborted";
-        case ERR_RST: return "Connection reset";
-        case ERR_CLSD: return "Connection closed";
-        case ERR_ARG: return "Illegal argument";
-        case -55: return "DNS failed";
-        default: return "UNKNOWN";
-    }
-}
-
-const char * AsyncClient::stateToString(){
-    switch(state()){
-        case 0: return "Closed";
-        case 1: return "Listen";
-        case 2: return "SYN Sent";
-        case 3: return "SYN Received";
-        case 4: return "Established";
-        case 5: return "FIN Wait 1";
-        case 6: return "FIN Wait 2";
-        case 7: return "Close Wait";
-        case 8: return "Closing";
-        case 9: return "Last ACK";
-        case 10: return "Time Wait";
-        default: return "UNKNOWN";
-    }
-}
-
-/*
- * Static Callbacks (LwIP C2C++ interconnect)
- * */
-
-void AsyncClient::_s_dns_found(const char * name, struct ip_addr * ipaddr, void * arg){
-    reinterpret_cast<AsyncClient*>(arg)->_dns_found(ipaddr);
-}
-
-int8_t AsyncClient::_s_poll(void * arg, struct tcp_pcb * pcb) {
-    return reinterpret_cast<AsyncClient*>(arg)->_poll(pcb);
-}
-
-int8_t AsyncClient::_s_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_t err) {
-    return reinterpret_cast<AsyncClient*>(arg)->_recv(pcb, pb, err);
-}
-
-int8_t AsyncClient::_s_fin(void * arg, struct tcp_pcb * pcb, int8_t err) {
-    return reinterpret_cast<AsyncClient*>(arg)->_fin(pcb, err);
-}
-
-int8_t AsyncClient::_s_lwip_fin(void * arg, struct tcp_pcb * pcb, int8_t err) {
-    return reinterpret_cast<AsyncClient*>(arg)->_lwip_fin(pcb, err);
-}
-
-int8_t AsyncClient::_s_sent(void * arg, struct tcp_pcb * pcb, uint16_t len) {
-    return reinterpret_cast<AsyncClient*>(arg)->_sent(pcb, len);
-}
-
-void AsyncClient::_s_error(void * arg, int8_t err) {
-    reinterpret_cast<AsyncClient*>(arg)->_error(err);
-}
-
-int8_t AsyncClient::_s_connected(void * arg, void * pcb, int8_t err){
-    return reinterpret_cast<AsyncClient*>(arg)->_connected(pcb, err);
+    return result;
 }
 
 /*
   Async TCP Server
  */
 
-AsyncServer::AsyncServer(IPAddress addr, uint16_t port)
-: _port(port)
-, _bind4(true)
-, _addr(addr)
-, _noDelay(false)
-, _pcb(0)
-, _connect_cb(0)
-, _connect_cb_arg(0)
-{}
-
-AsyncServer::AsyncServer(IPv6Address addr, uint16_t port)
-: _port(port)
-, _bind6(true)
-, _addr6(addr)
-, _noDelay(false)
-, _pcb(0)
-, _connect_cb(0)
-, _connect_cb_arg(0)
-{}
-
-AsyncServer::AsyncServer(uint16_t port)
-: _port(port)
-, _bind4(true)
-, _bind6(true)
-, _addr((uint32_t) IPADDR_ANY)
-, _addr6()
-, _noDelay(false)
-, _pcb(0)
-, _connect_cb(0)
-, _connect_cb_arg(0)
-{}
-
-AsyncServer::~AsyncServer(){
-    end();
-}
-
-void AsyncServer::onClient(AcConnectHandler cb, void* arg){
-    _connect_cb = cb;
-    _connect_cb_arg = arg;
-}
-
 void AsyncServer::begin(){
     if(_pcb) {
         return;
@@ -1431,33 +1117,3 @@ int8_t AsyncServer::_accept(tcp_pcb* pcb, int8_t err){
     log_e("FAIL");
     return ERR_OK;
 }
-
-int8_t AsyncServer::_accepted(AsyncClient* client){
-    if(_connect_cb){
-        _connect_cb(_connect_cb_arg, client);
-    }
-    return ERR_OK;
-}
-
-void AsyncServer::setNoDelay(bool nodelay){
-    _noDelay = nodelay;
-}
-
-bool AsyncServer::getNoDelay(){
-    return _noDelay;
-}
-
-uint8_t AsyncServer::status(){
-    if (!_pcb) {
-        return 0;
-    }
-    return _pcb->state;
-}
-
-int8_t AsyncServer::_s_accept(void * arg, tcp_pcb * pcb, int8_t err){
-    return reinterpret_cast<AsyncServer*>(arg)->_accept(pcb, err);
-}
-
-int8_t AsyncServer::_s_accepted(void *arg, AsyncClient* client){
-    return reinterpret_cast<AsyncServer*>(arg)->_accepted(client);
-}
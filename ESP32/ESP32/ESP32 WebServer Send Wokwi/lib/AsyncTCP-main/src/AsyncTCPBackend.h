@@ -0,0 +1,106 @@
+/*
+  Asynchronous TCP library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ASYNCTCPBACKEND_H_
+#define ASYNCTCPBACKEND_H_
+
+/*
+ * What AsyncTCPClient.cpp needs from a backend, not part of the public API.
+ * AsyncClient and AsyncServer are written once against it. A backend moves
+ * data and events between them and the network: AsyncTCP.cpp does it with
+ * LwIP and the async_tcp tasks on the board, host/src/AsyncTCPHost.cpp with
+ * sockets and one epoll thread on Linux.
+ * */
+
+#include "AsyncTCP.h"
+#include "AsyncTCPTimer.h"
+extern "C"{
+#include "lwip/opt.h"
+#include "lwip/tcp.h"
+#include "lwip/err.h"
+}
+
+/*
+ * Every connection owns a small tombstone that its pending events and its
+ * timer point to. Closing the connection marks it dead in O(1), and events
+ * that show up afterwards are dropped. The client, each pending event and
+ * an armed timer hold a reference; the last one frees it.
+ * */
+
+struct async_event_owner {
+    async_timer_node_t timer;       //in the wheel of the client's async task, only that task touches it
+    std::atomic<uint32_t> refs;
+    std::atomic<bool> dead;
+    std::atomic<uint32_t> due;      //millis() at which the timer fires, 0 while not armed
+    AsyncClient * client;
+};
+
+/*
+ * Zero-copy sends
+ * The stack keeps pointing into buffers written without ASYNC_WRITE_FLAG_COPY
+ * until the peer acks them. Each such write is queued with the stream offset
+ * right after its last byte and released, oldest first, once the acked byte
+ * count has passed it. One lock covers the queues of all connections, it is
+ * never held across a call into the stack or a release callback. The records
+ * come from a pool, so a zero-copy write does not touch the heap.
+ * */
+
+struct async_tx_ref {
+    async_tx_ref * next;
+    uint32_t end;
+    const char * data;
+    AcReleaseHandler cb;
+    void * arg;
+};
+
+//set up by the backend when it starts
+extern AsyncObjectPool<AsyncClient> _client_pool;
+extern AsyncObjectPool<async_tx_ref> _tx_ref_pool;
+extern SemaphoreHandle_t _tx_refs_lock;
+
+async_event_owner * _new_event_owner(AsyncClient * client);
+void _release_event_owner(async_event_owner * owner);
+//from anywhere, nothing pending of the connection reaches the client afterwards
+void _kill_event_owner(async_event_owner * owner);
+int8_t _tcp_clear_events(void * arg);
+
+//in the client's async task only
+void _arm_event_timer(async_event_owner * owner, uint32_t due);
+void _disarm_event_timer(async_event_owner * owner);
+
+//the callbacks of the pcb go to client, or nowhere before it is closed
+void _tcp_attach(tcp_pcb * pcb, AsyncClient * client);
+void _tcp_detach(tcp_pcb * pcb);
+
+/*
+ * TCP/IP API Calls
+ * From any thread. A call with the handle of a closed slot does nothing and
+ * returns ERR_CONN, see AsyncClient::_allocate_closed_slot().
+ * */
+
+int8_t _tcp_output(tcp_pcb * pcb, int32_t closed_slot);
+//every segment in order until the window is full, and tcp_output() with output
+int8_t _tcp_writev(tcp_pcb * pcb, int32_t closed_slot, const async_tcp_segment_t * segments, size_t count, bool output, size_t * written);
+int8_t _tcp_recved(tcp_pcb * pcb, int32_t closed_slot, size_t len);
+int8_t _tcp_close(tcp_pcb * pcb, int32_t closed_slot);
+int8_t _tcp_abort(tcp_pcb * pcb, int32_t closed_slot);
+
+#endif /* ASYNCTCPBACKEND_H_ */
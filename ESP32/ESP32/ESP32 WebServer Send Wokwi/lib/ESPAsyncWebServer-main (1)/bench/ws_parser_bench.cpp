@@ -0,0 +1,312 @@
+/*
+  Host fuzz and benchmark: WebSocket frames cut into random pieces
+
+  A client connects over the loopback and upgrades, then its connection is
+  left alone: the stream a browser would send is handed to _onData() of the
+  server side client directly, cut where this program wants, every piece in
+  a heap buffer of its own size so AddressSanitizer (-fsanitize=address)
+  sees a read past it.
+
+  The stream holds text and binary messages of 0 to 70000 bytes, split
+  into 1 to 3 frames, masked with a new key each, with pings of 0 to 125
+  bytes between the frames. Every message must arrive whole and in order,
+  with the right message_opcode, and every ping must come back as a pong
+  with its payload, on the socket.
+
+  "fuzz" cuts each round at random, from single bytes to 16 KB, once as
+  WS_EVT_DATA comes for every piece and once with wholeMessages(), where it
+  must come once per message; the messages handed over in the read buffer,
+  without a copy, are counted. The benchmark then feeds 4 MB of it in
+  pieces of a fixed size, both ways. Last, a message over the limit must
+  close the connection with 1009.
+*/
+
+//Build and run on the host, against the Linux backend of AsyncTCP:
+//  g++ -O2 -std=gnu++17 -I../../AsyncTCP-main/host/include -I../../AsyncTCP-main/src -I../src ws_parser_bench.cpp ../src/*.cpp ../../AsyncTCP-main/src/AsyncTCPClient.cpp ../../AsyncTCP-main/host/src/*.cpp -o ws_parser_bench -lpthread
+//  ./ws_parser_bench [rounds] [seed] [port]
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+struct Message {
+    uint8_t opcode;
+    std::string payload;
+};
+
+static AsyncWebSocketClient *target = NULL;
+static std::vector<Message> expected;
+static size_t delivered = 0;
+static size_t failures = 0;
+static std::string current;
+static bool verify = true;
+static const uint8_t *piece = NULL;
+static size_t pieceLen = 0;
+static size_t inPlace = 0;
+
+static void onEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len){
+    if(type == WS_EVT_CONNECT){
+        target = client;
+        return;
+    }
+    if(type != WS_EVT_DATA){
+        return;
+    }
+    AwsFrameInfo *info = (AwsFrameInfo *)arg;
+    if(server->wholeMessages()){
+        if(info->index || info->len != len || !info->final || info->num || info->opcode != info->message_opcode){
+            failures++;
+        }
+        if(data >= piece && data + len <= piece + pieceLen){
+            inPlace++;
+        }
+    }
+    if(verify){
+        current.append((const char *)data, len);
+    }
+    if(!info->final || info->index + len != info->len){
+        return;
+    }
+    if(verify){
+        if(delivered >= expected.size() || expected[delivered].opcode != info->message_opcode || expected[delivered].payload != current){
+            if(failures++ < 5){
+                printf("message %u: %u bytes, opcode %u, does not match\n", (unsigned)delivered, (unsigned)current.size(), info->message_opcode);
+            }
+        }
+        current.clear();
+    }
+    delivered++;
+}
+
+static int connectTo(uint16_t port){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void frame(std::string &stream, std::mt19937 &rng, bool final, uint8_t opcode, const char *payload, size_t len){
+    uint8_t head[14];
+    size_t headLen = 2;
+    head[0] = (final ? 0x80 : 0) | opcode;
+    if(len < 126){
+        head[1] = 0x80 | len;
+    } else if(len < 65536){
+        head[1] = 0x80 | 126;
+        head[2] = len >> 8;
+        head[3] = len;
+        headLen = 4;
+    } else {
+        head[1] = 0x80 | 127;
+        for(int i = 0; i < 8; i++){
+            head[9 - i] = (uint8_t)((uint64_t)len >> (8 * i));
+        }
+        headLen = 10;
+    }
+    uint8_t *mask = head + headLen;
+    for(int i = 0; i < 4; i++){
+        mask[i] = rng();
+    }
+    stream.append((const char *)head, headLen + 4);
+    for(size_t i = 0; i < len; i++){
+        stream.push_back(payload[i] ^ mask[i % 4]);
+    }
+}
+
+static size_t length(std::mt19937 &rng){
+    switch(rng() % 8){
+        case 0: return 0;
+        case 1: return 126 + rng() % (65536 - 126);
+        case 2: return 65536 + rng() % 5000;
+        default: return rng() % 126;
+    }
+}
+
+//one round of messages, returns the pongs that must come back
+static std::string generate(std::string &stream, std::mt19937 &rng, uint32_t messages){
+    std::string pongs;
+    for(uint32_t m = 0; m < messages; m++){
+        Message message;
+        message.opcode = (rng() & 1) ? WS_TEXT : WS_BINARY;
+        size_t len = length(rng);
+        for(size_t i = 0; i < len; i++){
+            message.payload.push_back((message.opcode == WS_TEXT) ? ('a' + rng() % 26) : (char)rng());
+        }
+        uint32_t frames = 1 + rng() % 3;
+        size_t sent = 0;
+        for(uint32_t f = 0; f < frames; f++){
+            size_t part = (f + 1 == frames) ? len - sent : (len - sent) * (rng() % 100) / 100;
+            frame(stream, rng, f + 1 == frames, f ? (uint8_t)WS_CONTINUATION : message.opcode, message.payload.data() + sent, part);
+            sent += part;
+            if(rng() % 4 == 0){
+                std::string ping;
+                size_t n = rng() % 126;
+                for(size_t i = 0; i < n; i++){
+                    ping.push_back((char)rng());
+                }
+                frame(stream, rng, true, WS_PING, ping.data(), n);
+                pongs.push_back((char)(0x80 | WS_PONG));
+                pongs.push_back((char)n);
+                pongs += ping;
+            }
+        }
+        expected.push_back(message);
+    }
+    return pongs;
+}
+
+//hands the stream to the client in pieces from pieceOf(), each in its own buffer
+template<typename F>
+static void feed(const std::string &stream, F pieceOf){
+    size_t offset = 0;
+    while(offset < stream.size()){
+        size_t n = pieceOf();
+        if(n > stream.size() - offset){
+            n = stream.size() - offset;
+        }
+        uint8_t *buffer = (uint8_t *)malloc(n);
+        memcpy(buffer, stream.data() + offset, n);
+        piece = buffer;
+        pieceLen = n;
+        target->_onData(buffer, n);
+        free(buffer);
+        offset += n;
+    }
+}
+
+static bool readPongs(int fd, const std::string &pongs){
+    std::string got;
+    char buf[4096];
+    while(got.size() < pongs.size()){
+        ssize_t r = recv(fd, buf, sizeof(buf), 0);
+        if(r <= 0){
+            break;
+        }
+        got.append(buf, r);
+    }
+    return got == pongs;
+}
+
+static double now_s(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//rounds of messages cut at random, every message and pong checked
+static bool fuzz(int fd, std::mt19937 &rng, uint32_t rounds, const char *name){
+    expected.clear();
+    delivered = 0;
+    inPlace = 0;
+    size_t bytes = 0;
+    size_t pongFailures = 0;
+    for(uint32_t r = 0; r < rounds; r++){
+        std::string stream;
+        std::string pongs = generate(stream, rng, 8);
+        uint32_t style = rng() % 3;
+        feed(stream, [&]() -> size_t {
+            switch(style){
+                case 0: return 1 + rng() % 16;
+                case 1: return 1 + rng() % 1460;
+                default: return 1 + rng() % 16384;
+            }
+        });
+        bytes += stream.size();
+        if(!readPongs(fd, pongs)){
+            pongFailures++;
+        }
+    }
+    bool ok = !failures && !pongFailures && delivered == expected.size();
+    printf("fuzz, %s: %u rounds, %u messages, %.1f MB in random pieces: %s\n", name, rounds, (unsigned)delivered, bytes / 1e6,
+        ok ? "all delivered intact" : "FAILED");
+    if(!ok){
+        printf("%u bad messages, %u of %u delivered, %u rounds with wrong pongs\n", (unsigned)failures,
+            (unsigned)delivered, (unsigned)expected.size(), (unsigned)pongFailures);
+    } else if(inPlace){
+        printf("  %u of them handed over in the read buffer\n", (unsigned)inPlace);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv){
+    uint32_t rounds = (argc > 1) ? atoi(argv[1]) : 200;
+    uint32_t seed = (argc > 2) ? atoi(argv[2]) : 1;
+    uint16_t port = (argc > 3) ? atoi(argv[3]) : 18095;
+
+    AsyncWebServer server(port);
+    AsyncWebSocket ws("/ws");
+    ws.onEvent(onEvent);
+    server.addHandler(&ws);
+    server.begin();
+
+    int fd = connectTo(port);
+    const char *upgrade = "GET /ws HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    send(fd, upgrade, strlen(upgrade), 0);
+    std::string head;
+    char c;
+    while(head.find("\r\n\r\n") == std::string::npos && recv(fd, &c, 1, 0) == 1){
+        head.push_back(c);
+    }
+    struct timeval timeout = { 5, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    while(target == NULL){
+        delay(1);
+    }
+
+    std::mt19937 rng(seed);
+    ws.wholeMessages(0);
+    if(!fuzz(fd, rng, rounds, "every piece")){
+        return 1;
+    }
+    ws.wholeMessages(1 << 20);
+    if(!fuzz(fd, rng, rounds, "whole messages")){
+        return 1;
+    }
+
+    //the same kind of stream without pings, fed in pieces of one size
+    verify = false;
+    std::string stream;
+    while(stream.size() < 4000000){
+        std::string one;
+        std::string pongs = generate(one, rng, 1);
+        if(pongs.empty()){
+            stream += one;
+        }
+    }
+    printf("%7s | %11s | %14s\n", "pieces", "every piece", "whole messages");
+    for(size_t size : { 1, 7, 64, 536, 1460, 16384 }){
+        double rate[2];
+        for(int whole = 0; whole < 2; whole++){
+            ws.wholeMessages(whole ? (1 << 20) : 0);
+            double start = now_s();
+            feed(stream, [size]() -> size_t { return size; });
+            rate[whole] = stream.size() / (now_s() - start) / 1e6;
+        }
+        printf("%5u B | %6.0f MB/s | %9.0f MB/s\n", (unsigned)size, rate[0], rate[1]);
+    }
+
+    //a message over the limit closes the connection with 1009
+    ws.wholeMessages(1000);
+    std::string big(2000, 'x');
+    std::string tooLong;
+    frame(tooLong, rng, true, WS_TEXT, big.data(), big.size());
+    feed(tooLong, []() -> size_t { return 500; });
+    bool refused = readPongs(fd, std::string("\x88\x02\x03\xf1", 4));
+    printf("2000 bytes with a limit of 1000: %s\n", refused ? "closed with 1009" : "NOT REFUSED");
+    close(fd);
+    return refused ? 0 : 1;
+}
@@ -154,10 +154,29 @@ size_t AsyncEventSourceMessage::write_buffer(AsyncClient *client) {
 }
 
 size_t AsyncEventSourceMessage::send(AsyncClient *client) {
+#if defined(ESP32)
+  async_tcp_segment_t segment = pending();
+  return written(client->writev(&segment, 1));
+#else
   size_t sent = write_buffer(client);
   client->send();
   return sent;
+#endif
+}
+
+#if defined(ESP32)
+async_tcp_segment_t AsyncEventSourceMessage::pending() const {
+  async_tcp_segment_t segment = { (const char *)_data + _sent, _len - _sent, ASYNC_WRITE_FLAG_COPY };
+  return segment;
+}
+
+size_t AsyncEventSourceMessage::written(size_t len) {
+  if(len > _len - _sent)
+    len = _len - _sent;
+  _sent += len;
+  return len;
 }
+#endif
 
 // Client
 
@@ -182,6 +201,7 @@ AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, A
   delete request;
 
   _client->setNoDelay(true);
+  _schedulePoll();
 }
 
 AsyncEventSourceClient::~AsyncEventSourceClient(){
@@ -211,6 +231,8 @@ bool AsyncEventSourceClient::_tryQueueMessage(AsyncEventSourceMessage *dataMessa
   }
   if(_client->canSend())
     _runQueue();
+  else
+    _schedulePoll();
   return ret;
 }
 
@@ -265,6 +287,24 @@ void AsyncEventSourceClient::_runQueue(){
 #endif // ESP32
 
   size_t total_bytes_written = 0;
+#if defined(ESP32)
+  //everything that is waiting goes out with one call into the TCP stack
+  async_tcp_segment_t segments[SSE_MAX_QUEUED_MESSAGES];
+  size_t count = 0;
+  for(auto i = _messageQueue.begin(); i != _messageQueue.end() && count < SSE_MAX_QUEUED_MESSAGES; ++i)
+  {
+    if(!(*i)->sent())
+      segments[count++] = (*i)->pending();
+  }
+  if(count && _client->canSend())
+    total_bytes_written = _client->writev(segments, count);
+  size_t left = total_bytes_written;
+  for(auto i = _messageQueue.begin(); i != _messageQueue.end() && left; ++i)
+  {
+    if(!(*i)->sent())
+      left -= (*i)->written(left);
+  }
+#else
   for(auto i = _messageQueue.begin(); i != _messageQueue.end(); ++i)
   {
     if(!(*i)->sent()) {
@@ -276,6 +316,7 @@ void AsyncEventSourceClient::_runQueue(){
   }
   if(total_bytes_written > 0)
     _client->send();
+#endif
 
   size_t len = total_bytes_written;
   while(len && !_messageQueue.isEmpty()){
@@ -290,6 +331,15 @@ void AsyncEventSourceClient::_runQueue(){
 #else
   this->_messageQueue_processing = false;
 #endif // ESP32
+  _schedulePoll();
+}
+
+//only poll while something is waiting to be retried
+void AsyncEventSourceClient::_schedulePoll(){
+#if defined(ESP32)
+  if(_client != NULL)
+    _client->setPollInterval(_messageQueue.isEmpty() ? 0 : ASYNC_POLL_INTERVAL);
+#endif
 }
 
 
@@ -394,7 +444,21 @@ size_t AsyncEventSource::count() const {
 }
 
 bool AsyncEventSource::canHandle(AsyncWebServerRequest *request){
-  if(request->method() != HTTP_GET || !request->url().equals(_url)) {
+  if(!AsyncWebRouter::match(request, ROUTE_EXACT, _url.c_str(), _url.length()) || !canHandleRoute(request)) {
+    return false;
+  }
+  AsyncWebRouter::capture(request, _url.c_str(), _url.length());
+  return true;
+}
+
+WebRouteMode AsyncEventSource::route(const char *&pattern, size_t &length){
+  pattern = _url.c_str();
+  length = _url.length();
+  return ROUTE_EXACT;
+}
+
+bool AsyncEventSource::canHandleRoute(AsyncWebServerRequest *request){
+  if(request->method() != HTTP_GET) {
     return false;
   }
   request->addInterestingHeader("Last-Event-ID");
@@ -27,6 +27,10 @@
 #include "FS.h"
 
 #include "StringArray.h"
+#include "WebArena.h"
+#include "WebRouter.h"
+#include "WebTemplate.h"
+#include "WebJson.h"
 
 #if defined(ESP32) || defined(LIBRETINY)
 #include <WiFi.h>
@@ -46,6 +50,63 @@
 
 #define DEBUGF(...) //Serial.printf(__VA_ARGS__)
 
+//HTTP/1.1 persistent connections: seconds a connection may sit idle between
+//requests (0 closes after every response) and requests served on one connection
+#ifndef ASYNCWEBSERVER_KEEPALIVE_TIMEOUT
+#define ASYNCWEBSERVER_KEEPALIVE_TIMEOUT 5
+#endif
+#ifndef ASYNCWEBSERVER_KEEPALIVE_MAX
+#define ASYNCWEBSERVER_KEEPALIVE_MAX 100
+#endif
+//bytes of pipelined requests held while the request before them is still queued
+#ifndef ASYNCWEBSERVER_PIPELINE_BUFFER
+#define ASYNCWEBSERVER_PIPELINE_BUFFER 2048
+#endif
+//request line and headers together, a longer head is answered with 400
+#ifndef ASYNCWEBSERVER_MAX_HEAD_LENGTH
+#define ASYNCWEBSERVER_MAX_HEAD_LENGTH 4096
+#endif
+
+#if defined(ESP32)
+//requests reserved by AsyncWebServer::begin(), one per connection LwIP allows
+#ifndef ASYNCWEBSERVER_REQUEST_POOL_SIZE
+#define ASYNCWEBSERVER_REQUEST_POOL_SIZE CONFIG_ASYNC_TCP_CLIENT_POOL_SIZE
+#endif
+#endif
+
+//How long browsers keep an asset before they ask again, with If-None-Match
+#ifndef ASYNCWEBSERVER_ASSET_CACHE_CONTROL
+#define ASYNCWEBSERVER_ASSET_CACHE_CONTROL "public, max-age=604800"
+#endif
+
+//Responses fill each TCP write in a transmit buffer of this many segments,
+//by default the whole send buffer of the ESP32 LwIP (TCP_SND_BUF, 4 MSS)
+#ifndef ASYNCWEBSERVER_TX_MSS
+#ifdef CONFIG_LWIP_TCP_MSS
+#define ASYNCWEBSERVER_TX_MSS CONFIG_LWIP_TCP_MSS
+#else
+#define ASYNCWEBSERVER_TX_MSS 1436
+#endif
+#endif
+#ifndef ASYNCWEBSERVER_TX_SEGMENTS
+#define ASYNCWEBSERVER_TX_SEGMENTS 4
+#endif
+#define ASYNCWEBSERVER_TX_BUFFER_SIZE (ASYNCWEBSERVER_TX_MSS * ASYNCWEBSERVER_TX_SEGMENTS)
+
+#if defined(ESP32)
+//transmit buffers reserved by AsyncWebServer::begin(). A response only holds
+//one while it fills a write, so a couple serve every connection
+#ifndef ASYNCWEBSERVER_TX_POOL_SIZE
+#define ASYNCWEBSERVER_TX_POOL_SIZE 2
+#endif
+
+typedef struct {
+  async_pool_stats_t pool;    //hits and misses together are the writes filled, misses came from the heap
+  uint32_t responses;         //responses sent to the end through a transmit buffer
+  uint64_t bytes;             //bytes written from transmit buffers
+} async_tx_stats_t;
+#endif
+
 class AsyncWebServer;
 class AsyncWebServerRequest;
 class AsyncWebServerResponse;
@@ -54,6 +115,7 @@ class AsyncWebParameter;
 class AsyncWebRewrite;
 class AsyncWebHandler;
 class AsyncStaticWebHandler;
+class AsyncAssetWebHandler;
 class AsyncCallbackWebHandler;
 class AsyncResponseStream;
 
@@ -91,6 +153,7 @@ class AsyncWebParameter {
   public:
 
     AsyncWebParameter(const String& name, const String& value, bool form=false, bool file=false, size_t size=0): _name(name), _value(value), _size(size), _isForm(form), _isFile(file){}
+    AsyncWebParameter(String&& name, String&& value, bool form=false, bool file=false, size_t size=0): _name(std::move(name)), _value(std::move(value)), _size(size), _isForm(form), _isFile(file){}
     const String& name() const { return _name; }
     const String& value() const { return _value; }
     size_t size() const { return _size; }
@@ -109,6 +172,7 @@ class AsyncWebHeader {
 
   public:
     AsyncWebHeader(const String& name, const String& value): _name(name), _value(value){}
+    AsyncWebHeader(String&& name, String&& value): _name(std::move(name)), _value(std::move(value)){}
     AsyncWebHeader(const String& data): _name(), _value(){
       if(!data) return;
       int index = data.indexOf(':');
@@ -136,14 +200,48 @@ class AsyncWebServerRequest {
   using FS = fs::FS;
   friend class AsyncWebServer;
   friend class AsyncCallbackWebHandler;
+  friend class AsyncWebRouter;
   private:
     AsyncClient* _client;
+    AsyncWebServerRequest* _next;   //pipelined request parsed while this one is answered
+    uint8_t *_pipelined;            //raw bytes after _next, replayed once _next is answered
+    size_t _pipelinedLength;
+    size_t _ackDebt;                //acks still owed to the previous response on the connection
+    uint16_t _requestCount;         //position on the connection, 1 for the first request
+    bool _active;                   //owns the client callbacks and may respond
+    bool _keepAlive;
     AsyncWebServer* _server;
     AsyncWebHandler* _handler;
     AsyncWebServerResponse* _response;
-    StringArray _interestingHeaders;
     ArDisconnectHandler _onDisconnectfn;
 
+    //A header as it came in, name and value point into _arena. The AsyncWebHeader
+    //is only made, in _arena too, when a handler asks for it with getHeader().
+    struct HeaderSlice {
+      const char* name;
+      const char* value;
+      uint16_t nameLength;
+      uint16_t valueLength;
+      AsyncWebHeader* header;
+      HeaderSlice* next;
+    };
+
+    //A {name} segment or regex group, a span of _url. The String is only made,
+    //in _arena, when a handler asks for it with pathArg(i).
+    struct PathSlice {
+      size_t offset;
+      size_t length;
+      String* value;
+    };
+
+    //Headers, parameters and path parameters live here and go in one step
+    //when the request is deleted, see ASYNCWEBSERVER_ARENA_BLOCK
+    mutable AsyncWebArena _arena;
+    AsyncWebArenaList<const char *> _interestingHeaders;
+    char* _line;                    //head line being received, in _arena
+    size_t _lineLength;
+    size_t _headLength;
+
     String _temp;
     uint8_t _parseState;
 
@@ -163,9 +261,11 @@ class AsyncWebServerRequest {
     size_t _contentLength;
     size_t _parsedLength;
 
-    LinkedList<AsyncWebHeader *> _headers;
-    LinkedList<AsyncWebParameter *> _params;
-    LinkedList<String *> _pathParams;
+    HeaderSlice* _headers;
+    HeaderSlice* _lastHeader;
+    size_t _headerCount;
+    AsyncWebArenaList<AsyncWebParameter *> _params;
+    AsyncWebArenaList<PathSlice *> _pathParams;
 
     uint8_t _multiParseState;
     uint8_t _boundaryPosition;
@@ -185,16 +285,29 @@ class AsyncWebServerRequest {
     void _onTimeout(uint32_t time);
     void _onDisconnect();
     void _onData(void *buf, size_t len);
-
-    void _addParam(AsyncWebParameter*);
-    void _addPathParam(const char *param);
-
-    bool _parseReqHead();
-    bool _parseReqHeader();
+    void _onPipelined(uint8_t *buf, size_t len);
+    void _attach();
+    void _activate();
+    void _handOver();
+    void _runHandler();
+
+    void _addParam(String name, String value, bool form = false, bool file = false, size_t size = 0);
+    void _addPathParam(const char *param, size_t len); //param points into url()
+
+    bool _appendLine(const char *data, size_t len);
+    bool _parseReqHead(const char *line, size_t len);
+    void _parseReqHeader(char *line, size_t len);
     void _parseLine();
+    void _parseFailed();
+    HeaderSlice* _findHeader(const char *name, size_t len) const;
+    AsyncWebHeader* _headerAt(HeaderSlice *slice) const;
     void _parsePlainPostChar(uint8_t data);
     void _parseMultipartPostByte(uint8_t data, bool last);
-    void _addGetParams(const String& params);
+    void _addGetParams(const char *params, size_t len);
+
+#if defined(ESP32)
+    static bool _beginPool();
+#endif
 
     void _handleUploadStart();
     void _handleUploadByte(uint8_t data, bool last);
@@ -204,11 +317,17 @@ class AsyncWebServerRequest {
     File _tempFile;
     void *_tempObject;
 
-    AsyncWebServerRequest(AsyncWebServer*, AsyncClient*);
+    AsyncWebServerRequest(AsyncWebServer*, AsyncClient*, AsyncWebServerRequest* previous = NULL);
     ~AsyncWebServerRequest();
+#if defined(ESP32)
+    //recycled through a pool, the heap is only used once it is exhausted
+    static void* operator new(size_t size) noexcept;
+    static void operator delete(void* ptr);
+#endif
 
     AsyncClient* client(){ return _client; }
     uint8_t version() const { return _version; }
+    bool keepAlive() const { return _keepAlive; }
     WebRequestMethodComposite method() const { return _method; }
     const String& url() const { return _url; }
     const String& host() const { return _host; }
@@ -242,6 +361,14 @@ class AsyncWebServerRequest {
     void sendChunked(const String& contentType, AwsResponseFiller callback, AwsTemplateProcessor templateCallback=nullptr);
     void send_P(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     void send_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback=nullptr);
+    //content that lives as long as the server (PROGMEM, literals), sent without being copied
+    void sendFlash(int code, const String& contentType, const uint8_t * content, size_t len);
+    void sendFlash(int code, const String& contentType, PGM_P content);
+    //a compiled template, its placeholders filled in by writer
+    void sendTemplate(int code, const String& contentType, const AsyncWebTemplate& content, AwsTemplateWriter writer);
+    //a struct, written as JSON as its fields describe it, see WebJson.h
+    template<typename T, size_t N>
+    void sendJson(int code, const T& object, const AsyncJsonField (&fields)[N]);
 
     AsyncWebServerResponse *beginResponse(int code, const String& contentType=String(), const String& content=String());
     AsyncWebServerResponse *beginResponse(FS &fs, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
@@ -252,6 +379,11 @@ class AsyncWebServerRequest {
     AsyncResponseStream *beginResponseStream(const String& contentType, size_t bufferSize=1460);
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback=nullptr);
+    AsyncWebServerResponse *beginFlashResponse(int code, const String& contentType, const uint8_t * content, size_t len);
+    AsyncWebServerResponse *beginFlashResponse(int code, const String& contentType, PGM_P content);
+    AsyncWebServerResponse *beginTemplateResponse(int code, const String& contentType, const AsyncWebTemplate& content, AwsTemplateWriter writer);
+    template<typename T, size_t N>
+    AsyncWebServerResponse *beginJsonResponse(int code, const T& object, const AsyncJsonField (&fields)[N]);
 
     size_t headers() const;                     // get header count
     bool hasHeader(const String& name) const;   // check if header exists
@@ -277,7 +409,9 @@ class AsyncWebServerRequest {
     bool hasArg(const char* name) const;         // check if argument exists
     bool hasArg(const __FlashStringHelper * data) const;         // check if F(argument) exists
 
-    const String& ASYNCWEBSERVER_REGEX_ATTRIBUTE pathArg(size_t i) const;
+    size_t pathArgs() const;                     // get path arguments count
+    const String& pathArg(size_t i) const;       // {name} segment of the route or regex group, by position
+    const char* pathArg(size_t i, size_t *len) const; // the same without a String, not terminated, points into url()
 
     const String& header(const char* name) const;// get request header value by name
     const String& header(const __FlashStringHelper * data) const;// get request header value by F(name)    
@@ -328,12 +462,14 @@ class AsyncWebRewrite {
  * */
 
 class AsyncWebHandler {
+  friend class AsyncWebServerRequest;
   protected:
     ArRequestFilterFunction _filter;
     String _username;
     String _password;
+    size_t _arenaHighWater;
   public:
-    AsyncWebHandler():_username(""), _password(""){}
+    AsyncWebHandler():_username(""), _password(""), _arenaHighWater(0){}
     AsyncWebHandler& setFilter(ArRequestFilterFunction fn) { _filter = fn; return *this; }
     AsyncWebHandler& setAuthentication(const char *username, const char *password){  _username = String(username);_password = String(password); return *this; };
     bool filter(AsyncWebServerRequest *request){ return _filter == NULL || _filter(request); }
@@ -345,6 +481,13 @@ class AsyncWebHandler {
     virtual void handleUpload(AsyncWebServerRequest *request  __attribute__((unused)), const String& filename __attribute__((unused)), size_t index __attribute__((unused)), uint8_t *data __attribute__((unused)), size_t len __attribute__((unused)), bool final  __attribute__((unused))){}
     virtual void handleBody(AsyncWebServerRequest *request __attribute__((unused)), uint8_t *data __attribute__((unused)), size_t len __attribute__((unused)), size_t index __attribute__((unused)), size_t total __attribute__((unused))){}
     virtual bool isRequestHandlerTrivial(){return true;}
+    //URLs the router may match for this handler, read when the router is compiled.
+    //ROUTE_NONE leaves the URL to canHandle() and asks it for every request
+    virtual WebRouteMode route(const char *&pattern __attribute__((unused)), size_t &length __attribute__((unused))){ return ROUTE_NONE; }
+    //canHandle() without the URL check, for requests the router matched to route()
+    virtual bool canHandleRoute(AsyncWebServerRequest *request){ return canHandle(request); }
+    //most arena bytes a request answered by this handler has used
+    size_t arenaHighWater() const { return _arenaHighWater; }
 };
 
 /*
@@ -369,6 +512,7 @@ class AsyncWebServerResponse {
     size_t _writtenLength;
     WebResponseState _state;
     const char* _responseCodeToString(int code);
+    void _addConnectionHeader(AsyncWebServerRequest *request);
 
   public:
     AsyncWebServerResponse();
@@ -381,6 +525,9 @@ class AsyncWebServerResponse {
     virtual bool _started() const;
     virtual bool _finished() const;
     virtual bool _failed() const;
+    virtual bool _sent() const; //all of it is written, only acks are outstanding
+    virtual size_t _unacked() const;
+    virtual bool _delimited(uint8_t version) const; //the client finds the end without the connection closing
     virtual bool _sourceValid() const;
     virtual void _respond(AsyncWebServerRequest *request);
     virtual size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
@@ -393,13 +540,20 @@ class AsyncWebServerResponse {
 typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
 typedef std::function<void(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
 typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, AsyncWebHandler *handler, size_t highWater)> ArArenaStatsHandler;
 
 class AsyncWebServer {
+  friend class AsyncWebServerRequest;
   protected:
     AsyncServer _server;
     LinkedList<AsyncWebRewrite*> _rewrites;
     LinkedList<AsyncWebHandler*> _handlers;
+    AsyncWebRouter _router;
+    bool _begun;       //requests may be routed, the router trie is not rebuilt any more
     AsyncCallbackWebHandler* _catchAllHandler;
+    uint16_t _keepAliveTimeout;
+    uint16_t _keepAliveMax;
+    ArArenaStatsHandler _onArenaStats;
 
   public:
     AsyncWebServer(uint16_t port);
@@ -408,6 +562,18 @@ class AsyncWebServer {
     void begin();
     void end();
 
+    //idle seconds between requests on one connection, 0 closes after every response;
+    //maxRequests 0 serves any number of requests on a connection
+    void setKeepAlive(uint16_t timeout, uint16_t maxRequests = ASYNCWEBSERVER_KEEPALIVE_MAX);
+
+#if defined(ESP32)
+    //misses count requests that found the pool exhausted and came from the heap
+    static void requestPoolStats(async_pool_stats_t * stats);
+    //bytes / (pool.hits + pool.misses) is what one write carries,
+    //pool.misses / responses the heap allocations a response needs
+    static void transmitStats(async_tx_stats_t * stats);
+#endif
+
 #if ASYNC_TCP_SSL_ENABLED
     void onSslFileRequest(AcSSlFileHandler cb, void* arg);
     void beginSecure(const char *cert, const char *private_key_file, const char *password);
@@ -417,6 +583,7 @@ class AsyncWebServer {
     bool removeRewrite(AsyncWebRewrite* rewrite);
     AsyncWebRewrite& rewrite(const char* from, const char* to);
 
+    //before begin(), changes after it leave every request to ask all handlers in turn
     AsyncWebHandler& addHandler(AsyncWebHandler* handler);
     bool removeHandler(AsyncWebHandler* handler);
   
@@ -426,15 +593,19 @@ class AsyncWebServer {
     AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody);
 
     AsyncStaticWebHandler& serveStatic(const char* uri, fs::FS& fs, const char* path, const char* cache_control = NULL);
+    //a gzipped asset in flash, as generated at build time, with its ETag
+    AsyncAssetWebHandler& serveAsset(const char* uri, const char* contentType, const uint8_t * content, size_t len, const char* etag, const char* cache_control = ASYNCWEBSERVER_ASSET_CACHE_CONTROL);
 
     void onNotFound(ArRequestHandlerFunction fn);  //called when handler is not assigned
     void onFileUpload(ArUploadHandlerFunction fn); //handle file uploads
     void onRequestBody(ArBodyHandlerFunction fn); //handle posts with plain body content (JSON often transmitted this way as a request)
+    void onArenaStats(ArArenaStatsHandler fn); //called when a request sets a new arena high-water mark for its handler
 
     void reset(); //remove all writers and handlers, with onNotFound/onFileUpload/onRequestBody 
   
     void _handleDisconnect(AsyncWebServerRequest *request);
     void _attachHandler(AsyncWebServerRequest *request);
+    void _routesChanged();
     void _rewriteRequest(AsyncWebServerRequest *request);
 };
 
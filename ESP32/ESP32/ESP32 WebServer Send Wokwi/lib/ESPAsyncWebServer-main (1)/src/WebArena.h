@@ -0,0 +1,225 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef WEBARENA_H_
+#define WEBARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//Initial block of the arena, part of every request: it holds the head,
+//headers, parameters and path parameters. Anything past it continues in
+//heap blocks of at least this size, set it with -DASYNCWEBSERVER_ARENA_BLOCK
+#ifndef ASYNCWEBSERVER_ARENA_BLOCK
+#define ASYNCWEBSERVER_ARENA_BLOCK 512
+#endif
+
+/*
+ * ARENA :: Bump allocator owned by a request, everything in it goes at once
+ * */
+
+class AsyncWebArena {
+  private:
+    struct Block {
+      Block* next;
+    };
+    //objects that own memory elsewhere (a String) are destroyed by reset()
+    struct Cleanup {
+      void (*destroy)(void*);
+      void* object;
+      Cleanup* next;
+    };
+
+    alignas(void*) uint8_t _first[ASYNCWEBSERVER_ARENA_BLOCK];
+    Block* _blocks; //heap blocks, newest first
+    Cleanup* _cleanups;
+    uint8_t* _top;  //next free byte of the current block
+    uint8_t* _end;
+    uint8_t* _last; //latest allocation, the only one that can grow in place
+    size_t _used;   //bytes handed out since reset(), nothing is given back before
+
+    static size_t _align(size_t size){ return (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1); }
+
+    template<typename T>
+    static void _destroy(void* object){ ((T*)object)->~T(); }
+
+  public:
+    AsyncWebArena(): _blocks(NULL), _cleanups(NULL), _top(_first), _end(_first + sizeof(_first)), _last(NULL), _used(0) {}
+    ~AsyncWebArena(){ reset(); }
+    AsyncWebArena(const AsyncWebArena&) = delete;
+    AsyncWebArena& operator=(const AsyncWebArena&) = delete;
+
+    void* alloc(size_t size){
+      size = _align(size);
+      if(size > (size_t)(_end - _top)){
+        size_t room = (size > ASYNCWEBSERVER_ARENA_BLOCK) ? size : ASYNCWEBSERVER_ARENA_BLOCK;
+        Block* block = (Block*)malloc(sizeof(Block) + room);
+        if(block == NULL){
+          return NULL;
+        }
+        block->next = _blocks;
+        _blocks = block;
+        _top = (uint8_t*)(block + 1);
+        _end = _top + room;
+      }
+      _last = _top;
+      _top += size;
+      _used += size;
+      return _last;
+    }
+
+    //constructs a T in the arena, NULL if there is no memory for it
+    template<typename T, typename... Args>
+    T* make(Args&&... args){
+      Cleanup* cleanup = NULL;
+      if(!std::is_trivially_destructible<T>::value){
+        cleanup = (Cleanup*)alloc(sizeof(Cleanup));
+        if(cleanup == NULL){
+          return NULL;
+        }
+      }
+      void* memory = alloc(sizeof(T));
+      if(memory == NULL){
+        return NULL;
+      }
+      T* object = new (memory) T(std::forward<Args>(args)...);
+      if(cleanup != NULL){
+        cleanup->destroy = &_destroy<T>;
+        cleanup->object = object;
+        cleanup->next = _cleanups;
+        _cleanups = cleanup;
+      }
+      return object;
+    }
+
+    //a terminated copy of len bytes of str
+    char* copy(const char* str, size_t len){
+      char* dup = (char*)alloc(len + 1);
+      if(dup != NULL){
+        memcpy(dup, str, len);
+        dup[len] = 0;
+      }
+      return dup;
+    }
+
+    //Makes the allocation at ptr, size bytes long, longer by more. The latest
+    //allocation grows in place while its block has room, anything else moves.
+    void* grow(void* ptr, size_t size, size_t more){
+      if(ptr != NULL && ptr == _last && _align(size + more) <= (size_t)(_end - _last)){
+        uint8_t* top = _last + _align(size + more);
+        _used += top - _top;
+        _top = top;
+        return ptr;
+      }
+      void* moved = alloc(size + more);
+      if(moved != NULL && size){
+        memcpy(moved, ptr, size);
+      }
+      return moved;
+    }
+
+    size_t used() const { return _used; }
+
+    //Destroys what make() constructed, newest first, frees the heap blocks
+    //and starts over in the inline block
+    void reset(){
+      while(_cleanups != NULL){
+        _cleanups->destroy(_cleanups->object);
+        _cleanups = _cleanups->next;
+      }
+      while(_blocks != NULL){
+        Block* block = _blocks;
+        _blocks = block->next;
+        free(block);
+      }
+      _top = _first;
+      _end = _first + sizeof(_first);
+      _last = NULL;
+      _used = 0;
+    }
+};
+
+/*
+ * ARENA LIST :: Singly linked list with its nodes in an AsyncWebArena
+ * */
+
+template <typename T>
+class AsyncWebArenaList {
+  private:
+    struct Node {
+      T value;
+      Node* next;
+    };
+    Node* _root;
+    Node* _last;
+    size_t _length;
+
+    class Iterator {
+      Node* _node;
+    public:
+      Iterator(Node* node = nullptr) : _node(node) {}
+      Iterator& operator ++() { _node = _node->next; return *this; }
+      bool operator != (const Iterator& i) const { return _node != i._node; }
+      const T& operator * () const { return _node->value; }
+      const T* operator -> () const { return &_node->value; }
+    };
+
+  public:
+    static_assert(std::is_trivially_destructible<T>::value, "the arena does not destroy list nodes");
+
+    AsyncWebArenaList(): _root(nullptr), _last(nullptr), _length(0) {}
+
+    Iterator begin() const { return Iterator(_root); }
+    Iterator end() const { return Iterator(nullptr); }
+
+    bool add(AsyncWebArena& arena, const T& value){
+      Node* node = (Node*)arena.alloc(sizeof(Node));
+      if(node == nullptr){
+        return false;
+      }
+      node->value = value;
+      node->next = nullptr;
+      if(_last != nullptr){
+        _last->next = node;
+      } else {
+        _root = node;
+      }
+      _last = node;
+      _length++;
+      return true;
+    }
+
+    size_t length() const { return _length; }
+
+    const T* nth(size_t n) const {
+      Node* node = _root;
+      while(node != nullptr && n--){
+        node = node->next;
+      }
+      return node ? &node->value : nullptr;
+    }
+};
+
+#endif /* WEBARENA_H_ */
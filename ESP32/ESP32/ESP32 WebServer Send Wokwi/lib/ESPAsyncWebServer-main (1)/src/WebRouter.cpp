@@ -0,0 +1,354 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "ESPAsyncWebServer.h"
+#include "WebRouter.h"
+
+std::atomic<uint32_t> AsyncWebRouter::_routeChanges(0);
+
+AsyncWebRouter::AsyncWebRouter(const LinkedList<AsyncWebHandler*>& handlers)
+  : _handlers(handlers)
+  , _routes(NULL)
+  , _count(0)
+  , _paths(NULL)
+  , _extensions(NULL)
+  , _opaque(NULL)
+  , _ready(false)
+  , _changes(0)
+{}
+
+AsyncWebRouter::~AsyncWebRouter(){
+  _clear();
+}
+
+AsyncWebRouter::Node* AsyncWebRouter::_node(const char* label, size_t length){
+  Node* node = new Node;
+  if(node != NULL){
+    node->label = label;
+    node->length = length;
+    node->child = NULL;
+    node->sibling = NULL;
+    node->param = NULL;
+    node->routes = NULL;
+  }
+  return node;
+}
+
+void AsyncWebRouter::_free(Node* node){
+  while(node != NULL){
+    Node* sibling = node->sibling;
+    _free(node->child);
+    _free(node->param);
+    delete node;
+    node = sibling;
+  }
+}
+
+void AsyncWebRouter::_clear(){
+  _free(_paths);
+  _free(_extensions);
+  _paths = NULL;
+  _extensions = NULL;
+  for(size_t i = 0; i < _count; i++){
+    delete[] _routes[i].pattern;
+  }
+  delete[] _routes;
+  _routes = NULL;
+  _count = 0;
+  _opaque = NULL;
+  _ready = false;
+}
+
+//Walks the literal s down from node, splitting edges where s leaves them,
+//and returns the node s ends on
+AsyncWebRouter::Node* AsyncWebRouter::_insert(Node* node, const char* s, size_t len){
+  while(len){
+    Node* child = node->child;
+    while(child != NULL && child->label[0] != s[0]){
+      child = child->sibling;
+    }
+    if(child == NULL){
+      child = _node(s, len);
+      if(child == NULL){
+        return NULL;
+      }
+      child->sibling = node->child;
+      node->child = child;
+      return child;
+    }
+    size_t common = 1;
+    while(common < len && common < child->length && child->label[common] == s[common]){
+      common++;
+    }
+    if(common < child->length){
+      Node* rest = _node(child->label + common, child->length - common);
+      if(rest == NULL){
+        return NULL;
+      }
+      rest->child = child->child;
+      rest->param = child->param;
+      rest->routes = child->routes;
+      child->child = rest;
+      child->param = NULL;
+      child->routes = NULL;
+      child->length = common;
+    }
+    node = child;
+    s += common;
+    len -= common;
+  }
+  return node;
+}
+
+bool AsyncWebRouter::_add(Node* root, Route* route, bool params){
+  Node* node = root;
+  const char* p = route->pattern;
+  const char* end = p + route->length;
+  while(node != NULL && p < end){
+    const char* open = params ? (const char*)memchr(p, '{', end - p) : NULL;
+    const char* close = open ? (const char*)memchr(open, '}', end - open) : NULL;
+    if(close == NULL){
+      node = _insert(node, p, end - p);
+      break;
+    }
+    if(open > p){
+      node = _insert(node, p, open - p);
+      if(node == NULL){
+        break;
+      }
+    }
+    if(node->param == NULL){
+      node->param = _node("", 0);
+    }
+    node = node->param;
+    p = close + 1;
+  }
+  if(node == NULL){
+    return false;
+  }
+  route->next = node->routes;
+  node->routes = route;
+  return true;
+}
+
+bool AsyncWebRouter::build(){
+  _clear();
+  _changes = _routeChanges;
+  _count = _handlers.length();
+  if(_count == 0){
+    _ready = true;
+    return true;
+  }
+  _routes = new Route[_count];
+  if(_routes == NULL){
+    _count = 0;
+    return false;
+  }
+  memset(_routes, 0, sizeof(Route) * _count);
+  _paths = _node("", 0);
+  _extensions = _node("", 0);
+  if(_paths == NULL || _extensions == NULL){
+    _clear();
+    return false;
+  }
+
+  Route* opaque = NULL;
+  size_t index = 0;
+  for(const auto& h: _handlers){
+    Route* route = &_routes[index];
+    const char* pattern = NULL;
+    size_t length = 0;
+    route->handler = h;
+    route->index = index++;
+    route->mode = h->route(pattern, length);
+    if(route->mode == ROUTE_NONE){
+      if(opaque != NULL){
+        opaque->next = route;
+      } else {
+        _opaque = route;
+      }
+      opaque = route;
+      continue;
+    }
+    route->pattern = new char[length + 1];
+    if(route->pattern == NULL){
+      _clear();
+      return false;
+    }
+    memcpy(route->pattern, pattern, length);
+    route->pattern[length] = 0;
+    route->length = length;
+    route->params = (route->mode != ROUTE_EXTENSION) && memchr(pattern, '{', length) != NULL;
+    if(!_add((route->mode == ROUTE_EXTENSION) ? _extensions : _paths, route, route->mode != ROUTE_EXTENSION)){
+      _clear();
+      return false;
+    }
+  }
+  _ready = true;
+  return true;
+}
+
+//Adds the routes that end on node and hold for the rest of the url, then
+//follows the child that continues the url and the {name} segment, if any
+void AsyncWebRouter::_collect(const Node* node, const char* url, size_t pos, size_t len, Match& match){
+  for(const Route* route = node->routes; route != NULL; route = route->next){
+    bool matched;
+    switch(route->mode){
+      case ROUTE_PATH:   matched = (pos == len || url[pos] == '/'); break;
+      case ROUTE_PREFIX: matched = true; break;
+      default:           matched = (pos == len); break;
+    }
+    if(!matched){
+      continue;
+    }
+    if(match.count == ASYNCWEBSERVER_ROUTER_CANDIDATES){
+      match.overflow = true;
+      return;
+    }
+    //insertion sort by handler order, there are only a few
+    size_t i = match.count++;
+    while(i > 0 && match.routes[i - 1]->index > route->index){
+      match.routes[i] = match.routes[i - 1];
+      i--;
+    }
+    match.routes[i] = route;
+  }
+  if(pos == len){
+    return;
+  }
+  for(const Node* child = node->child; child != NULL; child = child->sibling){
+    if(child->label[0] == url[pos]){
+      if(child->length <= len - pos && !memcmp(child->label, url + pos, child->length)){
+        _collect(child, url, pos + child->length, len, match);
+      }
+      break;
+    }
+  }
+  if(node->param != NULL && url[pos] != '/'){
+    const char* slash = (const char*)memchr(url + pos, '/', len - pos);
+    _collect(node->param, url, slash ? slash - url : len, len, match);
+  }
+}
+
+bool AsyncWebRouter::find(AsyncWebServerRequest* request, AsyncWebHandler*& handler) const {
+  handler = NULL;
+  if(!ready()){
+    return false;
+  }
+
+  const char* url = request->url().c_str();
+  size_t len = request->url().length();
+  Match match;
+  match.count = 0;
+  match.overflow = false;
+  if(_paths != NULL){
+    _collect(_paths, url, 0, len, match);
+  }
+  if(_extensions != NULL && _extensions->child != NULL){
+    const char* dot = strrchr(url, '.');
+    if(dot != NULL){
+      _collect(_extensions, url, dot - url, len, match);
+    }
+  }
+  if(match.overflow){
+    return false;
+  }
+
+  //handlers without a route are asked in between, in their place
+  const Route* opaque = _opaque;
+  size_t i = 0;
+  while(i < match.count || opaque != NULL){
+    const Route* route;
+    if(opaque != NULL && (i == match.count || opaque->index < match.routes[i]->index)){
+      route = opaque;
+      opaque = opaque->next;
+    } else {
+      route = match.routes[i++];
+    }
+    AsyncWebHandler* h = route->handler;
+    if(!h->filter(request)){
+      continue;
+    }
+    if(route->mode == ROUTE_NONE){
+      if(!h->canHandle(request)){
+        continue;
+      }
+    } else {
+      if(!h->canHandleRoute(request)){
+        continue;
+      }
+      if(route->params){
+        _match(url, len, route->mode, route->pattern, route->length, request);
+      }
+    }
+    handler = h;
+    return true;
+  }
+  return true;
+}
+
+bool AsyncWebRouter::_match(const char* url, size_t len, WebRouteMode mode, const char* pattern, size_t length, AsyncWebServerRequest* capture){
+  if(mode == ROUTE_NONE){
+    return false;
+  }
+  if(mode == ROUTE_EXTENSION){
+    return len >= length && !memcmp(url + len - length, pattern, length);
+  }
+  const char* end = pattern + length;
+  size_t pos = 0;
+  while(pattern < end){
+    if(*pattern == '{'){
+      const char* close = (const char*)memchr(pattern, '}', end - pattern);
+      if(close != NULL){
+        size_t segment = pos;
+        while(segment < len && url[segment] != '/'){
+          segment++;
+        }
+        if(segment == pos){
+          return false;
+        }
+        if(capture != NULL){
+          capture->_addPathParam(url + pos, segment - pos);
+        }
+        pos = segment;
+        pattern = close + 1;
+        continue;
+      }
+    }
+    if(pos == len || url[pos] != *pattern){
+      return false;
+    }
+    pos++;
+    pattern++;
+  }
+  switch(mode){
+    case ROUTE_PATH:   return pos == len || url[pos] == '/';
+    case ROUTE_PREFIX: return true;
+    default:           return pos == len;
+  }
+}
+
+bool AsyncWebRouter::match(AsyncWebServerRequest* request, WebRouteMode mode, const char* pattern, size_t length){
+  return _match(request->url().c_str(), request->url().length(), mode, pattern, length, NULL);
+}
+
+void AsyncWebRouter::capture(AsyncWebServerRequest* request, const char* pattern, size_t length){
+  _match(request->url().c_str(), request->url().length(), ROUTE_PREFIX, pattern, length, request);
+}
@@ -0,0 +1,72 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef WEBTEMPLATE_H_
+#define WEBTEMPLATE_H_
+
+#include "Arduino.h"
+#include <functional>
+
+//Room for the value a placeholder is replaced with, longer ones are cut one short of it
+#ifndef ASYNCWEBSERVER_TEMPLATE_VALUE_LENGTH
+#define ASYNCWEBSERVER_TEMPLATE_VALUE_LENGTH 64
+#endif
+
+//Writes the value of the placeholder name into buffer, at most size bytes,
+//and returns its length, the way snprintf() does
+typedef std::function<size_t(const char* name, char* buffer, size_t size)> AwsTemplateWriter;
+
+/*
+ * TEMPLATE :: Content in flash with its %NAME% placeholders found once
+ * */
+
+//A placeholder is a name of letters, digits and '_' between two '%', %% is
+//a single '%'. Any other '%', like the ones in CSS, is text. The content is
+//not copied, it has to outlive the template, which outlives its responses.
+class AsyncWebTemplate {
+  friend class AsyncTemplateResponse;
+  private:
+    struct Segment {
+      size_t offset;    //of the text in the content
+      size_t length;    //of the text, 0 for a placeholder
+      const char* name; //of the placeholder, NULL for text
+    };
+    const uint8_t* _content;
+    size_t _length;
+    Segment* _segments;
+    size_t _count;
+    char* _names;      //all placeholder names, each terminated
+
+    size_t _scan(Segment* segments, char* names, size_t* namesLength) const;
+
+  public:
+    AsyncWebTemplate(const uint8_t* content, size_t len);
+    AsyncWebTemplate(PGM_P content);
+    ~AsyncWebTemplate();
+    AsyncWebTemplate(const AsyncWebTemplate&) = delete;
+    AsyncWebTemplate& operator=(const AsyncWebTemplate&) = delete;
+
+    //false if there was no memory for the segments
+    bool compiled() const { return _segments != NULL; }
+    size_t segments() const { return _count; }
+    size_t placeholders() const;
+};
+
+#endif /* WEBTEMPLATE_H_ */
@@ -28,9 +28,7 @@ void WiFiTask(void *parameter) {
 void ServerTask(void *parameter) {
     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(200, "text/html", getHTML());
-    });
+    server.serveAsset("/", INDEX_HTML_TYPE, index_html_gz, sizeof(index_html_gz), INDEX_HTML_ETAG);
 
     events.onConnect([](AsyncEventSourceClient *client) {
         if(client->lastId()) {
@@ -45,10 +43,6 @@ void ServerTask(void *parameter) {
     }
 }
 
-String getHTML() {
-    return HTML_TEMPLATE;
-}
-
 void initLCDLabels() {
     lcd.clear();
     lcd.setCursor(0, 0);